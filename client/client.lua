@@ -1,7 +1,8 @@
 local WebSocket = WebSocket or (syn and syn.websocket)
 assert(WebSocket, "Disassembler requires WebSocket library")
 
-local DisassemblerSocket = WebSocket.connect("ws://localhost:5395") -- Change if using a different host
+local SERVER_URL = "ws://localhost:5395" -- Change if using a different host
+local DisassemblerSocket = WebSocket.connect(SERVER_URL)
 
 -- Since the synapse websocket library doesn't support raw binary data,
 -- we need to first encode in Base64 before sending the data over the wire.
@@ -9,15 +10,134 @@ local DisassemblerSocket = WebSocket.connect("ws://localhost:5395") -- Change if
 -- UTF-8 is sent with the text opcode, so we need to be careful to not send invalid data.
 local isSynapse = identifyexecutor and string.find(identifyexecutor(), "^Synapse") ~= nil
 
-getgenv().disassemble = function(bytecode)
-	assert(type(bytecode) == "string", "Argument #1 to disassemble must be a string")
+local OUTPUT_FORMATS = { text = 0, json = 1 }
+local ENCODINGS = { text = 0, binary = 1, base64 = 2 }
+local MODES = { disassemble = 0, references = 1, diff = 2, stats = 3, similar = 4, opcodes = 5, constants = 6, signatures = 7 }
+
+local function encodeLEB128(value)
+	local bytes = {}
+	repeat
+		local byte = value % 128
+		value = math.floor(value / 128)
+		if value > 0 then
+			byte += 128
+		end
+		table.insert(bytes, string.char(byte))
+	until value == 0
+	return table.concat(bytes)
+end
+
+local function encodeOption(tag, payload)
+	return string.char(tag) .. encodeLEB128(#payload) .. payload
+end
 
+-- Builds the options envelope the server reads in front of the bytecode (see README)
+local function encodeOptions(options, uploadSize)
+	local fields = { "LDOP" }
+
+	if options.lineInfo ~= nil then
+		table.insert(fields, encodeOption(0x01, string.char(options.lineInfo and 1 or 0)))
+	end
+	if options.format then
+		table.insert(fields, encodeOption(0x02, string.char(assert(OUTPUT_FORMATS[options.format], "Unknown output format"))))
+	end
+	if options.protos then
+		local ids = {}
+		for _, id in ipairs(options.protos) do
+			table.insert(ids, encodeLEB128(id))
+		end
+		table.insert(fields, encodeOption(0x03, table.concat(ids)))
+	end
+	if options.name then
+		table.insert(fields, encodeOption(0x04, options.name))
+	end
+	if options.maxOutputBytes then
+		table.insert(fields, encodeOption(0x05, encodeLEB128(options.maxOutputBytes)))
+	end
+	if options.encoding then
+		table.insert(fields, encodeOption(0x06, string.char(assert(ENCODINGS[options.encoding], "Unknown encoding"))))
+	end
+	if options.blocks ~= nil then
+		table.insert(fields, encodeOption(0x07, string.char(options.blocks and 1 or 0)))
+	end
+	if options.calls ~= nil then
+		table.insert(fields, encodeOption(0x10, string.char(options.calls and 1 or 0)))
+	end
+	if options.mode then
+		table.insert(fields, encodeOption(0x08, string.char(assert(MODES[options.mode], "Unknown mode"))))
+	end
+	if options.references then
+		for _, query in ipairs(options.references) do
+			table.insert(fields, encodeOption(0x09, query))
+		end
+	end
+	if options.old then
+		table.insert(fields, encodeOption(0x0A, encodeLEB128(#options.old)))
+	end
+	if options.deadline then
+		table.insert(fields, encodeOption(0x0B, encodeLEB128(options.deadline)))
+	end
+	if uploadSize then
+		table.insert(fields, encodeOption(0x0C, encodeLEB128(uploadSize)))
+	end
+	if options.pageBytes then
+		table.insert(fields, encodeOption(0x0D, encodeLEB128(options.pageBytes)))
+	end
+	if options.range then
+		table.insert(fields, encodeOption(0x0E, encodeLEB128(options.range[1]) .. encodeLEB128(options.range[2] or 0)))
+	end
+	if options.cursor then
+		table.insert(fields, encodeOption(0x0F, options.cursor))
+	end
+	if options.script then
+		table.insert(fields, encodeOption(0x11, options.script))
+	end
+	if options.constantProtos ~= nil then
+		table.insert(fields, encodeOption(0x12, string.char(options.constantProtos and 1 or 0)))
+	end
+	if options.signatures ~= nil then
+		table.insert(fields, encodeOption(0x13, string.char(options.signatures and 1 or 0)))
+	end
+
+	table.insert(fields, string.char(0x00))
+	return table.concat(fields)
+end
+
+local function send(frame)
 	if isSynapse then
-		local encodedBytecode = syn.crypt.base64.encode(bytecode)
-		DisassemblerSocket:Send(encodedBytecode)
+		DisassemblerSocket:Send(syn.crypt.base64.encode(frame))
 	else
-		DisassemblerSocket:Send(bytecode)
+		DisassemblerSocket:Send(frame)
 	end
+end
+
+getgenv().disassemble = function(bytecode, options)
+	assert(type(bytecode) == "string", "Argument #1 to disassemble must be a string")
+
+	if options then
+		assert(type(options) == "table", "Argument #2 to disassemble must be a table")
+
+		-- Large scripts can be sent in pieces, the server disassembles what has arrived while the rest is still on the way
+		local chunkSize = options.chunkSize
+		if chunkSize and #bytecode > chunkSize and (options.mode or "disassemble") == "disassemble" then
+			send(encodeOptions(options, #bytecode) .. string.sub(bytecode, 1, chunkSize))
+			for offset = chunkSize + 1, #bytecode, chunkSize do
+				send(string.sub(bytecode, offset, offset + chunkSize - 1))
+			end
+
+			-- An upload that fails before its last piece arrives ends the connection, the next request needs a new one
+			local response = DisassemblerSocket.OnMessage:Wait()
+			if string.sub(response, 1, 8) == "; error:" then
+				pcall(DisassemblerSocket.Close, DisassemblerSocket)
+				DisassemblerSocket = WebSocket.connect(SERVER_URL)
+			end
+			return response
+		end
+
+		bytecode = encodeOptions(options) .. (options.old or "") .. bytecode
+	end
+
+	send(bytecode)
 
 	return DisassemblerSocket.OnMessage:Wait()
 end
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "disassembler/disassembler.hpp"
+#include "disassembler/request.hpp"
+#include "disassembler/scan.hpp"
+#include "disassembler/hash.hpp"
+#include "src/config.hpp"
+#include "src/capture.hpp"
+#include "src/histogram.hpp"
+
+#ifdef CAPTURE_REPLAY_LIVE
+#include "websocketpp/client.hpp"
+#include "websocketpp/config/asio_no_tls_client.hpp"
+#endif
+
+// Feeds a capture written by the server's --capture option back through the disassembler, either in process or against a
+// live server, at the original pace scaled by --speed (0 replays as fast as possible)
+
+using Clock = std::chrono::steady_clock;
+
+// Websocket frame opcodes, as stored in the capture
+constexpr uint8_t FRAME_TEXT = 1;
+constexpr uint8_t FRAME_BINARY = 2;
+
+struct ReplayOptions {
+	std::string capturePath;
+	std::string liveUri;
+	double speed = 1;
+	bool useCache = false;
+};
+
+struct ReplayStats {
+	LatencyHistogram latency; // microseconds, from the frame's scheduled time
+	uint64_t replayed = 0;
+	uint64_t errors = 0;
+	uint64_t skipped = 0; // control frames
+	uint64_t responseBytes = 0;
+	LuauDisassembler::Hasher responseDigest;
+	double seconds = 0;
+};
+
+static Clock::time_point getScheduledTime(Clock::time_point start, const CapturedFrame& frame, double speed) {
+	if (speed <= 0)
+		return start;
+	return start + std::chrono::duration_cast<Clock::duration>(std::chrono::microseconds(frame.timestamp) / speed);
+}
+
+static std::string decodeBase64(const std::string& input) {
+	static const std::string ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string output;
+	output.reserve(input.size() / 4 * 3);
+
+	uint32_t buffer = 0;
+	int bits = 0;
+	for (char c : input) {
+		size_t value = ALPHABET.find(c);
+		if (value == std::string::npos)
+			continue; // padding and whitespace
+
+		buffer = (buffer << 6) | uint32_t(value);
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			output += char((buffer >> bits) & 0xFF);
+		}
+	}
+
+	return output;
+}
+
+// The server scans each request for its admission estimates before running it, malformed bytecode is rejected there
+static void scanRequest(const char* bytecode, size_t size, const LuauDisassembler::DisassemblyOptions& options) {
+	// A cursor without bytecode resumes from the script cache, there is nothing to scan
+	if (size == 0 && options.hasCursor)
+		return;
+
+	if (options.mode == LuauDisassembler::RequestMode::Diff && options.diffBaseSize > 0 && options.diffBaseSize < size) {
+		LuauDisassembler::scan_bytecode(bytecode, options.diffBaseSize);
+		LuauDisassembler::scan_bytecode(bytecode + options.diffBaseSize, size - options.diffBaseSize);
+	} else {
+		LuauDisassembler::scan_bytecode(bytecode, size);
+	}
+}
+
+// Replays every frame in process through the same request path as the server, in capture order
+static void replayDirect(const std::vector<CapturedFrame>& frames, const ReplayOptions& options, ReplayStats& stats) {
+	LuauDisassembler::ProtoCache protoCache(DISASSEMBLER_DEFAULT_PROTO_CACHE_SIZE);
+	LuauDisassembler::RequestContext requestContext;
+	if (options.useCache)
+		requestContext.protoCache = &protoCache;
+
+	Clock::time_point start = Clock::now();
+
+	for (const CapturedFrame& frame : frames) {
+		if (frame.opcode != FRAME_TEXT && frame.opcode != FRAME_BINARY) {
+			stats.skipped++;
+			continue;
+		}
+
+		Clock::time_point scheduledTime = getScheduledTime(start, frame, options.speed);
+		std::this_thread::sleep_until(scheduledTime);
+		if (options.speed <= 0)
+			scheduledTime = Clock::now();
+
+		std::string request = frame.opcode == FRAME_TEXT ? decodeBase64(frame.payload) : frame.payload;
+
+		LuauDisassembler::DisassemblyOptions requestOptions;
+		std::string response;
+		try {
+			size_t bytecodeOffset = LuauDisassembler::parse_options(request.c_str(), request.size(), requestOptions);
+			scanRequest(request.c_str() + bytecodeOffset, request.size() - bytecodeOffset, requestOptions);
+			response = LuauDisassembler::run_request(request.c_str() + bytecodeOffset, request.size() - bytecodeOffset, requestOptions, requestContext);
+		} catch (const std::exception& e) {
+			response = std::string("; error: ") + e.what() + '\n';
+			stats.errors++;
+		}
+
+		stats.latency.record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduledTime).count()));
+		stats.replayed++;
+		stats.responseBytes += response.size();
+		stats.responseDigest.add(response);
+	}
+
+	stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+#ifdef CAPTURE_REPLAY_LIVE
+using client = websocketpp::client<websocketpp::config::asio_client>;
+
+// Replays against a running server, with one connection per captured connection so each keeps its original frame order
+class LiveReplay {
+public:
+	LiveReplay(const std::vector<CapturedFrame>& frames, const ReplayOptions& options, ReplayStats& stats) : frames(frames), options(options), stats(stats) {
+		endpoint.clear_access_channels(websocketpp::log::alevel::all);
+		endpoint.clear_error_channels(websocketpp::log::elevel::all);
+		endpoint.init_asio();
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			if (frames[i].opcode != FRAME_TEXT && frames[i].opcode != FRAME_BINARY) {
+				stats.skipped++;
+				continue;
+			}
+
+			auto [it, inserted] = connectionIndices.emplace(frames[i].connectionId, connections.size());
+			if (inserted)
+				connections.emplace_back();
+			connections[it->second].frames.push_back(i);
+			remaining++;
+		}
+	}
+
+	bool run() {
+		for (size_t i = 0; i < connections.size(); i++) {
+			websocketpp::lib::error_code ec;
+			client::connection_ptr con = endpoint.get_connection(options.liveUri, ec);
+			if (ec) {
+				std::cerr << "invalid uri " << options.liveUri << ": " << ec.message() << '\n';
+				return false;
+			}
+
+			con->set_open_handler([this](websocketpp::connection_hdl) { onOpen(); });
+			con->set_fail_handler([this](websocketpp::connection_hdl) { failed = true; endpoint.stop(); });
+			con->set_message_handler([this, i](websocketpp::connection_hdl, client::message_ptr msg) { onMessage(i, msg); });
+
+			connections[i].hdl = con->get_handle();
+			endpoint.connect(con);
+		}
+
+		if (connections.empty())
+			return true;
+
+		endpoint.run();
+		stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (failed)
+			std::cerr << "connection to " << options.liveUri << " failed\n";
+		return !failed;
+	}
+
+private:
+	struct Connection {
+		websocketpp::connection_hdl hdl;
+		std::vector<size_t> frames; // indices into the capture, in order
+		size_t nextFrame = 0;
+		std::deque<Clock::time_point> pending;
+	};
+
+	const std::vector<CapturedFrame>& frames;
+	const ReplayOptions& options;
+	ReplayStats& stats;
+
+	client endpoint;
+	std::vector<Connection> connections;
+	std::unordered_map<uint32_t, size_t> connectionIndices;
+	size_t openCount = 0;
+	size_t remaining = 0;
+	bool failed = false;
+	Clock::time_point start;
+
+	void onOpen() {
+		if (++openCount < connections.size())
+			return;
+
+		// Timing starts once every connection is open, so connection setup isn't part of the replayed schedule
+		start = Clock::now();
+		if (options.speed > 0) {
+			tick();
+		} else {
+			for (Connection& connection : connections)
+				sendNext(connection, start);
+		}
+	}
+
+	void sendNext(Connection& connection, Clock::time_point scheduledTime) {
+		const CapturedFrame& frame = frames[connection.frames[connection.nextFrame++]];
+
+		websocketpp::lib::error_code ec;
+		endpoint.send(connection.hdl, frame.payload, websocketpp::frame::opcode::value(frame.opcode), ec);
+		if (ec) {
+			// The connection is unusable, so the rest of its frames fail too
+			size_t failedFrames = connection.frames.size() - connection.nextFrame + 1;
+			connection.nextFrame = connection.frames.size();
+			stats.errors += failedFrames;
+			finish(failedFrames);
+			return;
+		}
+
+		connection.pending.push_back(scheduledTime);
+	}
+
+	// Timed replay: sends every frame whose scheduled time has passed, then checks again in a millisecond
+	void tick() {
+		Clock::time_point now = Clock::now();
+		bool more = false;
+
+		for (Connection& connection : connections) {
+			while (connection.nextFrame < connection.frames.size()) {
+				Clock::time_point scheduledTime = getScheduledTime(start, frames[connection.frames[connection.nextFrame]], options.speed);
+				if (scheduledTime > now)
+					break;
+				sendNext(connection, scheduledTime);
+			}
+			more |= connection.nextFrame < connection.frames.size();
+		}
+
+		if (more)
+			endpoint.set_timer(1, [this](const websocketpp::lib::error_code&) { tick(); });
+	}
+
+	void onMessage(size_t index, client::message_ptr msg) {
+		Connection& connection = connections[index];
+		if (connection.pending.empty())
+			return;
+
+		Clock::time_point now = Clock::now();
+		stats.latency.record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now - connection.pending.front()).count()));
+		connection.pending.pop_front();
+
+		const std::string& payload = msg->get_payload();
+		stats.replayed++;
+		stats.responseBytes += payload.size();
+		if (payload.compare(0, 9, "; error: ") == 0)
+			stats.errors++;
+
+		if (options.speed <= 0 && connection.nextFrame < connection.frames.size())
+			sendNext(connection, now);
+
+		finish(1);
+	}
+
+	void finish(size_t count) {
+		remaining -= count;
+		if (remaining > 0)
+			return;
+
+		for (Connection& connection : connections) {
+			websocketpp::lib::error_code ec;
+			endpoint.close(connection.hdl, websocketpp::close::status::normal, "done", ec);
+		}
+		endpoint.stop();
+	}
+};
+#endif
+
+int main(int argc, char* argv[]) {
+	ReplayOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--speed" && i + 1 < argc) {
+			options.speed = atof(argv[++i]);
+		} else if (arg == "--cache") {
+			options.useCache = true;
+#ifdef CAPTURE_REPLAY_LIVE
+		} else if (arg == "--live" && i + 1 < argc) {
+			options.liveUri = argv[++i];
+#endif
+		} else {
+			options.capturePath = arg;
+		}
+	}
+
+	if (options.capturePath.empty()) {
+		std::cerr <<
+			"usage: capture_replay [--speed factor] [--cache]"
+#ifdef CAPTURE_REPLAY_LIVE
+			" [--live ws://127.0.0.1:5395]"
+#endif
+			" <capture file>\n";
+		return 1;
+	}
+
+	std::vector<CapturedFrame> frames;
+	try {
+		frames = read_capture(options.capturePath);
+	} catch (const std::exception& e) {
+		std::cerr << options.capturePath << ": " << e.what() << '\n';
+		return 1;
+	}
+
+	uint64_t capturedMicroseconds = frames.empty() ? 0 : frames.back().timestamp;
+	std::string target = options.liveUri.empty() ? "in process" : options.liveUri;
+	char pace[32] = "full speed";
+	if (options.speed > 0)
+		snprintf(pace, sizeof(pace), "%gx speed", options.speed);
+	printf("capture: %zu frames over %.3f s, replaying %s at %s\n", frames.size(), double(capturedMicroseconds) / 1e6, target.c_str(), pace);
+
+	ReplayStats stats;
+	if (options.liveUri.empty()) {
+		replayDirect(frames, options, stats);
+	} else {
+#ifdef CAPTURE_REPLAY_LIVE
+		LiveReplay replay(frames, options, stats);
+		if (!replay.run())
+			return 1;
+#endif
+	}
+
+	printf(
+		"replayed: %llu requests, %llu errors, %llu control frames skipped, %.3f s, %.1f req/s\n",
+		(unsigned long long)stats.replayed,
+		(unsigned long long)stats.errors,
+		(unsigned long long)stats.skipped,
+		stats.seconds,
+		stats.seconds > 0 ? double(stats.replayed) / stats.seconds : 0
+	);
+	printf(
+		"latency (ms): p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+		double(stats.latency.getPercentile(50)) / 1000,
+		double(stats.latency.getPercentile(90)) / 1000,
+		double(stats.latency.getPercentile(99)) / 1000,
+		double(stats.latency.getMax()) / 1000
+	);
+
+	// The same capture always produces the same responses in process, so the digest shows whether output changed between builds
+	if (options.liveUri.empty())
+		printf("responses: %llu bytes, digest %016llx\n", (unsigned long long)stats.responseBytes, (unsigned long long)stats.responseDigest.finish());
+}
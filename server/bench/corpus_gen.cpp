@@ -0,0 +1,710 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include "disassembler/bytecode.hpp"
+
+// Generates synthetic version 2 bytecode in the layout deserialize_bytecode reads, so benchmarks and load tests don't need real scripts
+// Output only has to be structurally valid (operands in range, jumps landing on instructions), it is never executed
+
+struct Random {
+	uint64_t state;
+
+	explicit Random(uint64_t seed) : state(seed) {}
+
+	uint64_t next() {
+		// splitmix64
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	uint32_t below(uint32_t bound) {
+		return bound ? uint32_t(next() % bound) : 0;
+	}
+
+	bool chance(uint32_t percent) {
+		return below(100) < percent;
+	}
+};
+
+struct Writer {
+	std::string data;
+
+	void u8(uint8_t value) {
+		data += char(value);
+	}
+
+	void u32(uint32_t value) {
+		data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void f64(double value) {
+		data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void leb128(uint32_t value) {
+		do {
+			uint8_t byte = value & 127;
+			value >>= 7;
+			if (value)
+				byte |= 128;
+			data += char(byte);
+		} while (value);
+	}
+};
+
+enum ConstantKind : uint8_t {
+	CONSTANT_NIL = 0,
+	CONSTANT_BOOLEAN = 1,
+	CONSTANT_NUMBER = 2,
+	CONSTANT_STRING = 3,
+	CONSTANT_IMPORT = 4,
+	CONSTANT_TABLE = 5,
+	CONSTANT_CLOSURE = 6,
+};
+
+const char* CONSTANT_KIND_NAMES[7] = { "nil", "boolean", "number", "string", "import", "table", "closure" };
+
+// Families of instructions the generator knows how to emit with valid operands
+enum InstructionShape : uint8_t {
+	SHAPE_ABC, // plain register operands
+	SHAPE_LOADN,
+	SHAPE_LOADK,
+	SHAPE_STRING_AUX, // GETGLOBAL/SETGLOBAL/GETTABLEKS/SETTABLEKS
+	SHAPE_NAMECALL, // NAMECALL followed by its CALL
+	SHAPE_IMPORT,
+	SHAPE_NUMBER_K, // ADDK..POWK
+	SHAPE_ANY_K, // ANDK/ORK
+	SHAPE_JUMP, // D jump offset
+	SHAPE_JUMP_AUX, // D jump offset with register AUX
+	SHAPE_JUMP_K, // D jump offset with constant AUX
+	SHAPE_LOADB,
+	SHAPE_CALL,
+	SHAPE_FASTCALL, // FASTCALL1/FASTCALL2 followed by the CALL they skip
+	SHAPE_NEWTABLE,
+	SHAPE_SETLIST,
+	SHAPE_DUPTABLE,
+	SHAPE_NEWCLOSURE,
+	SHAPE_DUPCLOSURE,
+};
+
+struct OpcodeInfo {
+	const char* name;
+	uint8_t opcode;
+	InstructionShape shape;
+	uint32_t weight; // in the "balanced" mix
+};
+
+OpcodeInfo OPCODES[] = {
+	{ "MOVE", LOP_MOVE, SHAPE_ABC, 10 },
+	{ "LOADNIL", LOP_LOADNIL, SHAPE_ABC, 2 },
+	{ "LOADN", LOP_LOADN, SHAPE_LOADN, 6 },
+	{ "LOADK", LOP_LOADK, SHAPE_LOADK, 8 },
+	{ "LOADB", LOP_LOADB, SHAPE_LOADB, 2 },
+	{ "GETUPVAL", LOP_GETUPVAL, SHAPE_ABC, 3 },
+	{ "GETGLOBAL", LOP_GETGLOBAL, SHAPE_STRING_AUX, 2 },
+	{ "SETGLOBAL", LOP_SETGLOBAL, SHAPE_STRING_AUX, 1 },
+	{ "GETIMPORT", LOP_GETIMPORT, SHAPE_IMPORT, 6 },
+	{ "GETTABLE", LOP_GETTABLE, SHAPE_ABC, 3 },
+	{ "SETTABLE", LOP_SETTABLE, SHAPE_ABC, 2 },
+	{ "GETTABLEKS", LOP_GETTABLEKS, SHAPE_STRING_AUX, 8 },
+	{ "SETTABLEKS", LOP_SETTABLEKS, SHAPE_STRING_AUX, 4 },
+	{ "GETTABLEN", LOP_GETTABLEN, SHAPE_ABC, 2 },
+	{ "NAMECALL", LOP_NAMECALL, SHAPE_NAMECALL, 5 },
+	{ "CALL", LOP_CALL, SHAPE_CALL, 8 },
+	{ "JUMP", LOP_JUMP, SHAPE_JUMP, 3 },
+	{ "JUMPBACK", LOP_JUMPBACK, SHAPE_JUMP, 1 },
+	{ "JUMPIF", LOP_JUMPIF, SHAPE_JUMP, 3 },
+	{ "JUMPIFNOT", LOP_JUMPIFNOT, SHAPE_JUMP, 4 },
+	{ "JUMPIFEQ", LOP_JUMPIFEQ, SHAPE_JUMP_AUX, 1 },
+	{ "JUMPIFLT", LOP_JUMPIFLT, SHAPE_JUMP_AUX, 1 },
+	{ "JUMPIFNOTEQ", LOP_JUMPIFNOTEQ, SHAPE_JUMP_AUX, 1 },
+	{ "JUMPIFEQK", LOP_JUMPIFEQK, SHAPE_JUMP_K, 1 },
+	{ "JUMPIFNOTEQK", LOP_JUMPIFNOTEQK, SHAPE_JUMP_K, 1 },
+	{ "ADD", LOP_ADD, SHAPE_ABC, 3 },
+	{ "SUB", LOP_SUB, SHAPE_ABC, 2 },
+	{ "MUL", LOP_MUL, SHAPE_ABC, 2 },
+	{ "DIV", LOP_DIV, SHAPE_ABC, 1 },
+	{ "ADDK", LOP_ADDK, SHAPE_NUMBER_K, 3 },
+	{ "SUBK", LOP_SUBK, SHAPE_NUMBER_K, 1 },
+	{ "MULK", LOP_MULK, SHAPE_NUMBER_K, 1 },
+	{ "ANDK", LOP_ANDK, SHAPE_ANY_K, 1 },
+	{ "ORK", LOP_ORK, SHAPE_ANY_K, 1 },
+	{ "CONCAT", LOP_CONCAT, SHAPE_ABC, 2 },
+	{ "NOT", LOP_NOT, SHAPE_ABC, 1 },
+	{ "LENGTH", LOP_LENGTH, SHAPE_ABC, 1 },
+	{ "NEWTABLE", LOP_NEWTABLE, SHAPE_NEWTABLE, 2 },
+	{ "DUPTABLE", LOP_DUPTABLE, SHAPE_DUPTABLE, 1 },
+	{ "SETLIST", LOP_SETLIST, SHAPE_SETLIST, 1 },
+	{ "FORNPREP", LOP_FORNPREP, SHAPE_JUMP, 1 },
+	{ "FORNLOOP", LOP_FORNLOOP, SHAPE_JUMP, 1 },
+	{ "FASTCALL1", LOP_FASTCALL1, SHAPE_FASTCALL, 1 },
+	{ "FASTCALL2", LOP_FASTCALL2, SHAPE_FASTCALL, 1 },
+	{ "NEWCLOSURE", LOP_NEWCLOSURE, SHAPE_NEWCLOSURE, 2 },
+	{ "DUPCLOSURE", LOP_DUPCLOSURE, SHAPE_DUPCLOSURE, 1 },
+};
+
+struct GeneratorOptions {
+	uint64_t seed = 1;
+	uint32_t protoCount = 16;
+	uint32_t instructionsPerProto = 64;
+	uint32_t stringCount = 256;
+	uint32_t maxDepth = 4;
+	bool lineInfo = true;
+	size_t targetSize = 0; // when set, protos are added until the output reaches this size
+	std::vector<uint32_t> opcodeWeights; // parallel to OPCODES
+	bool constantKinds[7] = { true, true, true, true, true, true, true };
+};
+
+struct GeneratedProto {
+	uint32_t globalId = 0;
+	uint32_t height = 0; // longest chain of nested children below this proto
+	uint8_t nups = 0;
+	bool claimed = false;
+};
+
+class BytecodeGenerator {
+public:
+	BytecodeGenerator(const GeneratorOptions& options) : options(options), random(options.seed) {}
+
+	std::string generate() {
+		Writer out;
+		out.u8(2);
+
+		out.leb128(options.stringCount);
+		for (uint32_t i = 0; i < options.stringCount; i++) {
+			std::string str = makeIdentifier();
+			out.leb128(uint32_t(str.size()));
+			out.data += str;
+		}
+
+		// Protos are written after the proto count, so they're generated into a separate buffer first
+		Writer body;
+		uint32_t count = 0;
+		for (;;) {
+			bool isMain = options.targetSize ? body.data.size() + 1024 >= options.targetSize : count + 1 == options.protoCount;
+			generateProto(body, count, isMain);
+			count++;
+
+			if (isMain)
+				break;
+		}
+
+		out.leb128(count);
+		out.data += body.data;
+		out.leb128(count - 1); // main proto id
+
+		return out.data;
+	}
+
+private:
+	const GeneratorOptions& options;
+	Random random;
+	std::vector<GeneratedProto> protos;
+
+	// Constant indices of each kind in the proto being generated
+	std::vector<uint32_t> constantsOfKind[7];
+	std::vector<uint32_t> importIds; // indexed by constant, GETIMPORT repeats the id in its AUX word
+	uint32_t constantCount = 0;
+
+	std::string makeIdentifier() {
+		static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+		std::string str;
+		uint32_t length = 3 + random.below(14);
+		for (uint32_t i = 0; i < length; i++)
+			str += ALPHABET[random.below(sizeof(ALPHABET) - 1)];
+		return str;
+	}
+
+	uint32_t stringId() {
+		return 1 + random.below(options.stringCount);
+	}
+
+	uint32_t pickConstant(ConstantKind kind) {
+		const std::vector<uint32_t>& candidates = constantsOfKind[kind];
+		return candidates[random.below(uint32_t(candidates.size()))];
+	}
+
+	uint32_t pickRegister() {
+		return random.below(16);
+	}
+
+	const OpcodeInfo& pickOpcode() {
+		uint64_t total = 0;
+		for (uint32_t weight : options.opcodeWeights)
+			total += weight;
+
+		uint64_t roll = random.next() % total;
+		for (size_t i = 0; i < options.opcodeWeights.size(); i++) {
+			if (roll < options.opcodeWeights[i])
+				return OPCODES[i];
+			roll -= options.opcodeWeights[i];
+		}
+		return OPCODES[0];
+	}
+
+	void writeConstants(Writer& out, const std::vector<uint32_t>& children) {
+		for (std::vector<uint32_t>& list : constantsOfKind)
+			list.clear();
+
+		// Numbers and strings always exist (and come first, so 8-bit constant operands can reach them); other kinds only when enabled
+		std::vector<ConstantKind> kinds;
+		for (int kind = 0; kind < 7; kind++) {
+			if (kind == CONSTANT_NUMBER || kind == CONSTANT_STRING || options.constantKinds[kind])
+				kinds.push_back(ConstantKind(kind));
+		}
+
+		constantCount = 8 + random.below(24);
+		importIds.assign(constantCount, 0);
+		std::vector<ConstantKind> layout;
+		for (uint32_t i = 0; i < constantCount; i++) {
+			ConstantKind kind = i < 4 ? (i % 2 ? CONSTANT_STRING : CONSTANT_NUMBER) : kinds[random.below(uint32_t(kinds.size()))];
+			if (kind == CONSTANT_CLOSURE && children.empty())
+				kind = CONSTANT_STRING;
+			layout.push_back(kind);
+		}
+
+		out.leb128(constantCount);
+		for (uint32_t i = 0; i < constantCount; i++) {
+			ConstantKind kind = layout[i];
+			out.u8(kind);
+
+			switch (kind) {
+			case CONSTANT_BOOLEAN: {
+				out.u8(random.chance(50));
+				break;
+			}
+			case CONSTANT_NUMBER: {
+				out.f64(double(random.below(100000)) / 8);
+				break;
+			}
+			case CONSTANT_STRING: {
+				out.leb128(stringId());
+				break;
+			}
+			case CONSTANT_IMPORT: {
+				// Import paths are built from string constants that come before them (ids are 10 bits)
+				const std::vector<uint32_t>& strings = constantsOfKind[CONSTANT_STRING];
+				uint32_t count = 1 + random.below(3);
+				uint32_t id = count << 30;
+				for (uint32_t part = 0; part < count; part++)
+					id |= std::min(strings[random.below(uint32_t(strings.size()))], 1023u) << (20 - part * 10);
+				out.u32(id);
+				importIds[i] = id;
+				break;
+			}
+			case CONSTANT_TABLE: {
+				const std::vector<uint32_t>& strings = constantsOfKind[CONSTANT_STRING];
+				uint32_t keys = random.below(5);
+				out.leb128(keys);
+				for (uint32_t key = 0; key < keys; key++)
+					out.leb128(strings[random.below(uint32_t(strings.size()))]);
+				break;
+			}
+			case CONSTANT_CLOSURE: {
+				out.leb128(children[random.below(uint32_t(children.size()))]);
+				break;
+			}
+			default: {
+				break;
+			}
+			}
+
+			constantsOfKind[kind].push_back(i);
+		}
+	}
+
+	std::vector<uint32_t> claimChildren(bool isMain) {
+		std::vector<uint32_t> children;
+
+		for (GeneratedProto& candidate : protos) {
+			if (candidate.claimed)
+				continue;
+
+			// The main proto adopts whatever is left so every proto is reachable
+			if (isMain || (candidate.height + 1 < options.maxDepth && random.chance(30))) {
+				candidate.claimed = true;
+				children.push_back(candidate.globalId);
+			}
+
+			if (!isMain && children.size() >= 3)
+				break;
+		}
+
+		return children;
+	}
+
+	void generateProto(Writer& out, uint32_t globalId, bool isMain) {
+		std::vector<uint32_t> children = claimChildren(isMain);
+
+		GeneratedProto proto;
+		proto.globalId = globalId;
+		proto.nups = isMain ? 0 : uint8_t(random.below(3));
+		for (uint32_t child : children)
+			proto.height = std::max(proto.height, protos[child].height + 1);
+
+		out.u8(16); // maxstacksize, registers are picked below 16
+		out.u8(uint8_t(random.below(4))); // numparams
+		out.u8(proto.nups);
+		out.u8(isMain ? 1 : uint8_t(random.chance(20)));
+
+		Writer constants;
+		writeConstants(constants, children);
+
+		std::vector<uint32_t> code = generateCode(children);
+
+		out.leb128(uint32_t(code.size()));
+		for (uint32_t instruction : code)
+			out.u32(instruction);
+
+		out.data += constants.data;
+
+		out.leb128(uint32_t(children.size()));
+		for (uint32_t child : children)
+			out.leb128(child);
+
+		out.leb128(1 + random.below(10000)); // linedefined
+		out.leb128(random.chance(70) ? stringId() : 0); // debugname
+
+		out.u8(options.lineInfo);
+		if (options.lineInfo) {
+			uint8_t linegaplog2 = uint8_t(2 + random.below(4));
+			out.u8(linegaplog2);
+
+			uint8_t lastOffset = 0;
+			for (size_t pc = 0; pc < code.size(); pc++) {
+				uint8_t offset = uint8_t(random.below(4));
+				out.u8(uint8_t(offset - lastOffset));
+				lastOffset = offset;
+			}
+
+			uint32_t intervals = uint32_t(((code.size() - 1) >> linegaplog2) + 1);
+			for (uint32_t i = 0; i < intervals; i++)
+				out.u32(i == 0 ? 1 + random.below(1000) : random.below(8));
+		}
+
+		out.u8(0); // debuginfo
+
+		protos.push_back(proto);
+	}
+
+	std::vector<uint32_t> generateCode(const std::vector<uint32_t>& children) {
+		std::vector<uint32_t> code;
+		std::vector<uint32_t> instructionStarts;
+		std::vector<uint32_t> jumps; // pcs of instructions whose D offset is filled in once all starts are known
+
+		auto emit = [&](uint32_t instruction) {
+			instructionStarts.push_back(uint32_t(code.size()));
+			code.push_back(instruction);
+		};
+		auto abc = [](uint8_t op, uint32_t a, uint32_t b, uint32_t c) {
+			return uint32_t(op) | (a << 8) | (b << 16) | (c << 24);
+		};
+		auto ad = [](uint8_t op, uint32_t a, int32_t d) {
+			return uint32_t(op) | (a << 8) | (uint32_t(uint16_t(d)) << 16);
+		};
+
+		if (random.chance(20))
+			emit(abc(LOP_PREPVARARGS, random.below(3), 0, 0));
+
+		uint32_t target = std::max(1u, options.instructionsPerProto / 2 + random.below(options.instructionsPerProto + 1));
+		while (instructionStarts.size() < target) {
+			const OpcodeInfo& info = pickOpcode();
+
+			switch (info.shape) {
+			case SHAPE_ABC: {
+				emit(abc(info.opcode, pickRegister(), pickRegister(), pickRegister()));
+				break;
+			}
+			case SHAPE_LOADN: {
+				emit(ad(info.opcode, pickRegister(), int32_t(random.below(65536)) - 32768));
+				break;
+			}
+			case SHAPE_LOADK: {
+				emit(ad(info.opcode, pickRegister(), pickConstant(random.chance(50) ? CONSTANT_NUMBER : CONSTANT_STRING)));
+				break;
+			}
+			case SHAPE_STRING_AUX: {
+				emit(abc(info.opcode, pickRegister(), pickRegister(), random.below(256)));
+				code.push_back(pickConstant(CONSTANT_STRING));
+				break;
+			}
+			case SHAPE_NAMECALL: {
+				uint32_t base = pickRegister();
+				emit(abc(info.opcode, base, pickRegister(), random.below(256)));
+				code.push_back(pickConstant(CONSTANT_STRING));
+				emit(abc(LOP_CALL, base, 2 + random.below(3), random.below(3)));
+				break;
+			}
+			case SHAPE_IMPORT: {
+				if (constantsOfKind[CONSTANT_IMPORT].empty())
+					break;
+				uint32_t constant = pickConstant(CONSTANT_IMPORT);
+				emit(ad(info.opcode, pickRegister(), constant));
+				code.push_back(importIds[constant]);
+				break;
+			}
+			case SHAPE_NUMBER_K: {
+				emit(abc(info.opcode, pickRegister(), pickRegister(), pickConstant(CONSTANT_NUMBER)));
+				break;
+			}
+			case SHAPE_ANY_K: {
+				emit(abc(info.opcode, pickRegister(), pickRegister(), pickConstant(random.chance(50) ? CONSTANT_NUMBER : CONSTANT_STRING)));
+				break;
+			}
+			case SHAPE_JUMP: {
+				jumps.push_back(uint32_t(code.size()));
+				emit(ad(info.opcode, pickRegister(), 0));
+				break;
+			}
+			case SHAPE_JUMP_AUX: {
+				jumps.push_back(uint32_t(code.size()));
+				emit(ad(info.opcode, pickRegister(), 0));
+				code.push_back(pickRegister());
+				break;
+			}
+			case SHAPE_JUMP_K: {
+				jumps.push_back(uint32_t(code.size()));
+				emit(ad(info.opcode, pickRegister(), 0));
+				code.push_back(pickConstant(random.chance(50) ? CONSTANT_NUMBER : CONSTANT_STRING));
+				break;
+			}
+			case SHAPE_LOADB: {
+				// Jumps over the following LOADB, the way comparisons compile
+				uint32_t reg = pickRegister();
+				emit(abc(info.opcode, reg, 0, 1));
+				emit(abc(info.opcode, reg, 1, 0));
+				break;
+			}
+			case SHAPE_CALL: {
+				emit(abc(info.opcode, pickRegister(), random.below(4), random.below(3)));
+				break;
+			}
+			case SHAPE_FASTCALL: {
+				// C skips to the CALL right after, counting the AUX word of FASTCALL2
+				bool hasAux = info.opcode == LOP_FASTCALL2;
+				emit(abc(info.opcode, 1 + random.below(40), pickRegister(), hasAux ? 1 : 0));
+				if (hasAux)
+					code.push_back(pickRegister());
+				emit(abc(LOP_CALL, pickRegister(), 2 + random.below(2), 2));
+				break;
+			}
+			case SHAPE_NEWTABLE: {
+				emit(abc(info.opcode, pickRegister(), random.below(8), 0));
+				code.push_back(random.below(16));
+				break;
+			}
+			case SHAPE_SETLIST: {
+				emit(abc(info.opcode, pickRegister(), pickRegister(), random.below(8)));
+				code.push_back(1 + random.below(64));
+				break;
+			}
+			case SHAPE_DUPTABLE: {
+				if (constantsOfKind[CONSTANT_TABLE].empty())
+					break;
+				emit(ad(info.opcode, pickRegister(), pickConstant(CONSTANT_TABLE)));
+				break;
+			}
+			case SHAPE_NEWCLOSURE: {
+				if (children.empty())
+					break;
+				uint32_t childIndex = random.below(uint32_t(children.size()));
+				emit(ad(info.opcode, pickRegister(), childIndex));
+				for (uint8_t i = 0; i < protos[children[childIndex]].nups; i++)
+					emit(abc(LOP_CAPTURE, random.below(3), pickRegister(), 0));
+				break;
+			}
+			case SHAPE_DUPCLOSURE: {
+				if (constantsOfKind[CONSTANT_CLOSURE].empty())
+					break;
+				emit(ad(info.opcode, pickRegister(), pickConstant(CONSTANT_CLOSURE)));
+				break;
+			}
+			}
+		}
+
+		emit(abc(LOP_RETURN, 0, 1, 0));
+
+		// Point every jump at a random instruction start, mostly close by like real control flow
+		for (uint32_t pc : jumps) {
+			size_t self = std::lower_bound(instructionStarts.begin(), instructionStarts.end(), pc) - instructionStarts.begin();
+			int32_t distance = int32_t(random.below(32)) - 8;
+			int64_t index = std::clamp<int64_t>(int64_t(self) + 1 + distance, 0, int64_t(instructionStarts.size()) - 1);
+
+			int32_t offset = int32_t(instructionStarts[size_t(index)]) - int32_t(pc) - 1;
+			code[pc] = (code[pc] & 0xffff) | (uint32_t(uint16_t(offset)) << 16);
+		}
+
+		return code;
+	}
+};
+
+static size_t parseSize(const std::string& value) {
+	char* end = nullptr;
+	double number = strtod(value.c_str(), &end);
+	switch (end && *end ? toupper(*end) : 0) {
+	case 'K': return size_t(number * 1024);
+	case 'M': return size_t(number * 1024 * 1024);
+	case 'G': return size_t(number * 1024 * 1024 * 1024);
+	default: return size_t(number);
+	}
+}
+
+static bool parseMix(const std::string& mix, std::vector<uint32_t>& weights) {
+	weights.assign(std::size(OPCODES), 0);
+
+	if (mix == "balanced") {
+		for (size_t i = 0; i < std::size(OPCODES); i++)
+			weights[i] = OPCODES[i].weight;
+		return true;
+	}
+
+	// Presets favour one family of instructions on top of a little of everything
+	if (mix == "arith" || mix == "calls" || mix == "branches" || mix == "tables") {
+		for (size_t i = 0; i < std::size(OPCODES); i++) {
+			InstructionShape shape = OPCODES[i].shape;
+			uint8_t op = OPCODES[i].opcode;
+
+			bool favoured =
+				(mix == "arith" && (shape == SHAPE_NUMBER_K || op == LOP_ADD || op == LOP_SUB || op == LOP_MUL || op == LOP_DIV)) ||
+				(mix == "calls" && (shape == SHAPE_CALL || shape == SHAPE_NAMECALL || shape == SHAPE_IMPORT || shape == SHAPE_FASTCALL)) ||
+				(mix == "branches" && (shape == SHAPE_JUMP || shape == SHAPE_JUMP_AUX || shape == SHAPE_JUMP_K || shape == SHAPE_LOADB)) ||
+				(mix == "tables" && (shape == SHAPE_STRING_AUX || shape == SHAPE_NEWTABLE || shape == SHAPE_SETLIST || shape == SHAPE_DUPTABLE));
+
+			weights[i] = OPCODES[i].weight * (favoured ? 10 : 1);
+		}
+		return true;
+	}
+
+	// NAME=weight,NAME=weight,...
+	size_t start = 0;
+	while (start < mix.size()) {
+		size_t end = mix.find(',', start);
+		if (end == std::string::npos)
+			end = mix.size();
+
+		std::string entry = mix.substr(start, end - start);
+		size_t equals = entry.find('=');
+		std::string name = entry.substr(0, equals);
+		uint32_t weight = equals == std::string::npos ? 1 : uint32_t(atoi(entry.c_str() + equals + 1));
+
+		auto it = std::find_if(std::begin(OPCODES), std::end(OPCODES), [&](const OpcodeInfo& info) { return name == info.name; });
+		if (it == std::end(OPCODES)) {
+			std::cerr << "unknown opcode in mix: " << name << '\n';
+			return false;
+		}
+		weights[it - std::begin(OPCODES)] = weight;
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+static bool parseConstantKinds(const std::string& list, bool (&kinds)[7]) {
+	std::fill(std::begin(kinds), std::end(kinds), false);
+
+	size_t start = 0;
+	while (start < list.size()) {
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+
+		std::string name = list.substr(start, end - start);
+		auto it = std::find_if(std::begin(CONSTANT_KIND_NAMES), std::end(CONSTANT_KIND_NAMES), [&](const char* kind) { return name == kind; });
+		if (it == std::end(CONSTANT_KIND_NAMES)) {
+			std::cerr << "unknown constant type: " << name << '\n';
+			return false;
+		}
+		kinds[it - std::begin(CONSTANT_KIND_NAMES)] = true;
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	GeneratorOptions options;
+	std::string outputPath = "corpus";
+	uint32_t fileCount = 1;
+	std::string mix = "balanced";
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		std::string value = i + 1 < argc ? argv[i + 1] : "";
+
+		if (arg == "--no-line-info") {
+			options.lineInfo = false;
+			continue;
+		}
+
+		if (value.empty()) {
+			std::cerr << "missing value for " << arg << '\n';
+			return 1;
+		}
+		i++;
+
+		if (arg == "--seed") {
+			options.seed = strtoull(value.c_str(), nullptr, 10);
+		} else if (arg == "--protos") {
+			options.protoCount = std::max(1, atoi(value.c_str()));
+		} else if (arg == "--instructions") {
+			options.instructionsPerProto = std::max(1, atoi(value.c_str()));
+		} else if (arg == "--strings") {
+			options.stringCount = std::max(1, atoi(value.c_str()));
+		} else if (arg == "--depth") {
+			options.maxDepth = std::max(1, atoi(value.c_str()));
+		} else if (arg == "--size") {
+			options.targetSize = parseSize(value);
+		} else if (arg == "--mix") {
+			mix = value;
+		} else if (arg == "--constants") {
+			if (!parseConstantKinds(value, options.constantKinds))
+				return 1;
+		} else if (arg == "--count") {
+			fileCount = std::max(1, atoi(value.c_str()));
+		} else if (arg == "--out") {
+			outputPath = value;
+		} else {
+			std::cerr <<
+				"usage: corpus_gen [--seed N] [--protos N] [--instructions N] [--strings N] [--depth N] [--size 64K|10M|...]\n"
+				"                  [--mix balanced|arith|calls|branches|tables|NAME=weight,...] [--constants nil,boolean,number,string,import,table,closure]\n"
+				"                  [--no-line-info] [--count N] [--out directory]\n";
+			return 1;
+		}
+	}
+
+	if (!parseMix(mix, options.opcodeWeights))
+		return 1;
+
+	// Keep the string table from dominating small size targets
+	if (options.targetSize)
+		options.stringCount = uint32_t(std::min<size_t>(options.stringCount, std::max<size_t>(8, options.targetSize / 64)));
+
+	std::filesystem::create_directories(outputPath);
+
+	uint64_t baseSeed = options.seed;
+	for (uint32_t i = 0; i < fileCount; i++) {
+		// Every file gets its own seed so a corpus is reproducible file by file
+		options.seed = baseSeed + i;
+
+		BytecodeGenerator generator(options);
+		std::string bytecode = generator.generate();
+
+		std::filesystem::path path = std::filesystem::path(outputPath) / ("synthetic_" + std::to_string(options.seed) + ".luac");
+		std::ofstream file(path, std::ios::binary);
+		file.write(bytecode.data(), std::streamsize(bytecode.size()));
+
+		printf("%s: %zu bytes\n", path.string().c_str(), bytecode.size());
+	}
+}
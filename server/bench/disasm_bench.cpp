@@ -0,0 +1,186 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <filesystem>
+#include <algorithm>
+#include <functional>
+
+#include "disassembler/bytecode.hpp"
+#include "disassembler/disassembler.hpp"
+#include "disassembler/scan.hpp"
+
+// Every allocation made by the process goes through these, so the benchmark can report allocations per request
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+void* operator new(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+struct CorpusFile {
+	std::string path;
+	std::string bytecode;
+	uint64_t instructions = 0;
+};
+
+static uint64_t countInstructions(const std::vector<LuauDisassembler::Proto*>& protoTable) {
+	uint64_t count = 0;
+	for (const LuauDisassembler::Proto* p : protoTable) {
+		for (size_t pc = 0; pc < p->code.size(); pc += getOpLength(LUAU_INSN_OP(p->code[pc])))
+			count++;
+	}
+	return count;
+}
+
+static void loadCorpus(const std::filesystem::path& path, std::vector<CorpusFile>& corpus) {
+	if (std::filesystem::is_directory(path)) {
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+			if (entry.is_regular_file())
+				loadCorpus(entry.path(), corpus);
+		}
+		return;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	CorpusFile corpusFile;
+	corpusFile.path = path.string();
+	corpusFile.bytecode.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	// Scanned like the server scans requests, so malformed files are skipped before any stage runs over them
+	try {
+		LuauDisassembler::scan_bytecode(corpusFile.bytecode.data(), corpusFile.bytecode.size());
+		std::vector<LuauDisassembler::Proto*> protoTable = LuauDisassembler::deserialize_bytecode(corpusFile.bytecode.data(), corpusFile.bytecode.size());
+		corpusFile.instructions = countInstructions(protoTable);
+		LuauDisassembler::free_protos(protoTable);
+	} catch (const std::exception& e) {
+		std::cerr << "skipping " << corpusFile.path << ": " << e.what() << '\n';
+		return;
+	}
+
+	corpus.push_back(std::move(corpusFile));
+}
+
+static void runStage(const char* name, const std::vector<CorpusFile>& corpus, int iterations, const std::function<void(size_t)>& run) {
+	uint64_t bytes = 0;
+	uint64_t instructions = 0;
+	for (const CorpusFile& file : corpus) {
+		bytes += file.bytecode.size();
+		instructions += file.instructions;
+	}
+
+	uint64_t allocationsBefore = allocationCount.load();
+	auto start = std::chrono::steady_clock::now();
+
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		for (size_t i = 0; i < corpus.size(); i++)
+			run(i);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t allocations = allocationCount.load() - allocationsBefore;
+	double requests = double(corpus.size()) * iterations;
+
+	printf(
+		"%-12s %10.2f MB/s %12.2f Minsn/s %12.1f allocs/request %10.3f ms/request\n",
+		name,
+		double(bytes) * iterations / seconds / (1 << 20),
+		double(instructions) * iterations / seconds / 1e6,
+		double(allocations) / requests,
+		seconds * 1000 / requests
+	);
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<CorpusFile> corpus;
+	int iterations = 10;
+	LuauDisassembler::DisassemblyOptions options;
+	bool useCache = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--iterations" && i + 1 < argc) {
+			iterations = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--line-info") {
+			options.displayLineInfo = true;
+		} else if (arg == "--json") {
+			options.format = LuauDisassembler::OutputFormat::Json;
+		} else if (arg == "--blocks") {
+			options.showBlocks = true;
+		} else if (arg == "--calls") {
+			options.annotateCalls = true;
+		} else if (arg == "--cache") {
+			useCache = true;
+		} else {
+			loadCorpus(arg, corpus);
+		}
+	}
+
+	if (corpus.empty()) {
+		std::cerr << "usage: disasm_bench [--iterations N] [--line-info] [--json] [--blocks] [--calls] [--cache] <corpus file or directory>...\n";
+		return 1;
+	}
+
+	uint64_t bytes = 0;
+	uint64_t instructions = 0;
+	for (const CorpusFile& file : corpus) {
+		bytes += file.bytecode.size();
+		instructions += file.instructions;
+	}
+	printf("corpus: %zu files, %.2f MB, %llu instructions, %d iterations\n", corpus.size(), double(bytes) / (1 << 20), (unsigned long long)instructions, iterations);
+
+	LuauDisassembler::ProtoCache protoCache(size_t(256) << 20);
+	LuauDisassembler::ProtoCache* cache = useCache ? &protoCache : nullptr;
+
+	runStage("deserialize", corpus, iterations, [&](size_t i) {
+		std::vector<LuauDisassembler::Proto*> protoTable = LuauDisassembler::deserialize_bytecode(corpus[i].bytecode.data(), corpus[i].bytecode.size(), options.displayLineInfo);
+		LuauDisassembler::free_protos(protoTable);
+	});
+
+	std::vector<std::vector<LuauDisassembler::Proto*>> deserialized;
+	for (const CorpusFile& file : corpus)
+		deserialized.push_back(LuauDisassembler::deserialize_bytecode(file.bytecode.data(), file.bytecode.size(), options.displayLineInfo));
+
+	size_t outputBytes = 0;
+	runStage("format", corpus, iterations, [&](size_t i) {
+		outputBytes += LuauDisassembler::render_protos(deserialized[i], corpus[i].bytecode.size() * 6, options, cache).size();
+	});
+
+	for (std::vector<LuauDisassembler::Proto*>& protoTable : deserialized)
+		LuauDisassembler::free_protos(protoTable);
+
+	runStage("disassemble", corpus, iterations, [&](size_t i) {
+		outputBytes += LuauDisassembler::disassemble(corpus[i].bytecode.c_str(), corpus[i].bytecode.size(), options, cache).size();
+	});
+
+	printf("output: %.2f MB per iteration\n", double(outputBytes) / (2.0 * iterations) / (1 << 20));
+}
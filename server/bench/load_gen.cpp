@@ -0,0 +1,569 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <filesystem>
+#include <algorithm>
+#include <utility>
+
+#include "src/config.hpp"
+#include "src/histogram.hpp"
+
+#include "websocketpp/client.hpp"
+#include "websocketpp/config/asio_no_tls_client.hpp"
+
+// Drives a running server with N websocket connections replaying a corpus, and reports throughput and latency percentiles
+// In closed loop every connection keeps a fixed number of requests outstanding, at a target rate requests are sent on a fixed
+// schedule regardless of responses and latency is measured from the scheduled send time, so a stalled server can't hide its
+// queueing delay by slowing the generator down
+// With a tcp:// or unix:// uri it speaks the server's length prefixed raw protocol instead, to compare per-request overhead
+// With --churn every connection is closed and reopened after each response, to measure how fast the server accepts
+
+using client = websocketpp::client<websocketpp::config::asio_client>;
+using Clock = std::chrono::steady_clock;
+using RawProtocol = boost::asio::generic::stream_protocol;
+
+struct Connection {
+	client::connection_ptr con;
+	websocketpp::connection_hdl hdl;
+	bool open = false;
+
+	// Raw transport: messages are a u32 little endian length and the bytes, written one at a time from the front of writes
+	std::unique_ptr<RawProtocol::socket> raw;
+	uint8_t header[4] = {};
+	std::string response;
+	std::deque<const std::string*> writes;
+	uint32_t generation = 0; // bumped when the socket is replaced, completions of the old one are ignored
+
+	// Churn: set while the connection is closed to be reopened
+	bool reconnecting = false;
+	Clock::time_point connectTime;
+
+	// Scheduled send times of requests still waiting for a response, responses arrive in request order
+	std::deque<Clock::time_point> pending;
+};
+
+struct LoadOptions {
+	std::string uri = "ws://127.0.0.1:" + std::to_string(DISASSEMBLER_DEFAULT_SERVER_PORT);
+	size_t connectionCount = 8;
+	size_t pipeline = 1;
+	double rate = 0; // requests per second over all connections, 0 for closed loop
+	double duration = 10;
+	double warmup = 1;
+	bool base64 = false;
+	bool churn = false; // reconnect after every response
+
+	bool isRaw() const { return uri.compare(0, 6, "tcp://") == 0 || uri.compare(0, 7, "unix://") == 0; }
+};
+
+struct LoadStats {
+	LatencyHistogram latency; // microseconds
+	uint64_t completed = 0;
+	uint64_t errorResponses = 0;
+	uint64_t sendFailures = 0;
+	uint64_t dropped = 0; // outstanding when their connection closed
+	uint64_t connectFailures = 0;
+	uint64_t reconnects = 0; // churn: connections opened in the measured window
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+};
+
+static void loadCorpus(const std::filesystem::path& path, std::vector<std::string>& corpus) {
+	if (std::filesystem::is_directory(path)) {
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+			if (entry.is_regular_file())
+				loadCorpus(entry.path(), corpus);
+		}
+		return;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+class LoadGenerator {
+public:
+	LoadGenerator(const LoadOptions& options, std::vector<std::string> payloads) : options(options), payloads(std::move(payloads)), connections(options.connectionCount) {
+		endpoint.clear_access_channels(websocketpp::log::alevel::all);
+		endpoint.clear_error_channels(websocketpp::log::elevel::all);
+		endpoint.init_asio();
+	}
+
+	bool run() {
+		if (options.isRaw() && !parseRawTarget())
+			return false;
+
+		for (size_t i = 0; i < connections.size(); i++) {
+			if (!connect(i))
+				return false;
+		}
+
+		endpoint.run();
+		return started;
+	}
+
+	void report() const {
+		double seconds = std::chrono::duration<double>(lastResponse - measureStart).count();
+		if (seconds <= 0)
+			seconds = options.duration;
+
+		const char* framing = options.isRaw() ? "raw length prefixed" : options.base64 ? "base64 text" : "binary";
+		printf("connections: %zu (%llu failed to connect), %s frames, ", connections.size(), (unsigned long long)stats.connectFailures, framing);
+		if (options.churn)
+			printf("reconnecting after every response, latency includes connecting\n");
+		else if (options.rate > 0)
+			printf("target %.0f req/s\n", options.rate);
+		else
+			printf("closed loop with %zu outstanding per connection\n", options.pipeline);
+
+		printf(
+			"requests: %llu completed, %llu error responses, %llu send failures, %llu dropped\n",
+			(unsigned long long)stats.completed,
+			(unsigned long long)stats.errorResponses,
+			(unsigned long long)stats.sendFailures,
+			(unsigned long long)stats.dropped
+		);
+		printf(
+			"throughput: %.1f req/s, %.2f MB/s sent, %.2f MB/s received\n",
+			double(stats.completed) / seconds,
+			double(stats.bytesSent) / seconds / (1 << 20),
+			double(stats.bytesReceived) / seconds / (1 << 20)
+		);
+
+		if (options.churn)
+			printf("connections: %llu opened, %.1f/s\n", (unsigned long long)stats.reconnects, double(stats.reconnects) / seconds);
+
+		const LatencyHistogram& latency = stats.latency;
+		printf(
+			"latency (ms): min %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f  mean %.3f\n",
+			double(latency.getMin()) / 1000,
+			double(latency.getPercentile(50)) / 1000,
+			double(latency.getPercentile(90)) / 1000,
+			double(latency.getPercentile(99)) / 1000,
+			double(latency.getPercentile(99.9)) / 1000,
+			double(latency.getMax()) / 1000,
+			latency.getMean() / 1000
+		);
+	}
+
+private:
+	const LoadOptions& options;
+	std::vector<std::string> payloads;
+	std::vector<Connection> connections;
+	client endpoint;
+	RawProtocol::endpoint rawTarget;
+	LoadStats stats;
+
+	size_t openCount = 0;
+	size_t finishedCount = 0; // connections that failed or closed
+	size_t nextPayload = 0;
+	size_t nextConnection = 0;
+	uint64_t scheduled = 0;
+	bool started = false;
+	bool stopping = false;
+
+	Clock::time_point startTime;
+	Clock::time_point measureStart;
+	Clock::time_point endTime;
+	Clock::time_point lastResponse;
+
+	bool connect(size_t index) {
+		Connection& connection = connections[index];
+		connection.connectTime = Clock::now();
+
+		if (options.isRaw()) {
+			connection.raw = std::make_unique<RawProtocol::socket>(endpoint.get_io_service());
+			connection.raw->async_connect(rawTarget, [this, index, tcp = options.uri[0] == 't'](const boost::system::error_code& ec) {
+				if (ec) {
+					onFail(index);
+					return;
+				}
+
+				boost::system::error_code optionError;
+				if (tcp)
+					connections[index].raw->set_option(boost::asio::ip::tcp::no_delay(true), optionError);
+
+				readRaw(index);
+				onOpen(index);
+			});
+			return true;
+		}
+
+		websocketpp::lib::error_code ec;
+		client::connection_ptr con = endpoint.get_connection(options.uri, ec);
+		if (ec) {
+			std::cerr << "invalid uri " << options.uri << ": " << ec.message() << '\n';
+			return false;
+		}
+
+		con->set_open_handler([this, index](websocketpp::connection_hdl) { onOpen(index); });
+		con->set_fail_handler([this, index](websocketpp::connection_hdl) { onFail(index); });
+		con->set_close_handler([this, index](websocketpp::connection_hdl) { onClose(index); });
+		con->set_message_handler([this, index](websocketpp::connection_hdl, client::message_ptr msg) { onMessage(index, msg); });
+
+		connection.con = con;
+		connection.hdl = con->get_handle();
+		endpoint.connect(con);
+		return true;
+	}
+
+	// Churn: closes the connection and opens a new one, which sends the next request once it is open
+	void reconnect(size_t index) {
+		Connection& connection = connections[index];
+		connection.reconnecting = true;
+
+		if (connection.raw) {
+			boost::system::error_code ec;
+			connection.raw->close(ec);
+			connection.writes.clear();
+			connection.generation++;
+			onClose(index);
+			return;
+		}
+
+		websocketpp::lib::error_code ec;
+		endpoint.close(connection.hdl, websocketpp::close::status::normal, "churn", ec);
+		if (ec)
+			onClose(index);
+	}
+
+	void onOpen(size_t index) {
+		Connection& connection = connections[index];
+		connection.open = true;
+
+		// A reopened churn connection, openCount still counts it
+		if (connection.reconnecting) {
+			connection.reconnecting = false;
+			if (connection.connectTime >= measureStart)
+				stats.reconnects++;
+
+			if (stopping) {
+				closeConnection(connection);
+				return;
+			}
+
+			send(connection, connection.connectTime);
+			return;
+		}
+
+		openCount++;
+		maybeStart();
+	}
+
+	void onFail(size_t index) {
+		stats.connectFailures++;
+
+		if (connections[index].reconnecting) {
+			connections[index].reconnecting = false;
+			openCount--;
+			if (!stopping && openCount == 0)
+				endpoint.stop();
+			return;
+		}
+
+		finishedCount++;
+		maybeStart();
+	}
+
+	void onClose(size_t index) {
+		Connection& connection = connections[index];
+		connection.open = false;
+		stats.dropped += connection.pending.size();
+		connection.pending.clear();
+
+		if (connection.reconnecting) {
+			if (!connect(index))
+				onFail(index);
+			return;
+		}
+
+		openCount--;
+		finishedCount++;
+		if (!stopping && openCount == 0)
+			endpoint.stop();
+	}
+
+	// Starts once every connection has either opened or failed, so the run measures the full concurrency
+	void maybeStart() {
+		if (started || openCount + finishedCount < connections.size())
+			return;
+
+		if (openCount == 0) {
+			std::cerr << "no connection to " << options.uri << " could be opened\n";
+			endpoint.stop();
+			return;
+		}
+
+		started = true;
+		startTime = Clock::now();
+		measureStart = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+		endTime = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+		if (options.rate > 0) {
+			tick();
+		} else {
+			for (Connection& connection : connections) {
+				for (size_t i = 0; connection.open && i < options.pipeline; i++)
+					send(connection, startTime);
+			}
+		}
+
+		endpoint.set_timer(long(std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count()), [this](const websocketpp::lib::error_code&) {
+			stopping = true;
+			drain(Clock::now() + std::chrono::seconds(10));
+		});
+	}
+
+	bool parseRawTarget() {
+		if (options.uri.compare(0, 7, "unix://") == 0) {
+			rawTarget = boost::asio::local::stream_protocol::endpoint(options.uri.substr(7));
+			return true;
+		}
+
+		std::string address = options.uri.substr(6);
+		size_t colon = address.rfind(':');
+		boost::system::error_code ec;
+		boost::asio::ip::address host = boost::asio::ip::make_address(address.substr(0, colon), ec);
+		if (ec || colon == std::string::npos) {
+			std::cerr << "invalid uri " << options.uri << ", expected tcp://address:port or unix://path\n";
+			return false;
+		}
+
+		rawTarget = boost::asio::ip::tcp::endpoint(host, uint16_t(atoi(address.c_str() + colon + 1)));
+		return true;
+	}
+
+	void readRaw(size_t index) {
+		Connection& connection = connections[index];
+		boost::asio::async_read(*connection.raw, boost::asio::buffer(connection.header), [this, index, generation = connection.generation](const boost::system::error_code& ec, size_t) {
+			Connection& connection = connections[index];
+			if (generation != connection.generation)
+				return;
+			if (ec) {
+				closeRaw(index);
+				return;
+			}
+
+			uint32_t length = uint32_t(connection.header[0]) | uint32_t(connection.header[1]) << 8 | uint32_t(connection.header[2]) << 16 | uint32_t(connection.header[3]) << 24;
+			connection.response.resize(length);
+			boost::asio::async_read(*connection.raw, boost::asio::buffer(connection.response), [this, index, generation](const boost::system::error_code& ec, size_t) {
+				if (generation != connections[index].generation)
+					return;
+				if (ec) {
+					closeRaw(index);
+					return;
+				}
+
+				onResponse(index, connections[index].response);
+				if (generation == connections[index].generation)
+					readRaw(index);
+			});
+		});
+	}
+
+	void writeRaw(size_t index) {
+		Connection& connection = connections[index];
+		boost::asio::async_write(*connection.raw, boost::asio::buffer(*connection.writes.front()), [this, index, generation = connection.generation](const boost::system::error_code& ec, size_t) {
+			Connection& connection = connections[index];
+			if (generation != connection.generation)
+				return;
+			if (ec) {
+				closeRaw(index);
+				return;
+			}
+
+			connection.writes.pop_front();
+			if (!connection.writes.empty())
+				writeRaw(index);
+		});
+	}
+
+	void closeRaw(size_t index) {
+		Connection& connection = connections[index];
+		if (!connection.open)
+			return;
+
+		boost::system::error_code ec;
+		connection.raw->close(ec);
+		connection.writes.clear();
+		onClose(index);
+	}
+
+	void send(Connection& connection, Clock::time_point scheduledTime) {
+		const std::string& payload = payloads[nextPayload++ % payloads.size()];
+
+		if (connection.raw) {
+			connection.writes.push_back(&payload);
+			if (connection.writes.size() == 1)
+				writeRaw(size_t(&connection - connections.data()));
+
+			connection.pending.push_back(scheduledTime);
+			stats.bytesSent += payload.size();
+			return;
+		}
+
+		websocketpp::lib::error_code ec;
+		endpoint.send(connection.hdl, payload, options.base64 ? websocketpp::frame::opcode::text : websocketpp::frame::opcode::binary, ec);
+		if (ec) {
+			stats.sendFailures++;
+			return;
+		}
+
+		connection.pending.push_back(scheduledTime);
+		stats.bytesSent += payload.size();
+	}
+
+	// Open loop: sends whatever the schedule says should have gone out by now, then checks again in a millisecond
+	void tick() {
+		if (stopping)
+			return;
+
+		Clock::time_point now = Clock::now();
+		uint64_t due = uint64_t(std::chrono::duration<double>(now - startTime).count() * options.rate);
+
+		while (scheduled < due) {
+			Clock::time_point scheduledTime = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(double(scheduled) / options.rate));
+			scheduled++;
+
+			for (size_t attempt = 0; attempt < connections.size(); attempt++) {
+				Connection& connection = connections[nextConnection++ % connections.size()];
+				if (connection.open) {
+					send(connection, scheduledTime);
+					break;
+				}
+			}
+		}
+
+		endpoint.set_timer(1, [this](const websocketpp::lib::error_code&) { tick(); });
+	}
+
+	void onMessage(size_t index, client::message_ptr msg) {
+		onResponse(index, msg->get_payload());
+	}
+
+	void onResponse(size_t index, const std::string& payload) {
+		Connection& connection = connections[index];
+		if (connection.pending.empty())
+			return;
+
+		Clock::time_point now = Clock::now();
+		Clock::time_point scheduledTime = connection.pending.front();
+		connection.pending.pop_front();
+
+		if (scheduledTime >= measureStart) {
+			stats.latency.record(uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now - scheduledTime).count()));
+			stats.completed++;
+			stats.bytesReceived += payload.size();
+			lastResponse = now;
+
+			// Requests without an options envelope get plain text responses, where failures start with this prefix
+			if (payload.compare(0, 9, "; error: ") == 0)
+				stats.errorResponses++;
+		}
+
+		if (stopping || options.rate > 0)
+			return;
+
+		if (options.churn)
+			reconnect(index);
+		else
+			send(connection, now);
+	}
+
+	// Waits for outstanding responses, giving up at the deadline, then closes every connection
+	void drain(Clock::time_point deadline) {
+		bool outstanding = false;
+		for (const Connection& connection : connections)
+			outstanding |= connection.open && !connection.pending.empty();
+
+		if (outstanding && Clock::now() < deadline) {
+			endpoint.set_timer(10, [this, deadline](const websocketpp::lib::error_code&) { drain(deadline); });
+			return;
+		}
+
+		for (Connection& connection : connections) {
+			if (!connection.open)
+				continue;
+
+			stats.dropped += connection.pending.size();
+			connection.pending.clear();
+			closeConnection(connection);
+		}
+
+		endpoint.stop();
+	}
+
+	void closeConnection(Connection& connection) {
+		if (connection.raw) {
+			closeRaw(size_t(&connection - connections.data()));
+			return;
+		}
+
+		websocketpp::lib::error_code ec;
+		endpoint.close(connection.hdl, websocketpp::close::status::normal, "done", ec);
+	}
+};
+
+int main(int argc, char* argv[]) {
+	LoadOptions options;
+	std::vector<std::string> corpus;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--uri" && i + 1 < argc) {
+			options.uri = argv[++i];
+		} else if (arg == "--connections" && i + 1 < argc) {
+			options.connectionCount = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--pipeline" && i + 1 < argc) {
+			options.pipeline = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--rate" && i + 1 < argc) {
+			options.rate = atof(argv[++i]);
+		} else if (arg == "--duration" && i + 1 < argc) {
+			options.duration = atof(argv[++i]);
+		} else if (arg == "--warmup" && i + 1 < argc) {
+			options.warmup = atof(argv[++i]);
+		} else if (arg == "--base64") {
+			options.base64 = true;
+		} else if (arg == "--churn") {
+			options.churn = true;
+		} else {
+			loadCorpus(arg, corpus);
+		}
+	}
+
+	if (corpus.empty()) {
+		std::cerr << "usage: load_gen [--uri ws://127.0.0.1:5395 | tcp://127.0.0.1:port | unix://path] [--connections N] [--rate requests/s | --pipeline N] [--duration s] [--warmup s] [--base64] [--churn] <corpus file or directory>...\n";
+		return 1;
+	}
+
+	if (options.churn && options.rate > 0) {
+		std::cerr << "--churn is closed loop, it can't be combined with --rate\n";
+		return 1;
+	}
+	if (options.churn)
+		options.pipeline = 1;
+
+	// Encoding happens up front so the generator measures the server, not itself
+	if (options.isRaw()) {
+		for (std::string& payload : corpus) {
+			uint32_t length = uint32_t(payload.size());
+			char header[4] = { char(length), char(length >> 8), char(length >> 16), char(length >> 24) };
+			payload.insert(0, header, sizeof(header));
+		}
+	} else if (options.base64) {
+		for (std::string& payload : corpus)
+			payload = websocketpp::base64_encode(payload);
+	}
+
+	LoadGenerator generator(options, std::move(corpus));
+	if (!generator.run())
+		return 1;
+
+	generator.report();
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "bytecode.hpp"
+#include "proto.hpp"
+
+namespace LuauDisassembler {
+	LuaImport dissect_import(uint32_t id, std::vector<LuaValue>& k);
+
+	// Thrown by CheckedReader when its buffer ends before what it is reading does
+	struct NeedMoreData {
+		size_t required; // buffer size needed to get further
+	};
+
+	// Reads from a buffer that may hold only part of the bytecode: running past the end of the buffer throws NeedMoreData,
+	// running past the end of the whole bytecode (limit bytes from the buffer start) or anything malformed throws std::runtime_error
+	struct CheckedReader {
+		const char* data;
+		size_t size;
+		size_t limit;
+		size_t offset = 0;
+
+		[[noreturn]] static void fail() {
+			throw std::runtime_error("Malformed bytecode");
+		}
+
+		void check(bool ok) {
+			if (!ok)
+				fail();
+		}
+
+		// Counts read from the input can't be trusted, but each element takes at least minimumSize bytes to encode
+		void checkCount(uint64_t count, size_t minimumSize) {
+			if (count > (limit - offset) / minimumSize)
+				fail();
+		}
+
+		void require(size_t count) {
+			if (count > limit - offset)
+				fail();
+			if (count > size - offset)
+				throw NeedMoreData{ offset + count };
+		}
+
+		uint8_t u8() {
+			require(1);
+			return uint8_t(data[offset++]);
+		}
+
+		template<typename T>
+		T read() {
+			require(sizeof(T));
+			T result;
+			memcpy(&result, data + offset, sizeof(T));
+			offset += sizeof(T);
+			return result;
+		}
+
+		uint32_t leb128() {
+			uint32_t result = 0;
+			uint32_t shift = 0;
+
+			uint8_t byte = 0;
+
+			do {
+				if (shift > 28)
+					fail();
+				byte = u8();
+				result |= uint32_t(byte & 127) << shift;
+				shift += 7;
+			} while (byte & 128);
+
+			return result;
+		}
+
+		const char* bytes(size_t count) {
+			require(count);
+			const char* result = data + offset;
+			offset += count;
+			return result;
+		}
+	};
+
+	// Instructions index constants and children by their operands, which the renderer and the other passes use as they are:
+	// every instruction has to fit in the code, every constant, import part and child it names has to exist, and captures have
+	// one of the three capture types
+	inline void check_operands(CheckedReader& reader, const Proto* p) {
+		const std::vector<uint32_t>& code = p->code;
+		size_t sizek = p->k.size();
+
+		for (size_t pc = 0; pc < code.size();) {
+			uint32_t instruction = code[pc];
+			uint8_t op = LUAU_INSN_OP(instruction);
+			size_t length = size_t(getOpLength(op));
+			reader.check(code.size() - pc >= length);
+			uint32_t aux = length > 1 ? code[pc + 1] : 0;
+
+			switch (op) {
+			case LOP_LOADK: {
+				reader.check(LUAU_INSN_D(instruction) >= 0 && size_t(LUAU_INSN_D(instruction)) < sizek);
+				break;
+			}
+			case LOP_GETIMPORT: {
+				uint32_t count = aux >> 30;
+				reader.check(count != 0);
+				for (uint32_t part = 0; part < count; part++)
+					reader.check(((aux >> (20 - part * 10)) & 1023) < sizek);
+				break;
+			}
+			case LOP_GETGLOBAL:
+			case LOP_SETGLOBAL:
+			case LOP_GETTABLEKS:
+			case LOP_SETTABLEKS:
+			case LOP_NAMECALL:
+			case LOP_LOADKX:
+			case LOP_FASTCALL2K:
+			case LOP_JUMPIFEQK:
+			case LOP_JUMPIFNOTEQK: {
+				reader.check(aux < sizek);
+				break;
+			}
+			case LOP_ADDK:
+			case LOP_SUBK:
+			case LOP_MULK:
+			case LOP_DIVK:
+			case LOP_MODK:
+			case LOP_POWK:
+			case LOP_ANDK:
+			case LOP_ORK: {
+				reader.check(LUAU_INSN_C(instruction) < sizek);
+				break;
+			}
+			case LOP_NEWCLOSURE: {
+				reader.check(LUAU_INSN_D(instruction) >= 0 && size_t(LUAU_INSN_D(instruction)) < p->p.size());
+				break;
+			}
+			case LOP_CAPTURE: {
+				reader.check(LUAU_INSN_A(instruction) < 3); // value, reference or upvalue
+				break;
+			}
+			default: {
+				break;
+			}
+			}
+
+			pc += length;
+		}
+	}
+
+	// Reads one proto, global id protoId, validating everything scan_bytecode does and the operands of its instructions, so
+	// a proto it returns is safe to render
+	inline Proto* read_proto(CheckedReader& reader, const std::vector<std::string>& stringTable, uint32_t protoId, bool keepLineInfo) {
+		// Owned until complete, a CheckedReader can throw half way through
+		std::unique_ptr<Proto> p = std::make_unique<Proto>();
+
+		p->maxstacksize = reader.u8();
+		p->numparams = reader.u8();
+		p->nups = reader.u8();
+		p->is_vararg = reader.u8();
+
+		uint32_t sizecode = reader.leb128();
+		reader.checkCount(sizecode, sizeof(uint32_t));
+		const char* code = reader.bytes(size_t(sizecode) * sizeof(uint32_t));
+		p->code.resize(sizecode);
+		if (sizecode)
+			memcpy(p->code.data(), code, size_t(sizecode) * sizeof(uint32_t));
+
+		uint32_t sizek = reader.leb128();
+		reader.checkCount(sizek, 1);
+		p->k.reserve(sizek);
+
+		for (uint32_t j = 0; j < sizek; j++) {
+			p->k.push_back(LuaValue());
+
+			uint8_t constantType = reader.u8();
+			LuaValue* constantValue = &p->k[j];
+			switch (constantType) {
+			case 0: { // nil
+				constantValue->type = LUA_TNIL;
+				break;
+			}
+			case 1: { // boolean
+				uint8_t v = reader.u8();
+				constantValue->type = LUA_TBOOLEAN;
+				constantValue->boolean = v;
+				break;
+			}
+			case 2: { // number
+				double v = reader.read<double>();
+				constantValue->type = LUA_TNUMBER;
+				constantValue->number = v;
+				break;
+			}
+			case 3: { // string
+				uint32_t id = reader.leb128();
+				reader.check(id != 0 && id <= stringTable.size());
+				constantValue->type = LUA_TSTRING;
+				constantValue->str = stringTable[id - 1];
+				break;
+			}
+			case 4: { // import
+				// Import paths index constants already read, up to and including this one
+				uint32_t iid = reader.read<uint32_t>();
+				uint32_t count = iid >> 30;
+				reader.check(count != 0);
+				for (uint32_t part = 0; part < count; part++)
+					reader.check(((iid >> (20 - part * 10)) & 1023) <= j);
+
+				constantValue->type = LUA_TIMPORT;
+				constantValue->import = dissect_import(iid, p->k);
+				break;
+			}
+			case 5: { // table
+				uint32_t keys = reader.leb128();
+				reader.checkCount(keys, 1);
+				constantValue->type = LUA_TTABLE;
+				constantValue->tableKeys.reserve(keys);
+				for (uint32_t i = 0; i < keys; ++i) {
+					constantValue->tableKeys.push_back(reader.leb128());
+				}
+				break;
+			}
+			case 6: { // closure
+				constantValue->type = LUA_TCLOSURE;
+				constantValue->closure = reader.leb128(); // fid
+				break;
+			}
+			default: {
+				throw std::runtime_error("Unknown constant type");
+				break;
+			}
+			}
+		}
+
+		// Children are written before their parents
+		uint32_t sizep = reader.leb128();
+		reader.checkCount(sizep, 1);
+		p->p.resize(sizep);
+		for (uint32_t j = 0; j < sizep; j++) {
+			p->p[j] = reader.leb128();
+			reader.check(p->p[j] < protoId);
+		}
+
+		check_operands(reader, p.get());
+
+		p->linedefined = reader.leb128();
+
+		uint32_t debugname_id = reader.leb128();
+		reader.check(debugname_id <= stringTable.size());
+		if (debugname_id)
+			p->debugname = stringTable[debugname_id - 1];
+
+		uint8_t lineinfo = reader.u8();
+		if (lineinfo) {
+			reader.check(sizecode > 0);
+
+			uint8_t linegaplog2 = reader.u8();
+			reader.check(linegaplog2 <= 31);
+
+			int intervals = int(((sizecode - 1) >> linegaplog2) + 1);
+			const char* lineOffsets = reader.bytes(sizecode);
+			const char* lineDeltas = reader.bytes(size_t(intervals) * sizeof(uint32_t));
+
+			// Without keepLineInfo nothing is going to look at the line info, so it is skipped over instead of building the tables
+			if (keepLineInfo) {
+				p->linegaplog2 = linegaplog2;
+
+				int absoffset = (sizecode + 3) & ~3;
+
+				p->sizelineinfo = absoffset + intervals * sizeof(int);
+				p->lineinfo = new uint8_t[p->sizelineinfo]();
+				p->abslineinfo = (int*)(p->lineinfo + absoffset);
+
+				uint8_t lastoffset = 0;
+				for (size_t j = 0; j < sizecode; j++) {
+					lastoffset += uint8_t(lineOffsets[j]);
+					p->lineinfo[j] = lastoffset;
+				}
+
+				int lastLine = 0;
+				for (int j = 0; j < intervals; j++) {
+					uint32_t delta;
+					memcpy(&delta, lineDeltas + j * sizeof(uint32_t), sizeof(delta));
+					lastLine += delta;
+					p->abslineinfo[j] = lastLine;
+				}
+			}
+		}
+
+		uint8_t debuginfo = reader.u8();
+		if (debuginfo) {
+			p->sizelocvars = reader.leb128();
+			reader.checkCount(p->sizelocvars, 4);
+			for (uint32_t j = 0; j < p->sizelocvars; j++) {
+				reader.leb128();
+				reader.leb128();
+				reader.leb128();
+				reader.u8();
+			}
+
+			p->sizeupvalues = reader.leb128();
+			reader.checkCount(p->sizeupvalues, 1);
+			for (uint32_t j = 0; j < p->sizeupvalues; j++)
+				reader.leb128();
+		}
+
+		return p.release();
+	}
+}
\ No newline at end of file
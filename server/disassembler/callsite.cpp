@@ -0,0 +1,329 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "bytecode.hpp"
+#include "callsite.hpp"
+
+namespace LuauDisassembler {
+	// Names of the builtins FASTCALL instructions refer to, by Luau's LuauBuiltinFunction ids
+	const char* BUILTIN_NAMES[] = {
+		"none", "assert",
+		"math.abs", "math.acos", "math.asin", "math.atan2", "math.atan", "math.ceil", "math.cosh", "math.cos", "math.deg",
+		"math.exp", "math.floor", "math.fmod", "math.frexp", "math.ldexp", "math.log10", "math.log", "math.max", "math.min",
+		"math.modf", "math.pow", "math.rad", "math.sinh", "math.sin", "math.sqrt", "math.tanh", "math.tan",
+		"bit32.arshift", "bit32.band", "bit32.bnot", "bit32.bor", "bit32.bxor", "bit32.btest", "bit32.extract",
+		"bit32.lrotate", "bit32.lshift", "bit32.replace", "bit32.rrotate", "bit32.rshift",
+		"type", "string.byte", "string.char", "string.len", "typeof", "string.sub",
+		"math.clamp", "math.sign", "math.round",
+		"rawset", "rawget", "rawequal", "table.insert", "table.unpack", "Vector3.new",
+		"bit32.countlz", "bit32.countrz", "select", "rawlen", "bit32.extract", "getmetatable", "setmetatable",
+	};
+
+	// Descriptions longer than this are cut, so a register built from itself over and over stays cheap to copy
+	constexpr size_t MAX_DESCRIPTION_SIZE = 96;
+
+	// Appended rather than "R" + std::to_string(index), which GCC 12 misreports as an overlapping memcpy (-Wrestrict)
+	static std::string getOperandName(char prefix, uint32_t index) {
+		std::string name(1, prefix);
+		name += std::to_string(index);
+		return name;
+	}
+
+	static std::string getBuiltinName(uint32_t id) {
+		if (id < sizeof(BUILTIN_NAMES) / sizeof(BUILTIN_NAMES[0]))
+			return BUILTIN_NAMES[id];
+		return "builtin " + std::to_string(id);
+	}
+
+	struct RegisterTracker {
+		const Proto* proto;
+
+		// A register's description is only valid while its block matches the block being walked
+		struct Register {
+			uint32_t block = UINT32_MAX;
+			bool method = false; // a NAMECALL target, called with the register after it as self
+			std::string description;
+		};
+		Register registers[256];
+		uint32_t block = 0;
+		uint32_t top = 0; // one past the highest register written in the block, for clearing everything from a register up
+
+		std::string get(uint32_t reg) const {
+			if (reg < 256 && registers[reg].block == block)
+				return registers[reg].description;
+			return getOperandName('R', reg);
+		}
+
+		bool isMethod(uint32_t reg) const {
+			return reg < 256 && registers[reg].block == block && registers[reg].method;
+		}
+
+		void set(uint32_t reg, std::string description, bool method = false) {
+			if (reg >= 256)
+				return;
+
+			if (description.size() > MAX_DESCRIPTION_SIZE) {
+				description.resize(MAX_DESCRIPTION_SIZE - 3);
+				description += "...";
+			}
+
+			registers[reg].block = block;
+			registers[reg].method = method;
+			registers[reg].description = std::move(description);
+			if (reg + 1 > top)
+				top = reg + 1;
+		}
+
+		void clear(uint32_t reg) {
+			if (reg < 256)
+				registers[reg].block = UINT32_MAX;
+		}
+
+		// Calls and loops overwrite every register from their base up
+		void clearFrom(uint32_t reg) {
+			for (; reg < top; reg++)
+				registers[reg].block = UINT32_MAX;
+		}
+
+		std::string getConstant(uint32_t index) const {
+			if (index >= proto->k.size())
+				return getOperandName('K', index);
+
+			const LuaValue& constant = proto->k[index];
+			switch (constant.type) {
+			case LUA_TNIL: {
+				return "nil";
+			}
+			case LUA_TBOOLEAN: {
+				return constant.boolean ? "true" : "false";
+			}
+			case LUA_TNUMBER: {
+				char buffer[32];
+				snprintf(buffer, sizeof(buffer), "%.14g", constant.number);
+				return buffer;
+			}
+			case LUA_TSTRING: {
+				return "'" + constant.str + "'";
+			}
+			case LUA_TIMPORT: {
+				return constant.import.displayString;
+			}
+			default: {
+				return getOperandName('K', index);
+			}
+			}
+		}
+
+		std::string getString(uint32_t index) const {
+			if (index < proto->k.size() && proto->k[index].type == LUA_TSTRING)
+				return proto->k[index].str;
+			return getOperandName('K', index);
+		}
+
+		// Registers [first, first + count), or from first to the top of the stack when count is negative
+		std::string getList(uint32_t first, int count) const {
+			std::string list;
+			for (int i = 0; i < count; i++) {
+				if (i != 0)
+					list += ", ";
+				list += get(first + i);
+			}
+
+			if (count < 0)
+				list = get(first) + ", ...";
+
+			return list;
+		}
+	};
+
+	std::vector<CallSiteNote> annotate_call_sites(const Proto* proto, const ControlFlowGraph& cfg) {
+		std::vector<CallSiteNote> notes;
+		const std::vector<uint32_t>& code = proto->code;
+
+		// Large enough that it doesn't belong on the stack
+		std::unique_ptr<RegisterTracker> tracker = std::make_unique<RegisterTracker>();
+		RegisterTracker& t = *tracker;
+		t.proto = proto;
+
+		for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+			const BasicBlock& block = cfg.blocks[b];
+
+			// Falling through from the previous block as its only way in (past a FASTCALL, say) keeps what is known
+			bool continues = block.predecessorCount == 1 && cfg.predecessors[block.predecessorOffset] == b - 1 && b != 0;
+			if (!continues) {
+				t.block = b;
+				t.top = 0;
+			}
+
+			for (uint32_t pc = block.startpc; pc < block.endpc; pc += getOpLength(LUAU_INSN_OP(code[pc]))) {
+				uint32_t instruction = code[pc];
+				uint32_t a = LUAU_INSN_A(instruction);
+				uint32_t aux = pc + 1 < code.size() ? code[pc + 1] : 0;
+
+				switch (LUAU_INSN_OP(instruction)) {
+				case LOP_LOADNIL: {
+					t.set(a, "nil");
+					break;
+				}
+				case LOP_LOADB: {
+					t.set(a, LUAU_INSN_B(instruction) ? "true" : "false");
+					break;
+				}
+				case LOP_LOADN: {
+					t.set(a, std::to_string(LUAU_INSN_D(instruction)));
+					break;
+				}
+				case LOP_LOADK: {
+					t.set(a, t.getConstant(uint32_t(LUAU_INSN_D(instruction))));
+					break;
+				}
+				case LOP_LOADKX: {
+					t.set(a, t.getConstant(aux));
+					break;
+				}
+				case LOP_MOVE: {
+					uint32_t source = LUAU_INSN_B(instruction);
+					t.set(a, t.get(source), t.isMethod(source));
+					break;
+				}
+				case LOP_GETGLOBAL: {
+					t.set(a, t.getString(aux));
+					break;
+				}
+				case LOP_GETUPVAL: {
+					t.set(a, "upvalue " + std::to_string(LUAU_INSN_B(instruction)));
+					break;
+				}
+				case LOP_GETIMPORT: {
+					t.set(a, t.getConstant(uint32_t(LUAU_INSN_D(instruction))));
+					break;
+				}
+				case LOP_GETTABLE: {
+					t.set(a, t.get(LUAU_INSN_B(instruction)) + "[" + t.get(LUAU_INSN_C(instruction)) + "]");
+					break;
+				}
+				case LOP_GETTABLEKS: {
+					t.set(a, t.get(LUAU_INSN_B(instruction)) + "." + t.getString(aux));
+					break;
+				}
+				case LOP_GETTABLEN: {
+					t.set(a, t.get(LUAU_INSN_B(instruction)) + "[" + std::to_string(LUAU_INSN_C(instruction) + 1) + "]");
+					break;
+				}
+				case LOP_NEWCLOSURE:
+				case LOP_DUPCLOSURE: {
+					// Child ids depend on where the proto sits in the script, so cached bodies can't mention them
+					t.set(a, "function");
+					break;
+				}
+				case LOP_NEWTABLE:
+				case LOP_DUPTABLE: {
+					t.set(a, "{}");
+					break;
+				}
+				case LOP_NAMECALL: {
+					std::string self = t.get(LUAU_INSN_B(instruction));
+					t.set(a + 1, self);
+					t.set(a, self + ":" + t.getString(aux), true);
+					break;
+				}
+				case LOP_CALL: {
+					uint32_t nargs = LUAU_INSN_B(instruction);
+					uint32_t nresults = LUAU_INSN_C(instruction);
+
+					// Method calls pass self in the first argument register, it is already part of the callee's description
+					bool method = t.isMethod(a);
+					uint32_t firstArgument = a + (method ? 2 : 1);
+					int count = nargs == 0 ? -1 : int(nargs) - 1 - (method ? 1 : 0);
+
+					std::string call = t.get(a) + "(" + (count == 0 ? std::string() : t.getList(firstArgument, count)) + ")";
+					notes.push_back({ pc, call });
+
+					t.clearFrom(a);
+					if (nresults == 2)
+						t.set(a, std::move(call));
+					break;
+				}
+				case LOP_RETURN: {
+					uint32_t nvalues = LUAU_INSN_B(instruction);
+					notes.push_back({ pc, nvalues == 1 ? std::string("return") : "return " + t.getList(a, nvalues == 0 ? -1 : int(nvalues) - 1) });
+					break;
+				}
+				case LOP_SETTABLEKS: {
+					notes.push_back({ pc, t.get(LUAU_INSN_B(instruction)) + "." + t.getString(aux) + " = " + t.get(a) });
+					break;
+				}
+				case LOP_FASTCALL: {
+					notes.push_back({ pc, getBuiltinName(a) });
+					break;
+				}
+				case LOP_FASTCALL1: {
+					notes.push_back({ pc, getBuiltinName(a) + "(" + t.get(LUAU_INSN_B(instruction)) + ")" });
+					break;
+				}
+				case LOP_FASTCALL2: {
+					notes.push_back({ pc, getBuiltinName(a) + "(" + t.get(LUAU_INSN_B(instruction)) + ", " + t.get(aux) + ")" });
+					break;
+				}
+				case LOP_FASTCALL2K: {
+					notes.push_back({ pc, getBuiltinName(a) + "(" + t.get(LUAU_INSN_B(instruction)) + ", " + t.getConstant(aux) + ")" });
+					break;
+				}
+				case LOP_GETVARARGS: {
+					t.clearFrom(a);
+					for (uint32_t i = 0; i + 1 < LUAU_INSN_B(instruction); i++)
+						t.set(a + i, "...");
+					break;
+				}
+				case LOP_FORNPREP:
+				case LOP_FORNLOOP:
+				case LOP_FORGLOOP:
+				case LOP_FORGPREP_INEXT:
+				case LOP_FORGLOOP_INEXT:
+				case LOP_FORGPREP_NEXT:
+				case LOP_FORGLOOP_NEXT: {
+					t.clearFrom(a);
+					break;
+				}
+				// Instructions that don't write a register
+				case LOP_NOP:
+				case LOP_BREAK:
+				case LOP_SETGLOBAL:
+				case LOP_SETUPVAL:
+				case LOP_CLOSEUPVALS:
+				case LOP_SETTABLE:
+				case LOP_SETTABLEN:
+				case LOP_SETLIST:
+				case LOP_JUMP:
+				case LOP_JUMPBACK:
+				case LOP_JUMPX:
+				case LOP_JUMPIF:
+				case LOP_JUMPIFNOT:
+				case LOP_JUMPIFEQ:
+				case LOP_JUMPIFLE:
+				case LOP_JUMPIFLT:
+				case LOP_JUMPIFNOTEQ:
+				case LOP_JUMPIFNOTLE:
+				case LOP_JUMPIFNOTLT:
+				case LOP_JUMPIFEQK:
+				case LOP_JUMPIFNOTEQK:
+				case LOP_PREPVARARGS:
+				case LOP_COVERAGE:
+				case LOP_CAPTURE: {
+					break;
+				}
+				// Arithmetic, logic, CONCAT and the rest write A with something that isn't worth describing
+				default: {
+					t.clear(a);
+					break;
+				}
+				}
+			}
+		}
+
+		return notes;
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "proto.hpp"
+#include "cfg.hpp"
+
+namespace LuauDisassembler {
+	// What a CALL, SETTABLEKS, RETURN or FASTCALL instruction works on, e.g. game:GetService('Players') or
+	// script.Parent.Name = 'Door', in terms of where its registers were last written
+	struct CallSiteNote {
+		uint32_t pc = 0;
+		std::string text;
+	};
+
+	// Tracks which import, global, key chain, method, constant or call result last wrote each register, one basic block at a
+	// time; a block continues its predecessor's state only when it is entered from there alone. Registers written elsewhere
+	// show up as R<n>. Linear in the code size, descriptions are capped so long key chains don't make it quadratic
+	// Notes come out in pc order
+	std::vector<CallSiteNote> annotate_call_sites(const Proto* proto, const ControlFlowGraph& cfg);
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace LuauDisassembler {
+	// Lets whoever runs a request stop it from outside, the deserializer and the renderer check it between protos
+	struct CancellationToken {
+		using Clock = std::chrono::steady_clock;
+
+		// Set once nobody wants the response any more, like when the client disconnected: work stops and the request ends with
+		// a cancellation error
+		const std::atomic<bool>* cancelled = nullptr;
+
+		// Past the deadline, output stops where it is with a truncation marker
+		Clock::time_point deadline = Clock::time_point::max();
+
+		bool isCancelled() const {
+			return cancelled && cancelled->load(std::memory_order_relaxed);
+		}
+
+		bool isExpired() const {
+			return deadline != Clock::time_point::max() && Clock::now() >= deadline;
+		}
+	};
+
+	// Thrown out of work stopped by its token
+	class RequestCancelled : public std::runtime_error {
+	public:
+		explicit RequestCancelled(bool expired) : std::runtime_error(expired ? "Deadline exceeded" : "Request cancelled"), expired(expired) {}
+
+		bool expired; // the deadline passed, as opposed to the request being cancelled
+	};
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "bytecode.hpp"
+#include "cfg.hpp"
+
+namespace LuauDisassembler {
+	uint32_t ControlFlowGraph::blockForPc(uint32_t pc) const {
+		auto it = std::upper_bound(blocks.begin(), blocks.end(), pc, [](uint32_t value, const BasicBlock& block) {
+			return value < block.startpc;
+		});
+
+		return it == blocks.begin() ? 0 : uint32_t(it - blocks.begin() - 1);
+	}
+
+	int getJumpTarget(const std::vector<uint32_t>& code, size_t pc) {
+		uint32_t instruction = code[pc];
+
+		switch (LUAU_INSN_OP(instruction)) {
+		case LOP_JUMP:
+		case LOP_JUMPBACK:
+		case LOP_JUMPIF:
+		case LOP_JUMPIFNOT:
+		case LOP_JUMPIFEQ:
+		case LOP_JUMPIFLE:
+		case LOP_JUMPIFLT:
+		case LOP_JUMPIFNOTEQ:
+		case LOP_JUMPIFNOTLE:
+		case LOP_JUMPIFNOTLT:
+		case LOP_JUMPIFEQK:
+		case LOP_JUMPIFNOTEQK:
+		case LOP_FORNPREP:
+		case LOP_FORNLOOP:
+		case LOP_FORGLOOP:
+		case LOP_FORGPREP_INEXT:
+		case LOP_FORGLOOP_INEXT:
+		case LOP_FORGPREP_NEXT:
+		case LOP_FORGLOOP_NEXT: {
+			return int(pc) + 1 + LUAU_INSN_D(instruction);
+		}
+		case LOP_JUMPX: {
+			return int(pc) + 1 + LUAU_INSN_E(instruction);
+		}
+		case LOP_LOADB: {
+			uint32_t jumpOffset = LUAU_INSN_C(instruction);
+			return jumpOffset > 0 ? int(pc + 1 + jumpOffset) : -1;
+		}
+		case LOP_FASTCALL:
+		case LOP_FASTCALL1:
+		case LOP_FASTCALL2:
+		case LOP_FASTCALL2K: {
+			// C counts the words up to the following CALL (including our AUX word), a successful fast call resumes after that CALL
+			return int(pc + LUAU_INSN_C(instruction) + 2);
+		}
+		default: {
+			return -1;
+		}
+		}
+	}
+
+	// Whether control never falls through to the next instruction
+	static bool isUnconditionalTransfer(uint32_t instruction) {
+		switch (LUAU_INSN_OP(instruction)) {
+		case LOP_JUMP:
+		case LOP_JUMPBACK:
+		case LOP_JUMPX:
+		case LOP_FORGPREP_INEXT:
+		case LOP_FORGPREP_NEXT:
+		case LOP_RETURN: {
+			return true;
+		}
+		case LOP_LOADB: {
+			return LUAU_INSN_C(instruction) > 0;
+		}
+		default: {
+			return false;
+		}
+		}
+	}
+
+	ControlFlowGraph build_cfg(const Proto* proto) {
+		const std::vector<uint32_t>& code = proto->code;
+		uint32_t sizecode = uint32_t(code.size());
+
+		ControlFlowGraph cfg;
+		if (sizecode == 0)
+			return cfg;
+
+		// Pass 1: mark leaders (entry, jump targets and instructions following a branch)
+		std::vector<uint32_t> blockIndex(sizecode, UINT32_MAX);
+		const uint32_t LEADER = UINT32_MAX - 1;
+
+		blockIndex[0] = LEADER;
+		for (uint32_t pc = 0; pc < sizecode; pc += getOpLength(LUAU_INSN_OP(code[pc]))) {
+			uint32_t instruction = code[pc];
+			uint32_t next = pc + getOpLength(LUAU_INSN_OP(instruction));
+
+			int target = getJumpTarget(code, pc);
+			if (target >= 0 && uint32_t(target) < sizecode)
+				blockIndex[target] = LEADER;
+
+			if ((target >= 0 || LUAU_INSN_OP(instruction) == LOP_RETURN) && next < sizecode)
+				blockIndex[next] = LEADER;
+		}
+
+		// Pass 2: cut the code into blocks at the leaders
+		for (uint32_t pc = 0; pc < sizecode; pc += getOpLength(LUAU_INSN_OP(code[pc]))) {
+			if (blockIndex[pc] == LEADER) {
+				if (!cfg.blocks.empty())
+					cfg.blocks.back().endpc = pc;
+
+				blockIndex[pc] = uint32_t(cfg.blocks.size());
+
+				BasicBlock block;
+				block.startpc = pc;
+				cfg.blocks.push_back(block);
+			}
+
+			cfg.blocks.back().terminatorpc = pc;
+		}
+		cfg.blocks.back().endpc = sizecode;
+
+		// Pass 3: successor edges, at most two per block, laid out in block order
+		std::vector<uint32_t> predecessorCounts(cfg.blocks.size(), 0);
+		cfg.successors.reserve(cfg.blocks.size() * 2);
+
+		for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+			BasicBlock& block = cfg.blocks[b];
+			uint32_t instruction = code[block.terminatorpc];
+
+			block.successorOffset = uint32_t(cfg.successors.size());
+
+			int target = getJumpTarget(code, block.terminatorpc);
+			if (target >= 0 && uint32_t(target) < sizecode && blockIndex[target] < LEADER) {
+				cfg.successors.push_back(blockIndex[target]);
+				predecessorCounts[blockIndex[target]]++;
+			}
+
+			if (!isUnconditionalTransfer(instruction) && block.endpc < sizecode) {
+				uint32_t fallthrough = b + 1;
+				if (cfg.successors.size() == block.successorOffset || cfg.successors.back() != fallthrough) {
+					cfg.successors.push_back(fallthrough);
+					predecessorCounts[fallthrough]++;
+				}
+			}
+
+			block.successorCount = uint32_t(cfg.successors.size()) - block.successorOffset;
+		}
+
+		// Pass 4: predecessor edges via a counting sort over the successor lists
+		uint32_t offset = 0;
+		for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+			cfg.blocks[b].predecessorOffset = offset;
+			offset += predecessorCounts[b];
+		}
+
+		cfg.predecessors.resize(offset);
+		for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+			const BasicBlock& block = cfg.blocks[b];
+			for (uint32_t i = 0; i < block.successorCount; i++) {
+				BasicBlock& successor = cfg.blocks[cfg.successors[block.successorOffset + i]];
+				cfg.predecessors[successor.predecessorOffset + successor.predecessorCount++] = b;
+			}
+		}
+
+		return cfg;
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "proto.hpp"
+
+namespace LuauDisassembler {
+	struct BasicBlock {
+		uint32_t startpc = 0;
+		uint32_t endpc = 0; // exclusive
+		uint32_t terminatorpc = 0; // pc of the last instruction in the block
+
+		// Ranges into ControlFlowGraph::successors/predecessors
+		uint32_t successorOffset = 0;
+		uint32_t successorCount = 0;
+		uint32_t predecessorOffset = 0;
+		uint32_t predecessorCount = 0;
+	};
+
+	struct ControlFlowGraph {
+		std::vector<BasicBlock> blocks;
+		std::vector<uint32_t> successors;
+		std::vector<uint32_t> predecessors;
+
+		// Index of the block containing pc (binary search over block starts)
+		uint32_t blockForPc(uint32_t pc) const;
+	};
+
+	// Returns the pc an instruction can transfer control to, or -1 if it doesn't branch
+	// pc is the index of the instruction itself, targets of AUX instructions account for the AUX word
+	int getJumpTarget(const std::vector<uint32_t>& code, size_t pc);
+
+	// Builds the basic blocks of a proto in a couple of linear passes over its code
+	ControlFlowGraph build_cfg(const Proto* proto);
+}
\ No newline at end of file
@@ -0,0 +1,446 @@
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+
+#include "bytecode.hpp"
+#include "hash.hpp"
+#include "disassembler.hpp"
+#include "normalize.hpp"
+#include "diff.hpp"
+
+namespace LuauDisassembler {
+	std::vector<Edit> diff_sequences(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, uint32_t maxEdits) {
+		uint32_t n = uint32_t(a.size());
+		uint32_t m = uint32_t(b.size());
+
+		// Unchanged heads and tails are the common case and don't need the quadratic machinery
+		uint32_t prefix = 0;
+		while (prefix < n && prefix < m && a[prefix] == b[prefix])
+			prefix++;
+
+		uint32_t suffix = 0;
+		while (suffix < n - prefix && suffix < m - prefix && a[n - 1 - suffix] == b[m - 1 - suffix])
+			suffix++;
+
+		int N = int(n - prefix - suffix);
+		int M = int(m - prefix - suffix);
+
+		std::vector<Edit> middle;
+		bool found = N == 0 || M == 0;
+
+		if (!found) {
+			int limit = std::min(N + M, int(maxEdits));
+			int offset = limit + 1;
+
+			// v[k + offset] is the furthest x reached on diagonal k
+			std::vector<int> v(2 * size_t(limit) + 3, 0);
+
+			// Snapshot of v[-d..d] at the start of every round d, for backtracking
+			std::vector<int> trace;
+			std::vector<size_t> traceOffsets;
+
+			int lastRound = -1;
+			for (int d = 0; d <= limit && lastRound < 0; d++) {
+				traceOffsets.push_back(trace.size());
+				trace.insert(trace.end(), v.begin() + (offset - d), v.begin() + (offset + d + 1));
+
+				for (int k = -d; k <= d; k += 2) {
+					int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+					int y = x - k;
+
+					while (x < N && y < M && a[prefix + x] == b[prefix + y]) {
+						x++;
+						y++;
+					}
+
+					v[offset + k] = x;
+
+					if (x >= N && y >= M) {
+						lastRound = d;
+						break;
+					}
+				}
+			}
+
+			if (lastRound >= 0) {
+				found = true;
+
+				int x = N;
+				int y = M;
+				for (int d = lastRound; d > 0; d--) {
+					const int* vd = trace.data() + traceOffsets[d] + d; // vd[k] for k in -d..d
+					int k = x - y;
+
+					int previousK = (k == -d || (k != d && vd[k - 1] < vd[k + 1])) ? k + 1 : k - 1;
+					int previousX = vd[previousK];
+					int previousY = previousX - previousK;
+
+					while (x > previousX && y > previousY) {
+						x--;
+						y--;
+						middle.push_back({ EditOp::Equal, uint32_t(x), uint32_t(y) });
+					}
+
+					if (x == previousX) {
+						y--;
+						middle.push_back({ EditOp::Insert, uint32_t(x), uint32_t(y) });
+					}
+					else {
+						x--;
+						middle.push_back({ EditOp::Delete, uint32_t(x), uint32_t(y) });
+					}
+				}
+
+				while (x > 0 && y > 0) {
+					x--;
+					y--;
+					middle.push_back({ EditOp::Equal, uint32_t(x), uint32_t(y) });
+				}
+
+				std::reverse(middle.begin(), middle.end());
+			}
+		}
+
+		if (!found || N == 0 || M == 0) {
+			// Too different to be worth aligning (or one side is empty): replace the middle wholesale
+			middle.clear();
+			for (int i = 0; i < N; i++)
+				middle.push_back({ EditOp::Delete, uint32_t(i), 0 });
+			for (int j = 0; j < M; j++)
+				middle.push_back({ EditOp::Insert, uint32_t(N), uint32_t(j) });
+		}
+
+		std::vector<Edit> edits;
+		edits.reserve(prefix + middle.size() + suffix);
+
+		for (uint32_t i = 0; i < prefix; i++)
+			edits.push_back({ EditOp::Equal, i, i });
+
+		for (Edit edit : middle) {
+			edit.oldIndex += prefix;
+			edit.newIndex += prefix;
+			edits.push_back(edit);
+		}
+
+		for (uint32_t i = 0; i < suffix; i++)
+			edits.push_back({ EditOp::Equal, n - suffix + i, m - suffix + i });
+
+		return edits;
+	}
+
+	const int32_t UNMATCHED = -1;
+
+	// New protos sharing a key, by id; next skips the ones already matched, so each candidate is looked at once per map
+	struct MatchCandidates {
+		std::vector<uint32_t> ids;
+		size_t next = 0;
+	};
+
+	static int32_t takeCandidate(std::unordered_map<uint64_t, MatchCandidates>& candidates, uint64_t key, const std::vector<int32_t>& newMatches) {
+		auto it = candidates.find(key);
+		if (it == candidates.end())
+			return UNMATCHED;
+
+		MatchCandidates& match = it->second;
+		while (match.next < match.ids.size() && newMatches[match.ids[match.next]] != UNMATCHED)
+			match.next++;
+
+		return match.next < match.ids.size() ? int32_t(match.ids[match.next++]) : UNMATCHED;
+	}
+
+	static uint64_t getNamedKey(uint64_t hash, const std::string& debugname) {
+		Hasher h;
+		h.add(hash);
+		h.add(debugname);
+		return h.finish();
+	}
+
+	struct ProtoDiffContext {
+		const std::vector<Proto*>& oldProtos;
+		const std::vector<Proto*>& newProtos;
+		const std::vector<uint64_t>& oldShapes;
+		const std::vector<uint64_t>& newShapes;
+		const DisassemblyOptions& options;
+		bool json;
+	};
+
+	static std::vector<uint32_t> getInstructionStarts(const Proto* p) {
+		std::vector<uint32_t> starts;
+		starts.reserve(p->code.size());
+		for (size_t pc = 0; pc < p->code.size(); pc += getOpLength(LUAU_INSN_OP(p->code[pc])))
+			starts.push_back(uint32_t(pc));
+		return starts;
+	}
+
+	static void appendDiffLine(std::string& output, const ProtoDiffContext& context, char op, Proto* p, uint32_t pc, bool& first) {
+		size_t instructionPc = pc;
+
+		if (context.json) {
+			if (!first)
+				output += ',';
+			output += "{\"op\":\"";
+			output += op;
+			output += "\",\"pc\":" + std::to_string(pc) + ",\"text\":";
+			appendJsonString(output, getInstructionText(p, instructionPc));
+			output += '}';
+		}
+		else {
+			output += op;
+			output += ' ';
+			output += getStringForInstruction(p, instructionPc, context.options.displayLineInfo);
+			output += '\n';
+		}
+
+		first = false;
+	}
+
+	static void appendChangedProto(std::string& output, const ProtoDiffContext& context, uint32_t oldId, uint32_t newId) {
+		Proto* oldProto = context.oldProtos[oldId];
+		Proto* newProto = context.newProtos[newId];
+
+		std::vector<uint32_t> oldStarts = getInstructionStarts(oldProto);
+		std::vector<uint32_t> newStarts = getInstructionStarts(newProto);
+
+		std::vector<uint64_t> oldInstructions(oldStarts.size());
+		for (size_t i = 0; i < oldStarts.size(); i++)
+			oldInstructions[i] = hash_instruction(oldProto, oldStarts[i], context.oldShapes);
+
+		std::vector<uint64_t> newInstructions(newStarts.size());
+		for (size_t i = 0; i < newStarts.size(); i++)
+			newInstructions[i] = hash_instruction(newProto, newStarts[i], context.newShapes);
+
+		std::vector<Edit> edits = diff_sequences(oldInstructions, newInstructions);
+
+		if (context.json) {
+			output += "{\"old\":" + std::to_string(oldId) + ",\"new\":" + std::to_string(newId) + ",\"name\":";
+			appendJsonString(output, newProto->debugname);
+			output += ",\"lines\":[";
+		}
+		else {
+			output += "\n; changed proto " + std::to_string(oldId) + " -> " + std::to_string(newId) + ": " + newProto->debugname +
+				" (linedefined " + std::to_string(oldProto->linedefined) + " -> " + std::to_string(newProto->linedefined) + ")\n";
+		}
+
+		// Only changed instructions are shown, with a couple of unchanged ones around each change for context
+		const size_t CONTEXT_LINES = 2;
+
+		std::vector<bool> shown(edits.size(), false);
+		for (size_t i = 0; i < edits.size(); i++) {
+			if (edits[i].op == EditOp::Equal)
+				continue;
+
+			size_t first = i >= CONTEXT_LINES ? i - CONTEXT_LINES : 0;
+			size_t last = std::min(edits.size() - 1, i + CONTEXT_LINES);
+			for (size_t j = first; j <= last; j++)
+				shown[j] = true;
+		}
+
+		bool firstLine = true;
+		for (size_t i = 0; i < edits.size(); i++) {
+			if (!shown[i])
+				continue;
+
+			if (!context.json && i > 0 && !shown[i - 1])
+				output += "...\n";
+
+			const Edit& edit = edits[i];
+			switch (edit.op) {
+			case EditOp::Equal: {
+				appendDiffLine(output, context, ' ', newProto, newStarts[edit.newIndex], firstLine);
+				break;
+			}
+			case EditOp::Delete: {
+				appendDiffLine(output, context, '-', oldProto, oldStarts[edit.oldIndex], firstLine);
+				break;
+			}
+			case EditOp::Insert: {
+				appendDiffLine(output, context, '+', newProto, newStarts[edit.newIndex], firstLine);
+				break;
+			}
+			}
+		}
+
+		if (context.json)
+			output += "]}";
+	}
+
+	static void appendAddedProto(std::string& output, const ProtoDiffContext& context, uint32_t newId) {
+		Proto* p = context.newProtos[newId];
+
+		if (context.json) {
+			output += "{\"id\":" + std::to_string(newId) + ",\"name\":";
+			appendJsonString(output, p->debugname);
+			output += ",\"lines\":[";
+		}
+		else {
+			output += "\n; added proto " + std::to_string(newId) + ": " + p->debugname + " (linedefined " + std::to_string(p->linedefined) + ")\n";
+		}
+
+		bool firstLine = true;
+		for (uint32_t pc : getInstructionStarts(p))
+			appendDiffLine(output, context, '+', p, pc, firstLine);
+
+		if (context.json)
+			output += "]}";
+	}
+
+	static void appendRemovedProto(std::string& output, const ProtoDiffContext& context, uint32_t oldId) {
+		Proto* p = context.oldProtos[oldId];
+
+		if (context.json) {
+			output += "{\"id\":" + std::to_string(oldId) + ",\"name\":";
+			appendJsonString(output, p->debugname);
+			output += '}';
+		}
+		else {
+			output += "\n; removed proto " + std::to_string(oldId) + ": " + p->debugname + " (linedefined " + std::to_string(p->linedefined) + ")\n";
+		}
+	}
+
+	std::string diff_bytecode(const char* oldBytecode, size_t oldSize, const char* newBytecode, size_t newSize, const DisassemblyOptions& options) {
+		std::vector<Proto*> oldProtos = deserialize_bytecode(oldBytecode, oldSize, options.displayLineInfo);
+		ProtoTableOwner oldOwner{ oldProtos };
+		std::vector<Proto*> newProtos = deserialize_bytecode(newBytecode, newSize, options.displayLineInfo);
+		ProtoTableOwner newOwner{ newProtos };
+
+		// Full hashes cover a proto's children, own hashes only their shape, so a changed closure doesn't mark its parents
+		std::vector<uint64_t> oldHashes = hash_protos(oldProtos);
+		std::vector<uint64_t> newHashes = hash_protos(newProtos);
+		std::vector<uint64_t> oldShapes = hash_proto_shapes(oldProtos);
+		std::vector<uint64_t> newShapes = hash_proto_shapes(newProtos);
+		std::vector<uint64_t> oldOwnHashes = hash_protos(oldProtos, oldShapes);
+		std::vector<uint64_t> newOwnHashes = hash_protos(newProtos, newShapes);
+
+		std::vector<int32_t> oldMatches(oldProtos.size(), UNMATCHED);
+		std::vector<int32_t> newMatches(newProtos.size(), UNMATCHED);
+
+		// Pass 1: identical content with its children, wherever the proto moved to, then identical content of its own
+		// Candidates with the same name go first
+		auto matchByHash = [&](const std::vector<uint64_t>& oldKeys, const std::vector<uint64_t>& newKeys) {
+			std::unordered_map<uint64_t, MatchCandidates> newByHash, newByNamedHash;
+			for (uint32_t i = 0; i < newProtos.size(); i++) {
+				if (newMatches[i] != UNMATCHED)
+					continue;
+
+				newByHash[newKeys[i]].ids.push_back(i);
+				newByNamedHash[getNamedKey(newKeys[i], newProtos[i]->debugname)].ids.push_back(i);
+			}
+
+			for (uint32_t i = 0; i < oldProtos.size(); i++) {
+				if (oldMatches[i] != UNMATCHED)
+					continue;
+
+				int32_t match = takeCandidate(newByNamedHash, getNamedKey(oldKeys[i], oldProtos[i]->debugname), newMatches);
+				if (match == UNMATCHED)
+					match = takeCandidate(newByHash, oldKeys[i], newMatches);
+
+				if (match != UNMATCHED) {
+					oldMatches[i] = match;
+					newMatches[match] = int32_t(i);
+				}
+			}
+		};
+
+		matchByHash(oldHashes, newHashes);
+		matchByHash(oldOwnHashes, newOwnHashes);
+
+		// Pass 2 and 3: same function with different content, by debugname and linedefined, then by debugname alone
+		// Anonymous functions are only matched by position since their name says nothing
+		for (int pass = 0; pass < 2; pass++) {
+			std::unordered_map<std::string, std::vector<uint32_t>> newByName;
+			for (uint32_t i = newProtos.size(); i-- > 0;) {
+				if (newMatches[i] != UNMATCHED || (pass == 1 && newProtos[i]->debugname == "UNNAMED"))
+					continue;
+
+				std::string key = newProtos[i]->debugname;
+				if (pass == 0)
+					key += '@' + std::to_string(newProtos[i]->linedefined);
+
+				newByName[key].push_back(i);
+			}
+
+			for (uint32_t i = 0; i < oldProtos.size(); i++) {
+				if (oldMatches[i] != UNMATCHED || (pass == 1 && oldProtos[i]->debugname == "UNNAMED"))
+					continue;
+
+				std::string key = oldProtos[i]->debugname;
+				if (pass == 0)
+					key += '@' + std::to_string(oldProtos[i]->linedefined);
+
+				auto it = newByName.find(key);
+				if (it == newByName.end() || it->second.empty())
+					continue;
+
+				// Candidates were pushed in reverse, so the back is the earliest remaining one
+				uint32_t match = it->second.back();
+				it->second.pop_back();
+
+				oldMatches[i] = int32_t(match);
+				newMatches[match] = int32_t(i);
+			}
+		}
+
+		// Instructions creating closures compare by the closure's shape, its own changes are listed under it
+		ProtoDiffContext context{ oldProtos, newProtos, oldShapes, newShapes, options, options.format == OutputFormat::Json };
+
+		uint32_t unchangedCount = 0;
+		std::vector<uint32_t> changed, added, removed;
+
+		for (uint32_t i = 0; i < newProtos.size(); i++) {
+			if (newMatches[i] == UNMATCHED)
+				added.push_back(i);
+			else if (oldOwnHashes[newMatches[i]] == newOwnHashes[i])
+				unchangedCount++;
+			else
+				changed.push_back(i);
+		}
+
+		for (uint32_t i = 0; i < oldProtos.size(); i++) {
+			if (oldMatches[i] == UNMATCHED)
+				removed.push_back(i);
+		}
+
+		std::string output;
+
+		if (context.json) {
+			output += "{\"unchanged\":" + std::to_string(unchangedCount) + ",\"changed\":[";
+			for (size_t i = 0; i < changed.size(); i++) {
+				if (i != 0)
+					output += ',';
+				appendChangedProto(output, context, uint32_t(newMatches[changed[i]]), changed[i]);
+			}
+
+			output += "],\"added\":[";
+			for (size_t i = 0; i < added.size(); i++) {
+				if (i != 0)
+					output += ',';
+				appendAddedProto(output, context, added[i]);
+			}
+
+			output += "],\"removed\":[";
+			for (size_t i = 0; i < removed.size(); i++) {
+				if (i != 0)
+					output += ',';
+				appendRemovedProto(output, context, removed[i]);
+			}
+			output += "]}";
+		}
+		else {
+			output += "; diff: " + std::to_string(unchangedCount) + " unchanged, " + std::to_string(changed.size()) + " changed, " +
+				std::to_string(added.size()) + " added, " + std::to_string(removed.size()) + " removed\n";
+
+			for (uint32_t newId : changed)
+				appendChangedProto(output, context, uint32_t(newMatches[newId]), newId);
+
+			for (uint32_t newId : added)
+				appendAddedProto(output, context, newId);
+
+			for (uint32_t oldId : removed)
+				appendRemovedProto(output, context, oldId);
+		}
+
+		return output;
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "proto.hpp"
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	enum class EditOp : uint8_t {
+		Equal,
+		Delete,
+		Insert,
+	};
+
+	struct Edit {
+		EditOp op = EditOp::Equal;
+		uint32_t oldIndex = 0;
+		uint32_t newIndex = 0;
+	};
+
+	// Shortest edit script between two sequences (Myers), or a full replacement once it would take more than maxEdits edits
+	std::vector<Edit> diff_sequences(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, uint32_t maxEdits = 1024);
+
+	// Compares two versions of a script proto by proto and renders only what was added, removed or changed
+	// Protos are matched by normalized content hash first, then by debugname and linedefined
+	// A proto is changed when its own code is, closures it creates are compared by their signature and listed on their own
+	std::string diff_bytecode(const char* oldBytecode, size_t oldSize, const char* newBytecode, size_t newSize, const DisassemblyOptions& options);
+}
\ No newline at end of file
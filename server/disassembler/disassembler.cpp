@@ -1,127 +1,39 @@
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <vector>
 #include <string>
 #include <sstream>
-#include <format>
+#include <algorithm>
+#include <stdexcept>
 #include <iostream>
 
 #include "bytecode.hpp"
+#include "bytecode_reader.hpp"
+#include "proto.hpp"
+#include "options.hpp"
+#include "cfg.hpp"
+#include "callsite.hpp"
+#include "signature.hpp"
+#include "proto_cache.hpp"
+#include "disassembler.hpp"
 
 namespace LuauDisassembler {
-	enum LuaType : uint8_t {
-		LUA_TNIL,
-		LUA_TBOOLEAN,
-		LUA_TNUMBER,
-		LUA_TSTRING,
-		LUA_TIMPORT,
-	};
-
-	struct LuaImport {
-		uint8_t count = 0;
-		std::string displayString;
-	};
-
-	union LuaValueUnion {
-		bool boolean;
-		double number;
-		std::string str;
-		LuaImport import;
-
-		LuaValueUnion() : import(LuaImport()) {}
-		~LuaValueUnion() {}
-	};
-
-	struct LuaValue {
-		union LuaValueUnion value;
-		uint8_t type = LUA_TNIL;
-
-		LuaValue() : value(LuaValueUnion()), type(LUA_TNIL) {}
-		LuaValue(const LuaValue&) {}
-	};
-
-	struct Proto {
-		uint8_t maxstacksize = 0;
-		uint8_t numparams = 0;
-		uint8_t nups = 0;
-		uint8_t is_vararg = 0;
-
-		std::vector<uint32_t> code;
-		std::vector<LuaValue> k;
-		std::vector<uint32_t> p;
-		uint8_t* lineinfo;
-		int* abslineinfo;
-
-		std::string debugname = "UNNAMED";
-
-		uint8_t linegaplog2 = 0;
-		uint32_t sizelineinfo = 0;
-
-		uint32_t sizelocvars = 0;
-		uint32_t sizeupvalues = 0;
-
-		uint32_t linedefined = 0;
-
-		Proto() :
-			maxstacksize(0),
-			numparams(0),
-			nups(0),
-			is_vararg(0),
-			code(),
-			k(),
-			p(),
-			lineinfo(nullptr),
-			abslineinfo(nullptr),
-			debugname("UNNAMED"),
-			linegaplog2(0),
-			sizelineinfo(0),
-			sizelocvars(0),
-			sizeupvalues(0),
-			linedefined(0)
-		{}
-		~Proto() {
-			delete[] lineinfo;
-		}
-	};
-
 	LuaImport dissect_import(uint32_t id, std::vector<LuaValue>& k) {
 		uint8_t count = id >> 30;
 		int id0 = count > 0 ? int(id >> 20) & 1023 : -1;
 		int id1 = count > 1 ? int(id >> 10) & 1023 : -1;
 		int id2 = count > 2 ? int(id) & 1023 : -1;
 
-		std::string displayString = k[id0].value.str;
+		std::string displayString = k[id0].str;
 		if (id1 >= 0) {
-			displayString += "." + k[id1].value.str;
+			displayString += "." + k[id1].str;
 			if (id2 >= 0) {
-				displayString += "." + k[id2].value.str;
+				displayString += "." + k[id2].str;
 			}
 		}
 
-		return { count, displayString };
-	}
-
-	template<typename T>
-	inline T read(const char* data, size_t& offset) {
-		T result = 0;
-		memcpy(&result, data + offset, sizeof(T));
-		offset += sizeof(T);
-
-		return result;
-	}
-
-	uint32_t readLEB128(const char* data, size_t& offset) {
-		uint32_t result = 0;
-		uint32_t shift = 0;
-
-		uint8_t byte = 0;
-
-		do {
-			byte = read<uint8_t>(data, offset);
-			result |= (byte & 127) << shift;
-			shift += 7;
-		} while (byte & 128);
-
-		return result;
+		return { count, displayString, id };
 	}
 
 	inline int getLineNumberFromPc(Proto* p, int pc) {
@@ -131,158 +43,57 @@ namespace LuauDisassembler {
 		return p->abslineinfo[pc >> p->linegaplog2] + p->lineinfo[pc];
 	}
 
-	std::vector<Proto*> deserialize_bytecode(const char* data) {
-		size_t offset = 0;
+	std::vector<Proto*> deserialize_bytecode(const char* data, size_t size, bool keepLineInfo, const CancellationToken* cancellation) {
+		// The whole bytecode is in the buffer, so running past its end is malformed bytecode rather than a short read
+		CheckedReader reader{ data, size, size };
 
-		uint8_t version = read<uint8_t>(data, offset);
+		uint8_t version = reader.u8();
 		if (version == 0 || version != 2) {
-			throw std::exception("Invalid bytecode");
+			throw std::runtime_error("Invalid bytecode");
 		}
 
-		uint32_t stringCount = readLEB128(data, offset);
+		uint32_t stringCount = reader.leb128();
+		reader.checkCount(stringCount, 1);
 
 		std::vector<std::string> stringTable;
 		stringTable.reserve(stringCount);
 
 		for (uint32_t i = 0; i < stringCount; i++) {
-			uint32_t stringLength = readLEB128(data, offset);
-			stringTable.emplace_back(std::string(data + offset, stringLength));
-			offset += stringLength;
+			uint32_t stringLength = reader.leb128();
+			stringTable.emplace_back(reader.bytes(stringLength), stringLength);
 		}
 
-		uint32_t protoCount = readLEB128(data, offset);
+		uint32_t protoCount = reader.leb128();
+		reader.checkCount(protoCount, 8);
 
 		std::vector<Proto*> protoTable;
 		protoTable.reserve(protoCount);
 
-		for (uint32_t i = 0; i < protoCount; i++) {
-			Proto* p = new Proto;
-
-			p->maxstacksize = read<uint8_t>(data, offset);
-			p->numparams = read<uint8_t>(data, offset);
-			p->nups = read<uint8_t>(data, offset);
-			p->is_vararg = read<uint8_t>(data, offset);
+		try {
+			for (uint32_t i = 0; i < protoCount; i++) {
+				if (cancellation && (cancellation->isCancelled() || cancellation->isExpired()))
+					throw RequestCancelled(!cancellation->isCancelled());
 
-			uint32_t sizecode = readLEB128(data, offset);
-			p->code.reserve(sizecode);
-			for (uint32_t j = 0; j < sizecode; j++)
-				p->code.push_back(read<uint32_t>(data, offset));
-
-			uint32_t sizek = readLEB128(data, offset);
-			p->k.reserve(sizek);
-
-			for (uint32_t j = 0; j < sizek; j++) {
-				p->k.push_back(LuaValue());
-
-				uint8_t constantType = read<uint8_t>(data, offset);
-				LuaValue* constantValue = &p->k[j];
-				switch (constantType) {
-				case 0: { // nil
-					constantValue->type = LUA_TNIL;
-					break;
-				}
-				case 1: { // boolean
-					uint8_t v = read<uint8_t>(data, offset);
-					constantValue->type = LUA_TBOOLEAN;
-					constantValue->value.boolean = v;
-					break;
-				}
-				case 2: { // number
-					double v = read<double>(data, offset);
-					constantValue->type = LUA_TNUMBER;
-					constantValue->value.number = v;
-					break;
-				}
-				case 3: { // string
-					uint32_t id = readLEB128(data, offset);
-					constantValue->type = LUA_TSTRING;
-					constantValue->value.str = std::string(stringTable[id - 1]);
-					break;
-				}
-				case 4: { // import
-					uint32_t iid = read<uint32_t>(data, offset);
-					constantValue->type = LUA_TIMPORT;
-					constantValue->value.import = dissect_import(iid, p->k);
-					break;
-				}
-				case 5: { // table
-					uint32_t keys = readLEB128(data, offset);
-					for (uint32_t i = 0; i < keys; ++i) {
-						uint32_t key = readLEB128(data, offset);
-					}
-					break;
-				}
-				case 6: { // closure
-					readLEB128(data, offset); // fid
-					break;
-				}
-				default: {
-					throw std::exception("Unknown constant type");
-					break;
-				}
-				}
+				protoTable.push_back(read_proto(reader, stringTable, i, keepLineInfo));
 			}
 
-			uint32_t sizep = readLEB128(data, offset);
-			p->p.reserve(sizep);
-			for (uint32_t j = 0; j < sizep; j++) {
-				p->p.push_back(0);
-				p->p[j] = readLEB128(data, offset);
-			}
-
-			p->linedefined = readLEB128(data, offset);
-
-			uint32_t debugname_id = readLEB128(data, offset);
-			if (debugname_id)
-				p->debugname = stringTable[debugname_id - 1];
-
-			uint8_t lineinfo = read<uint8_t>(data, offset);
-			if (lineinfo) {
-				p->linegaplog2 = read<uint8_t>(data, offset);
-
-				int intervals = ((sizecode - 1) >> p->linegaplog2) + 1;
-				int absoffset = (sizecode + 3) & ~3;
-
-				p->sizelineinfo = absoffset + intervals * sizeof(int);
-				p->lineinfo = new uint8_t[p->sizelineinfo];
-				p->abslineinfo = (int*)(p->lineinfo + absoffset);
-
-				uint8_t lastoffset = 0;
-				for (size_t j = 0; j < p->code.size(); j++) {
-					lastoffset += read<uint8_t>(data, offset);
-					p->lineinfo[j] = lastoffset;
-				}
-
-				int lastLine = 0;
-				for (int j = 0; j < intervals; j++) {
-					lastLine += read<uint32_t>(data, offset);
-					p->abslineinfo[j] = lastLine;
-				}
-			}
-
-			uint8_t debuginfo = read<uint8_t>(data, offset);
-			if (debuginfo) {
-				p->sizelocvars = readLEB128(data, offset);
-				for (uint32_t j = 0; j < p->sizelocvars; j++) {
-					readLEB128(data, offset);
-					readLEB128(data, offset);
-					readLEB128(data, offset);
-					offset++;
-				}
-
-				p->sizeupvalues = readLEB128(data, offset);
-				for (uint32_t j = 0; j < p->sizeupvalues; j++)
-					readLEB128(data, offset);
-			}
-
-			protoTable.push_back(p);
+			uint32_t mainid = reader.leb128();
+			reader.check(protoCount != 0 && mainid < protoCount);
+		} catch (...) {
+			free_protos(protoTable);
+			throw;
 		}
 
-		uint32_t mainid = readLEB128(data, offset);
-
 		return protoTable;
 	}
 
+	void free_protos(std::vector<Proto*>& protoTable) {
+		for (Proto* p : protoTable)
+			delete p;
+
+		protoTable.clear();
+	}
+
 	std::string listChildProtos(std::vector<uint32_t>& childProtoList, size_t listSize) {
 		std::stringstream ss;
 		ss << "\n; child protos: ";
@@ -301,14 +112,14 @@ namespace LuauDisassembler {
 			return "nil";
 		}
 		case LUA_TBOOLEAN: {
-			return constant->value.boolean != false ? "true" : "false";
+			return constant->boolean != false ? "true" : "false";
 		}
 		case LUA_TSTRING: {
-			return "'" + constant->value.str + "'";
+			return "'" + constant->str + "'";
 		}
 		case LUA_TNUMBER: {
 			char buffer[20];
-			sprintf_s(buffer, "%4.3f", constant->value.number);
+			snprintf(buffer, sizeof(buffer), "%4.3f", constant->number);
 			return std::string(buffer);
 		}
 		default: {
@@ -319,25 +130,19 @@ namespace LuauDisassembler {
 
 	const char* CAPTURE_TYPES[3] = { "VAL", "REF", "UPVAL" };
 
-	std::string getStringForInstruction(Proto* proto, size_t& pc, bool displayLineInfo) {
+	std::string getInstructionText(Proto* proto, size_t& pc) {
 		std::vector<uint32_t>& code = proto->code;
 		std::vector<LuaValue>& k = proto->k;
 
 		uint32_t instruction = code[pc];
 		uint32_t opcode = LUAU_INSN_OP(instruction);
 
-		char instructionIndexTextBuffer[32];
-		if (displayLineInfo)
-			sprintf_s(instructionIndexTextBuffer, "L%i [%03i] ", getLineNumberFromPc(proto, pc), pc);
-		else
-			sprintf_s(instructionIndexTextBuffer, "[%03i] ", pc);
-
-		std::string result = instructionIndexTextBuffer;
+		std::string result;
 
 		switch (opcode) {
 		case LOP_NOP: {
 			char formattedInstruction[17];
-			sprintf_s(formattedInstruction, "NOP (%#010X)", instruction);
+			snprintf(formattedInstruction, sizeof(formattedInstruction), "NOP (%#010X)", instruction);
 			result += formattedInstruction;
 			break;
 		}
@@ -352,21 +157,23 @@ namespace LuauDisassembler {
 
 			if (jumpOffset > 0) {
 				char formattedInstruction[38];
-				sprintf_s(
+				snprintf(
 					formattedInstruction,
+					sizeof(formattedInstruction),
 					"LOADB %i %i %i ; %s, jump to %i",
 					targetRegister,
 					boolValue,
 					jumpOffset,
 					boolValue != 0 ? "true" : "false",
-					pc + jumpOffset + 1
+					int(pc + jumpOffset + 1)
 				);
 				result += formattedInstruction;
 			}
 			else {
-				char formattedInstruction[20];
-				sprintf_s(
+				char formattedInstruction[24];
+				snprintf(
 					formattedInstruction,
+					sizeof(formattedInstruction),
 					"LOADB %i %i ; %s",
 					targetRegister,
 					boolValue,
@@ -378,8 +185,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_LOADN: {
 			char formattedInstruction[17];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"LOADN %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_D(instruction)
@@ -391,8 +199,9 @@ namespace LuauDisassembler {
 			int16_t constantIndex = LUAU_INSN_D(instruction);
 			std::string constantString = getConstantString(&k[constantIndex]);
 			char formattedInstruction[255];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"LOADK %i %i ; K(%i) = %s",
 				LUAU_INSN_A(instruction),
 				constantIndex,
@@ -404,8 +213,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_MOVE: {
 			char formattedInstruction[13];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"MOVE %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction)
@@ -417,13 +227,14 @@ namespace LuauDisassembler {
 			char formattedInstruction[127];
 			pc++;
 			uint32_t aux = code[pc];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"GETGLOBAL %i %i ; K(%i) = '%s'",
 				LUAU_INSN_A(instruction),
 				aux,
 				aux,
-				k[aux].value.str.c_str()
+				k[aux].str.c_str()
 			);
 			result += formattedInstruction;
 			break;
@@ -432,21 +243,23 @@ namespace LuauDisassembler {
 			char formattedInstruction[127];
 			pc++;
 			uint32_t aux = code[pc];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SETGLOBAL %i %i ; K(%i) = '%s'",
 				LUAU_INSN_A(instruction),
 				aux,
 				aux,
-				k[aux].value.str.c_str()
+				k[aux].str.c_str()
 			);
 			result += formattedInstruction;
 			break;
 		}
 		case LOP_GETUPVAL: {
 			char formattedInstruction[18];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"GETUPVAL %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction)
@@ -456,8 +269,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_SETUPVAL: {
 			char formattedInstruction[18];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SETUPVAL %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction)
@@ -474,8 +288,9 @@ namespace LuauDisassembler {
 			uint32_t aux = code[pc];;
 			LuaImport import = dissect_import(aux, k);
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"GETIMPORT %i %i ; count = %i, '%s'",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_D(instruction),
@@ -487,8 +302,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_GETTABLE: {
 			char formattedInstruction[21];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"GETTABLE %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -499,8 +315,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_SETTABLE: {
 			char formattedInstruction[21];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SETTABLE %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -513,14 +330,15 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"GETTABLEKS %i %i %i ; K(%i) = '%s'",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				aux,
 				aux,
-				k[aux].value.str.c_str()
+				k[aux].str.c_str()
 			);
 			result += formattedInstruction;
 			break;
@@ -529,14 +347,15 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SETTABLEKS %i %i %i ; K(%i) = '%s'",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				aux,
 				aux,
-				k[aux].value.str.c_str()
+				k[aux].str.c_str()
 			);
 			result += formattedInstruction;
 			break;
@@ -544,8 +363,9 @@ namespace LuauDisassembler {
 		case LOP_GETTABLEN: {
 			uint8_t argc = LUAU_INSN_C(instruction);
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"GETTABLEN %i %i %i ; index = %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -558,8 +378,9 @@ namespace LuauDisassembler {
 		case LOP_SETTABLEN: {
 			uint8_t argc = LUAU_INSN_C(instruction);
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SETTABLEN %i %i %i ; index = %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -572,8 +393,9 @@ namespace LuauDisassembler {
 		case LOP_NEWCLOSURE: {
 			int16_t childProtoId = LUAU_INSN_D(instruction);
 			char formattedInstruction[41];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"NEWCLOSURE %i %i ; global id = %i",
 				LUAU_INSN_A(instruction),
 				childProtoId,
@@ -586,14 +408,15 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"NAMECALL %i %i %i ; K(%i) = '%s'",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				aux,
 				aux,
-				k[aux].value.str.c_str()
+				k[aux].str.c_str()
 			);
 			result += formattedInstruction;
 			break;
@@ -602,8 +425,9 @@ namespace LuauDisassembler {
 			uint8_t nargs = LUAU_INSN_B(instruction);
 			uint8_t nresults = LUAU_INSN_C(instruction);
 			char formattedInstruction[54];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"CALL %i %i %i ; %s arguments, %s results",
 				LUAU_INSN_A(instruction),
 				nargs,
@@ -617,9 +441,10 @@ namespace LuauDisassembler {
 		case LOP_RETURN: {
 			uint8_t arga = LUAU_INSN_A(instruction);
 			uint8_t argb = LUAU_INSN_B(instruction);
-			char formattedInstruction[64];
-			sprintf_s(
+			char formattedInstruction[80];
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"RETURN %i %i ; values start at %i, num returned values = %s",
 				arga,
 				argb,
@@ -632,11 +457,12 @@ namespace LuauDisassembler {
 		case LOP_JUMP: {
 			int16_t offset = LUAU_INSN_D(instruction);
 			char formattedInstruction[24];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMP %i ; to %i",
 				offset,
-				pc + offset + 1
+				int(pc + offset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -644,11 +470,12 @@ namespace LuauDisassembler {
 		case LOP_JUMPBACK: {
 			int16_t offset = LUAU_INSN_D(instruction);
 			char formattedInstruction[24];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPBACK %i ; to %i",
 				offset,
-				pc + offset + 1
+				int(pc + offset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -656,12 +483,13 @@ namespace LuauDisassembler {
 		case LOP_JUMPIF: {
 			int16_t offset = LUAU_INSN_D(instruction);
 			char formattedInstruction[30];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIF %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				offset,
-				pc + offset + 1
+				int(pc + offset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -669,12 +497,13 @@ namespace LuauDisassembler {
 		case LOP_JUMPIFNOT: {
 			int16_t offset = LUAU_INSN_D(instruction);
 			char formattedInstruction[30];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFNOT %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				offset,
-				pc + offset + 1
+				int(pc + offset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -685,8 +514,9 @@ namespace LuauDisassembler {
 			uint32_t jumpTo = pc + offset;
 			uint32_t aux = code[pc];
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFEQ %i %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -702,8 +532,9 @@ namespace LuauDisassembler {
 			uint32_t jumpTo = pc + offset;
 			uint32_t aux = code[pc];
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFLE %i %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -719,8 +550,9 @@ namespace LuauDisassembler {
 			uint32_t jumpTo = pc + offset;
 			uint32_t aux = code[pc];
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFLT %i %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -736,8 +568,9 @@ namespace LuauDisassembler {
 			uint32_t jumpTo = pc + offset;
 			uint32_t aux = code[pc];
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFNOTEQ %i %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -753,8 +586,9 @@ namespace LuauDisassembler {
 			uint32_t jumpTo = pc + offset;
 			uint32_t aux = code[pc];
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFNOTLE %i %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -770,8 +604,9 @@ namespace LuauDisassembler {
 			uint32_t jumpTo = pc + offset;
 			uint32_t aux = code[pc];
 			char formattedInstruction[36];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFNOTLT %i %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -783,8 +618,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_ADD: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"ADD %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -795,8 +631,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_SUB: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SUB %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -807,8 +644,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_MUL: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"MUL %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -819,8 +657,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_DIV: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"DIV %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -831,8 +670,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_MOD: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"MOD %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -843,8 +683,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_POW: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"POW %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -857,14 +698,15 @@ namespace LuauDisassembler {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			LuaValue& constantValue = k[constantIndex];
 			char formattedInstruction[46];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"ADDK %i %i %i ; K(%i) = %4.3f",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				constantIndex,
 				constantIndex,
-				constantValue.value.number
+				constantValue.number
 			);
 			result += formattedInstruction;
 			break;
@@ -873,14 +715,15 @@ namespace LuauDisassembler {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			LuaValue& constantValue = k[constantIndex];
 			char formattedInstruction[46];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SUBK %i %i %i ; K(%i) = %4.3f",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				constantIndex,
 				constantIndex,
-				constantValue.value.number
+				constantValue.number
 			);
 			result += formattedInstruction;
 			break;
@@ -889,14 +732,15 @@ namespace LuauDisassembler {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			LuaValue& constantValue = k[constantIndex];
 			char formattedInstruction[46];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"MULK %i %i %i ; K(%i) = %4.3f",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				constantIndex,
 				constantIndex,
-				constantValue.value.number
+				constantValue.number
 			);
 			result += formattedInstruction;
 			break;
@@ -905,14 +749,15 @@ namespace LuauDisassembler {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			LuaValue& constantValue = k[constantIndex];
 			char formattedInstruction[46];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"DIVK %i %i %i ; K(%i) = %4.3f",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				constantIndex,
 				constantIndex,
-				constantValue.value.number
+				constantValue.number
 			);
 			result += formattedInstruction;
 			break;
@@ -921,14 +766,15 @@ namespace LuauDisassembler {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			LuaValue& constantValue = k[constantIndex];
 			char formattedInstruction[46];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"MODK %i %i %i ; K(%i) = %4.3f",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				constantIndex,
 				constantIndex,
-				constantValue.value.number
+				constantValue.number
 			);
 			result += formattedInstruction;
 			break;
@@ -937,14 +783,15 @@ namespace LuauDisassembler {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			LuaValue& constantValue = k[constantIndex];
 			char formattedInstruction[46];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"POWK %i %i %i ; K(%i) = %4.3f",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				constantIndex,
 				constantIndex,
-				constantValue.value.number
+				constantValue.number
 			);
 			result += formattedInstruction;
 			break;
@@ -952,8 +799,9 @@ namespace LuauDisassembler {
 		case LOP_ANDK: {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"ANDK %i %i %i ; K(%i) = %s",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -967,8 +815,9 @@ namespace LuauDisassembler {
 		case LOP_ORK: {
 			uint8_t constantIndex = LUAU_INSN_C(instruction);
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"ORK %i %i %i ; K(%i) = %s",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -981,8 +830,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_CONCAT: {
 			char formattedInstruction[19];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"CONCAT %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -993,8 +843,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_NOT: {
 			char formattedInstruction[12];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"NOT %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction)
@@ -1004,8 +855,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_MINUS: {
 			char formattedInstruction[14];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"MINUS %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction)
@@ -1015,8 +867,9 @@ namespace LuauDisassembler {
 		}
 		case LOP_LENGTH: {
 			char formattedInstruction[16];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"LENGTH %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction)
@@ -1028,8 +881,9 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[24];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"NEWTABLE %i %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -1039,9 +893,10 @@ namespace LuauDisassembler {
 			break;
 		}
 		case LOP_DUPTABLE: {
-			char formattedInstruction[19];
-			sprintf_s(
+			char formattedInstruction[24];
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"DUPTABLE %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_D(instruction)
@@ -1055,8 +910,9 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"SETLIST %i %i %i %i ; start at register %i, fill %s values, start at table index %i",
 				LUAU_INSN_A(instruction),
 				sourceStart,
@@ -1072,12 +928,13 @@ namespace LuauDisassembler {
 		case LOP_FORNPREP: {
 			int16_t jumpOffset = LUAU_INSN_D(instruction);
 			char formattedInstruction[32];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FORNPREP %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -1085,12 +942,32 @@ namespace LuauDisassembler {
 		case LOP_FORNLOOP: {
 			int16_t jumpOffset = LUAU_INSN_D(instruction);
 			char formattedInstruction[32];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FORNLOOP %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
+			);
+			result += formattedInstruction;
+			break;
+		}
+		case LOP_FORGLOOP: {
+			int16_t jumpOffset = LUAU_INSN_D(instruction);
+			int jumpTo = int(pc + jumpOffset + 1);
+			pc++;
+			uint32_t aux = code[pc];
+			char formattedInstruction[64];
+			snprintf(
+				formattedInstruction,
+				sizeof(formattedInstruction),
+				"FORGLOOP %i %i %u ; to %i, %u variables",
+				LUAU_INSN_A(instruction),
+				jumpOffset,
+				aux,
+				jumpTo,
+				aux & 0xFF
 			);
 			result += formattedInstruction;
 			break;
@@ -1098,12 +975,13 @@ namespace LuauDisassembler {
 		case LOP_FORGPREP_INEXT: {
 			int16_t jumpOffset = LUAU_INSN_D(instruction);
 			char formattedInstruction[40];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FORGPREP_INEXT %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -1111,12 +989,13 @@ namespace LuauDisassembler {
 		case LOP_FORGLOOP_INEXT: {
 			int16_t jumpOffset = LUAU_INSN_D(instruction);
 			char formattedInstruction[40];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FORGLOOP_INEXT %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -1124,12 +1003,13 @@ namespace LuauDisassembler {
 		case LOP_FORGPREP_NEXT: {
 			int16_t jumpOffset = LUAU_INSN_D(instruction);
 			char formattedInstruction[40];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FORGPREP_NEXT %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -1137,20 +1017,22 @@ namespace LuauDisassembler {
 		case LOP_FORGLOOP_NEXT: {
 			int16_t jumpOffset = LUAU_INSN_D(instruction);
 			char formattedInstruction[40];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FORGLOOP_NEXT %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
 		}
 		case LOP_DUPCLOSURE: {
-			char formattedInstruction[21];
-			sprintf_s(
+			char formattedInstruction[24];
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"DUPCLOSURE %i %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_D(instruction)
@@ -1162,15 +1044,33 @@ namespace LuauDisassembler {
 			result += "PREPVARARGS " + std::to_string(LUAU_INSN_A(instruction));
 			break;
 		}
+		case LOP_LOADKX: {
+			pc++;
+			uint32_t aux = code[pc];
+			std::string constantString = getConstantString(&k[aux]);
+			char formattedInstruction[255];
+			snprintf(
+				formattedInstruction,
+				sizeof(formattedInstruction),
+				"LOADKX %i %u ; K(%u) = %s",
+				LUAU_INSN_A(instruction),
+				aux,
+				aux,
+				constantString.c_str()
+			);
+			result += formattedInstruction;
+			break;
+		}
 		case LOP_FASTCALL: {
 			uint8_t jumpOffset = LUAU_INSN_C(instruction);
 			char formattedInstruction[30];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FASTCALL %i %i ; to %i",
 				LUAU_INSN_A(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -1179,8 +1079,9 @@ namespace LuauDisassembler {
 			uint8_t captureTypeId = LUAU_INSN_A(instruction);
 			const char* captureTypeString = CAPTURE_TYPES[captureTypeId];
 			char formattedInstruction[30];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"CAPTURE %i %i ; %s capture",
 				captureTypeId,
 				LUAU_INSN_B(instruction),
@@ -1195,8 +1096,9 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFEQK %i %i %i ; K(%i) = %s, to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -1214,8 +1116,9 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"JUMPIFNOTEQK %i %i %i ; K(%i) = %s, to %i",
 				LUAU_INSN_A(instruction),
 				aux,
@@ -1230,13 +1133,14 @@ namespace LuauDisassembler {
 		case LOP_FASTCALL1: {
 			uint8_t jumpOffset = LUAU_INSN_C(instruction);
 			char formattedInstruction[34];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FASTCALL1 %i %i %i ; jump to %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				jumpOffset,
-				pc + jumpOffset + 1
+				int(pc + jumpOffset + 1)
 			);
 			result += formattedInstruction;
 			break;
@@ -1246,14 +1150,15 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[38];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FASTCALL2 %i %i %i %i ; jump to %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
 				aux,
 				jumpOffset,
-				pc + jumpOffset
+				int(pc + jumpOffset)
 			);
 			result += formattedInstruction;
 			break;
@@ -1263,8 +1168,9 @@ namespace LuauDisassembler {
 			pc++;
 			uint32_t aux = code[pc];
 			char formattedInstruction[127];
-			sprintf_s(
+			snprintf(
 				formattedInstruction,
+				sizeof(formattedInstruction),
 				"FASTCALL2K %i %i %i %i ; K(%i) = %s, jump to %i",
 				LUAU_INSN_A(instruction),
 				LUAU_INSN_B(instruction),
@@ -1272,7 +1178,7 @@ namespace LuauDisassembler {
 				jumpOffset,
 				aux,
 				getConstantString(&k[aux]).c_str(),
-				pc + jumpOffset
+				int(pc + jumpOffset)
 			);
 			result += formattedInstruction;
 			break;
@@ -1286,51 +1192,412 @@ namespace LuauDisassembler {
 		return result;
 	}
 
-	std::string disassemble(const char* bytecode, size_t bytecode_size, bool displayLineInfo) {
-		std::string output;
-		output.reserve(bytecode_size * 6);
+	std::string getStringForInstruction(Proto* proto, size_t& pc, bool displayLineInfo) {
+		char instructionIndexTextBuffer[32];
+		if (displayLineInfo)
+			snprintf(instructionIndexTextBuffer, sizeof(instructionIndexTextBuffer), "L%i [%03i] ", getLineNumberFromPc(proto, int(pc)), int(pc));
+		else
+			snprintf(instructionIndexTextBuffer, sizeof(instructionIndexTextBuffer), "[%03i] ", int(pc));
 
-		std::vector<Proto*> protoTable = deserialize_bytecode(bytecode);
+		return instructionIndexTextBuffer + getInstructionText(proto, pc);
+	}
 
-		for (uint32_t protoId = 0; protoId < protoTable.size(); protoId++) {
+	void appendJsonString(std::string& output, const std::string& str) {
+		output += '"';
+		for (char c : str) {
+			switch (c) {
+			case '"': output += "\\\""; break;
+			case '\\': output += "\\\\"; break;
+			case '\n': output += "\\n"; break;
+			case '\r': output += "\\r"; break;
+			case '\t': output += "\\t"; break;
+			default: {
+				if (uint8_t(c) < 0x20) {
+					char escaped[7];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", uint8_t(c));
+					output += escaped;
+				}
+				else {
+					output += c;
+				}
+				break;
+			}
+			}
+		}
+		output += '"';
+	}
+
+	std::string getProtoHeader(Proto* p, uint32_t protoId) {
+		char isVarargStringBuffer[3];
+		snprintf(isVarargStringBuffer, sizeof(isVarargStringBuffer), "%.2X", p->is_vararg);
+
+		std::string header = "; global id: " + std::to_string(protoId) + '\n';
+		header += "; proto name: " + p->debugname + '\n';
+		header += "; linedefined: " + std::to_string(p->linedefined) + "\n\n";
+		header += "; maxstacksize: " + std::to_string(p->maxstacksize) + '\n';
+		header += "; numparams: " + std::to_string(p->numparams) + '\n';
+		header += "; nups: " + std::to_string(p->nups) + '\n';
+		header += "; is_vararg: " + std::string(isVarargStringBuffer) + '\n';
+		header += (p->p.size() > 0 ? listChildProtos(p->p, p->p.size()) : "") + '\n';
+		header += "; sizecode: " + std::to_string(p->code.size()) + '\n';
+		header += "; sizek: " + std::to_string(p->k.size()) + '\n';
+
+		return header;
+	}
+
+	std::string getBlockLabel(const ControlFlowGraph& cfg, uint32_t blockId) {
+		const BasicBlock& block = cfg.blocks[blockId];
+
+		std::string label = "\nblock_" + std::to_string(blockId) + ":";
+		if (blockId == 0) {
+			label += " ; entry";
+		}
+		else if (block.predecessorCount == 0) {
+			label += " ; unreachable";
+		}
+		else {
+			label += " ; preds: ";
+			for (uint32_t i = 0; i < block.predecessorCount; i++) {
+				if (i != 0)
+					label += ", ";
+				label += "block_" + std::to_string(cfg.predecessors[block.predecessorOffset + i]);
+			}
+		}
+
+		return label + '\n';
+	}
+
+	// With patches, the global ids of child protos are left out of NEWCLOSURE lines and their positions recorded instead (see CachedProtoBody)
+	void appendProtoInstructions(std::string& output, Proto* p, const DisassemblyOptions& options, std::vector<CachedProtoBody::Patch>* patches) {
+		ControlFlowGraph cfg;
+		if (options.showBlocks || options.annotateCalls)
+			cfg = build_cfg(p);
+
+		std::vector<CallSiteNote> notes;
+		if (options.annotateCalls)
+			notes = annotate_call_sites(p, cfg);
+
+		// Labels are only wanted with blocks, the notes come out in pc order
+		uint32_t nextBlock = options.showBlocks ? 0 : uint32_t(cfg.blocks.size());
+		size_t nextNote = 0;
+
+		for (size_t i = 0; i < p->code.size(); i++) {
+			if (nextBlock < cfg.blocks.size() && cfg.blocks[nextBlock].startpc == i) {
+				output += getBlockLabel(cfg, nextBlock);
+				nextBlock++;
+			}
+
+			uint32_t instruction = p->code[i];
+			size_t pc = i;
+			std::string line = getStringForInstruction(p, i, options.displayLineInfo);
+
+			if (patches && LUAU_INSN_OP(instruction) == LOP_NEWCLOSURE) {
+				line.resize(line.find_last_not_of("0123456789") + 1);
+				output += line;
+				patches->push_back({ output.size(), uint32_t(LUAU_INSN_D(instruction)) });
+			}
+			else {
+				output += line;
+			}
+
+			if (nextNote < notes.size() && notes[nextNote].pc == pc) {
+				output += " => ";
+				output += notes[nextNote++].text;
+			}
+			output += '\n';
+
+			// Cached bodies are always rendered in full
+			if (!patches && options.maxOutputBytes && output.size() > options.maxOutputBytes)
+				return;
+		}
+	}
+
+	void appendProtoBody(std::string& output, Proto* p, const CachedProtoBody& body) {
+		size_t offset = 0;
+		for (const CachedProtoBody::Patch& patch : body.patches) {
+			output.append(body.text, offset, patch.offset - offset);
+			output += std::to_string(patch.childIndex < p->p.size() ? p->p[patch.childIndex] : 0);
+			offset = patch.offset;
+		}
+		output.append(body.text, offset, std::string::npos);
+	}
+
+	// Matches are part of the header rather than the cached body, the signature set is the server's and not the request's
+	void appendProtoText(std::string& output, Proto* p, uint32_t protoId, const DisassemblyOptions& options, ProtoCache* cache, const SignatureSet* signatures = nullptr) {
+		output += getProtoHeader(p, protoId);
+
+		if (signatures) {
+			std::vector<SignatureMatch> matches;
+			signatures->match(p, matches);
+			append_signature_header(output, matches, *signatures);
+		}
+
+		if (!cache) {
+			appendProtoInstructions(output, p, options, nullptr);
+			return;
+		}
+
+		uint64_t key = get_proto_cache_key(p, options);
+
+		std::shared_ptr<const CachedProtoBody> body = cache->find(key);
+		if (!body) {
+			std::shared_ptr<CachedProtoBody> rendered = std::make_shared<CachedProtoBody>();
+			appendProtoInstructions(rendered->text, p, options, &rendered->patches);
+			cache->insert(key, rendered);
+			body = std::move(rendered);
+		}
+
+		appendProtoBody(output, p, *body);
+	}
+
+	void appendProtoJson(std::string& output, Proto* p, uint32_t protoId, const DisassemblyOptions& options, const SignatureSet* signatures = nullptr) {
+		output += "{\"id\":" + std::to_string(protoId) + ",\"name\":";
+		appendJsonString(output, p->debugname);
+		output += ",\"linedefined\":" + std::to_string(p->linedefined);
+		output += ",\"maxstacksize\":" + std::to_string(p->maxstacksize);
+		output += ",\"numparams\":" + std::to_string(p->numparams);
+		output += ",\"nups\":" + std::to_string(p->nups);
+		output += ",\"is_vararg\":" + std::to_string(p->is_vararg);
+		output += ",\"sizecode\":" + std::to_string(p->code.size());
+		output += ",\"sizek\":" + std::to_string(p->k.size());
+
+		if (signatures) {
+			std::vector<SignatureMatch> matches;
+			signatures->match(p, matches);
+			output += ',';
+			append_signature_json(output, matches, *signatures);
+		}
+
+		output += ",\"children\":[";
+		for (size_t i = 0; i < p->p.size(); i++) {
+			if (i != 0)
+				output += ',';
+			output += std::to_string(p->p[i]);
+		}
+
+		ControlFlowGraph cfg;
+		if (options.showBlocks || options.annotateCalls)
+			cfg = build_cfg(p);
+
+		std::vector<CallSiteNote> notes;
+		if (options.annotateCalls)
+			notes = annotate_call_sites(p, cfg);
+		size_t nextNote = 0;
+
+		output += "],\"instructions\":[";
+		for (size_t i = 0; i < p->code.size(); i++) {
+			if (i != 0)
+				output += ',';
+
+			size_t pc = i;
+			output += "{\"pc\":" + std::to_string(i);
+			if (options.displayLineInfo)
+				output += ",\"line\":" + std::to_string(getLineNumberFromPc(p, int(i)));
+			output += ",\"text\":";
+			appendJsonString(output, getInstructionText(p, i));
+			if (nextNote < notes.size() && notes[nextNote].pc == pc) {
+				output += ",\"note\":";
+				appendJsonString(output, notes[nextNote++].text);
+			}
+			output += '}';
+
+			if (options.maxOutputBytes && output.size() > options.maxOutputBytes)
+				break;
+		}
+		output += ']';
+
+		if (options.showBlocks) {
+			output += ",\"blocks\":[";
+			for (uint32_t b = 0; b < cfg.blocks.size(); b++) {
+				const BasicBlock& block = cfg.blocks[b];
+
+				if (b != 0)
+					output += ',';
+
+				output += "{\"id\":" + std::to_string(b);
+				output += ",\"start\":" + std::to_string(block.startpc);
+				output += ",\"end\":" + std::to_string(block.endpc);
+
+				output += ",\"succs\":[";
+				for (uint32_t i = 0; i < block.successorCount; i++) {
+					if (i != 0)
+						output += ',';
+					output += std::to_string(cfg.successors[block.successorOffset + i]);
+				}
+
+				output += "],\"preds\":[";
+				for (uint32_t i = 0; i < block.predecessorCount; i++) {
+					if (i != 0)
+						output += ',';
+					output += std::to_string(cfg.predecessors[block.predecessorOffset + i]);
+				}
+				output += "]}";
+			}
+			output += ']';
+		}
+
+		output += '}';
+	}
+
+	ProtoRenderer::ProtoRenderer(const std::vector<Proto*>& protoTable, size_t sizeHint, const DisassemblyOptions& options, ProtoCache* cache, const CancellationToken* cancellation) :
+		protoTable(protoTable),
+		options(options),
+		cache(cache),
+		cancellation(cancellation),
+		nextProto(options.firstProto)
+	{
+		// A page is only a slice of the whole output
+		if (!options.hasProtoFilter() && !options.pageBytes)
+			output.reserve(sizeHint);
+
+		if (options.format == OutputFormat::Json)
+			output += "{\"protos\":[";
+	}
+
+	bool ProtoRenderer::render(uint64_t instructionBudget) {
+		bool json = options.format == OutputFormat::Json;
+		uint64_t rendered = 0;
+
+		// The deadline may have passed during deserialization, with nothing left to render
+		if (shouldStop())
+			return true;
+
+		// Protos are rendered whole, so a slice can run over its budget by up to one proto
+		// Once the output is cut off, protos added to the table later (by a streaming deserializer) aren't rendered either
+		uint32_t end = getEndProto();
+		while (!truncated && !pageFull && nextProto < end && rendered < instructionBudget) {
+			uint32_t protoId = nextProto++;
 			Proto* p = protoTable[protoId];
 
-			char isVarargStringBuffer[3];
-			sprintf_s(isVarargStringBuffer, "%0.2X", p->is_vararg);
-
-			std::string header = std::format(R"(; global id: {}
-; proto name: {}
-; linedefined: {}
-
-; maxstacksize: {}
-; numparams: {}
-; nups: {}
-; is_vararg: {}
-{}
-; sizecode: {}
-; sizek: {}
-)",
-protoId,
-p->debugname,
-p->linedefined,
-p->maxstacksize,
-p->numparams,
-p->nups,
-isVarargStringBuffer,
-p->p.size() > 0 ? listChildProtos(p->p, p->p.size()) : "",
-p->code.size(),
-p->k.size()
-);
-			output += header;
-
-			for (size_t i = 0; i < p->code.size(); i++) {
-				output += getStringForInstruction(p, i, displayLineInfo) + '\n';
+			if (!options.wantsProto(protoId, p->debugname))
+				continue;
+
+			if (options.maxOutputBytes && output.size() > options.maxOutputBytes) {
+				truncated = true;
+				nextProto = uint32_t(protoTable.size());
+				break;
 			}
+
+			if (shouldStop())
+				break;
+
+			if (json) {
+				if (!first)
+					output += ',';
+				appendProtoJson(output, p, protoId, options, signatures);
+			}
+			else {
+				appendProtoText(output, p, protoId, options, cache, signatures);
+			}
+
+			first = false;
+			rendered += p->code.size();
+
+			// Pages end on a proto boundary, so a page can run over its size by up to one proto
+			if (options.pageBytes && output.size() >= options.pageBytes)
+				pageFull = true;
 		}
 
-		protoTable.clear();
+		return truncated || pageFull || nextProto >= end;
+	}
+
+	uint32_t ProtoRenderer::getEndProto() const {
+		return uint32_t(std::min<size_t>(protoTable.size(), options.lastProto));
+	}
+
+	bool ProtoRenderer::shouldStop() {
+		if (!cancellation)
+			return false;
+
+		if (cancellation->isCancelled())
+			throw RequestCancelled(false);
+
+		if (!cancellation->isExpired())
+			return false;
+
+		truncated = true;
+		expired = true;
+		nextProto = uint32_t(protoTable.size());
+		return true;
+	}
+
+	std::string ProtoRenderer::finish() {
+		if (options.maxOutputBytes && output.size() > options.maxOutputBytes)
+			truncated = true;
+
+		// The next page starts at the next proto the filters let through, if there is one
+		std::string cursor;
+		if (pageFull && !truncated) {
+			uint32_t end = getEndProto();
+			uint32_t next = nextProto;
+			while (next < end && !options.wantsProto(next, protoTable[next]->debugname))
+				next++;
+
+			if (next < end)
+				cursor = encode_cursor(scriptKey, next, options);
+		}
+
+		if (options.format == OutputFormat::Json) {
+			output += "],\"truncated\":";
+			output += truncated ? "true" : "false";
+			if (!cursor.empty())
+				output += ",\"cursor\":\"" + cursor + '"';
+			output += '}';
+		}
+		else if (expired) {
+			output += "\n; output truncated at the " + std::to_string(options.deadlineMilliseconds) + " ms deadline\n";
+		}
+		else if (truncated) {
+			output += "\n; output truncated at " + std::to_string(options.maxOutputBytes) + " bytes\n";
+		}
+		else if (!cursor.empty()) {
+			output += "\n; next page: " + cursor + '\n';
+		}
+
+		return std::move(output);
+	}
+
+	void render_proto_range(std::string& output, const std::vector<Proto*>& protoTable, uint32_t first, uint32_t last, const DisassemblyOptions& options, ProtoCache* cache) {
+		bool json = options.format == OutputFormat::Json;
+		bool empty = true;
+
+		for (uint32_t protoId = first; protoId < last && protoId < protoTable.size(); protoId++) {
+			Proto* p = protoTable[protoId];
+
+			if (!options.wantsProto(protoId, p->debugname))
+				continue;
+
+			if (json) {
+				if (!empty)
+					output += ',';
+				appendProtoJson(output, p, protoId, options);
+			}
+			else {
+				appendProtoText(output, p, protoId, options, cache);
+			}
+
+			empty = false;
+		}
+	}
+
+	std::string render_protos(const std::vector<Proto*>& protoTable, size_t sizeHint, const DisassemblyOptions& options, ProtoCache* cache) {
+		ProtoRenderer renderer(protoTable, sizeHint, options, cache);
+		renderer.render(UINT64_MAX);
+		return renderer.finish();
+	}
+
+	std::string disassemble(const char* bytecode, size_t bytecode_size, const DisassemblyOptions& options, ProtoCache* cache) {
+		std::vector<Proto*> protoTable = deserialize_bytecode(bytecode, bytecode_size, options.displayLineInfo);
+		ProtoTableOwner owner{ protoTable };
+
+		return render_protos(protoTable, bytecode_size * 6, options, cache);
+	}
+
+	std::string disassemble(const char* bytecode, size_t bytecode_size, bool displayLineInfo) {
+		DisassemblyOptions options;
+		options.displayLineInfo = displayLineInfo;
 
-		return output;
+		return disassemble(bytecode, bytecode_size, options, nullptr);
 	}
 
 } // namespace LuauDisassembler
@@ -4,15 +4,82 @@
 #include <vector>
 #include <string>
 
-namespace LuauDisassembler {
-	enum LuaType;
-	struct LuaImport;
-	union LuaValueUnion;
-	struct LuaValue;
-	struct Proto;
+#include "proto.hpp"
+#include "options.hpp"
+#include "proto_cache.hpp"
+#include "cancellation.hpp"
 
+namespace LuauDisassembler {
 	LuaImport dissect_import(uint32_t id, std::vector<LuaValue>& k);
-	std::vector<Proto*> deserialize_bytecode(const char* data);
+	// Every read is checked against size, malformed bytecode throws std::runtime_error
+	// Throws RequestCancelled, checked between protos, when the token says to stop
+	std::vector<Proto*> deserialize_bytecode(const char* data, size_t size, bool keepLineInfo = true, const CancellationToken* cancellation = nullptr);
+	void free_protos(std::vector<Proto*>& protoTable);
+
+	// Frees a proto table when it goes out of scope, so nothing leaks when a later step throws
+	struct ProtoTableOwner {
+		std::vector<Proto*>& protoTable;
+
+		~ProtoTableOwner() { free_protos(protoTable); }
+	};
+
+	void appendJsonString(std::string& output, const std::string& str);
+	std::string getInstructionText(Proto* proto, size_t& pc);
 	std::string getStringForInstruction(Proto* proto, size_t& pc, bool displayLineInfo);
+
+	class SignatureSet;
+
+	// Renders a proto table a few protos at a time, so a long request can be interleaved with others
+	// The table may grow between calls to render, new protos are rendered by the next call
+	class ProtoRenderer {
+	public:
+		ProtoRenderer(const std::vector<Proto*>& protoTable, size_t sizeHint, const DisassemblyOptions& options, ProtoCache* cache = nullptr, const CancellationToken* cancellation = nullptr);
+
+		// Renders protos until about instructionBudget code words are done, returns true once every proto is rendered
+		// Between protos, a cancelled token throws RequestCancelled and an expired one ends the output
+		bool render(uint64_t instructionBudget);
+
+		// The output was cut off, by maxOutputBytes or the deadline, and won't grow any further
+		bool isTruncated() const { return truncated; }
+
+		// Paged output: the script cache key written into the cursor for the next page
+		void setScriptKey(uint64_t key) { scriptKey = key; }
+
+		// Each proto's header lists the matches of these signatures, which must outlive the renderer
+		void setSignatures(const SignatureSet* set) { signatures = set; }
+
+		// Global id of the first proto not rendered yet
+		uint32_t getNextProto() const { return nextProto; }
+
+		// Closes the output (JSON framing, truncation marker or next page cursor) and hands it over
+		std::string finish();
+
+	private:
+		const std::vector<Proto*>& protoTable;
+		const DisassemblyOptions& options;
+		ProtoCache* cache;
+		const CancellationToken* cancellation;
+		const SignatureSet* signatures = nullptr;
+
+		std::string output;
+		uint32_t nextProto = 0;
+		uint64_t scriptKey = 0;
+		bool first = true;
+		bool truncated = false;
+		bool expired = false;
+		bool pageFull = false;
+
+		uint32_t getEndProto() const;
+
+		bool shouldStop();
+	};
+
+	// Renders protos [first, last) exactly as render_protos renders them within the whole table, without the JSON framing or
+	// truncation, so ranges can be rendered in parallel: joined in order (with a comma between non-empty JSON ranges) and
+	// framed by "{\"protos\":[" and "],\"truncated\":false}" for JSON, they give render_protos' output
+	void render_proto_range(std::string& output, const std::vector<Proto*>& protoTable, uint32_t first, uint32_t last, const DisassemblyOptions& options, ProtoCache* cache = nullptr);
+
+	std::string render_protos(const std::vector<Proto*>& protoTable, size_t sizeHint, const DisassemblyOptions& options, ProtoCache* cache = nullptr);
+	std::string disassemble(const char* bytecode, size_t bytecode_size, const DisassemblyOptions& options, ProtoCache* cache = nullptr);
 	std::string disassemble(const char* bytecode, size_t bytecode_size, bool displayLineInfo);
 }
\ No newline at end of file
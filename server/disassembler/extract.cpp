@@ -0,0 +1,332 @@
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <vector>
+#include <string>
+
+#include "scan.hpp"
+#include "proto.hpp"
+#include "disassembler.hpp"
+#include "extract.hpp"
+
+namespace LuauDisassembler {
+	constexpr uint32_t NOT_EXTRACTED = UINT32_MAX;
+
+	// Shortest text that reads back as the same double, so large asset ids come out whole
+	static void appendNumber(std::string& output, double number) {
+		char buffer[32];
+		std::to_chars_result formatted = std::to_chars(buffer, buffer + sizeof(buffer), number);
+		output.append(buffer, formatted.ptr);
+	}
+
+	// The string ids making up an import path, 0 past its length
+	struct ImportKey {
+		uint32_t parts[3] = {};
+
+		bool operator==(const ImportKey& other) const {
+			return parts[0] == other.parts[0] && parts[1] == other.parts[1] && parts[2] == other.parts[2];
+		}
+	};
+
+	static uint64_t mixHash(uint64_t hash) {
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	static uint64_t hashKey(uint64_t bits) {
+		return mixHash(bits);
+	}
+
+	static uint64_t hashKey(const ImportKey& key) {
+		return mixHash(key.parts[0] ^ (uint64_t(key.parts[1]) << 21) ^ (uint64_t(key.parts[2]) << 42));
+	}
+
+	// Open addressing table from constants to their index in the result; scripts with a lot of distinct numbers
+	// spent most of the extraction allocating and chasing unordered_map nodes
+	template <typename Key>
+	struct ConstantTable {
+		std::vector<Key> keys;
+		std::vector<uint32_t> indices;
+		size_t used = 0;
+
+		// The index slot for the key, NOT_EXTRACTED if it is new
+		uint32_t& find(const Key& key) {
+			if ((used + 1) * 2 > indices.size())
+				grow();
+
+			size_t mask = indices.size() - 1;
+			for (size_t slot = hashKey(key) & mask;; slot = (slot + 1) & mask) {
+				if (indices[slot] == NOT_EXTRACTED) {
+					keys[slot] = key;
+					used++;
+					return indices[slot];
+				}
+				if (keys[slot] == key)
+					return indices[slot];
+			}
+		}
+
+		void grow() {
+			std::vector<Key> oldKeys = std::move(keys);
+			std::vector<uint32_t> oldIndices = std::move(indices);
+
+			size_t capacity = oldIndices.empty() ? 256 : oldIndices.size() * 2;
+			keys.assign(capacity, Key());
+			indices.assign(capacity, NOT_EXTRACTED);
+
+			size_t mask = capacity - 1;
+			for (size_t i = 0; i < oldIndices.size(); i++) {
+				if (oldIndices[i] == NOT_EXTRACTED)
+					continue;
+
+				size_t slot = hashKey(oldKeys[i]) & mask;
+				while (indices[slot] != NOT_EXTRACTED)
+					slot = (slot + 1) & mask;
+				keys[slot] = oldKeys[i];
+				indices[slot] = oldIndices[i];
+			}
+		}
+	};
+
+	struct ConstantExtractor : ScanVisitor {
+
+		// A constant held back until its proto's debugname (read after the constants) says whether it is wanted
+		struct PendingConstant {
+			uint8_t type = 0;
+			uint32_t stringId = 0;
+			double number = 0;
+			ImportKey import;
+		};
+
+		const DisassemblyOptions& options;
+		ExtractedConstants& result;
+		bool listProtos;
+		bool filtered;
+
+		std::vector<std::pair<const char*, uint32_t>> strings;
+
+		// Index in the result of each string id, number and import path seen so far
+		std::vector<uint32_t> stringIndices;
+		ConstantTable<uint64_t> numberIndices;
+		ConstantTable<ImportKey> importIndices;
+
+		// Only used with a proto filter, otherwise constants are added as they are scanned
+		std::vector<PendingConstant> pending;
+		std::vector<uint32_t> constantStrings; // string id of each of the current proto's constants, 0 if not a string
+
+		ConstantExtractor(const DisassemblyOptions& options, ExtractedConstants& result) :
+			options(options),
+			result(result),
+			listProtos(options.listConstantProtos),
+			filtered(options.hasProtoFilter())
+		{}
+
+		void onString(uint32_t, const char* data, uint32_t length) override {
+			strings.emplace_back(data, length);
+		}
+
+		void onConstant(uint32_t protoId, uint32_t, const ScannedConstant& constant) override {
+			constantStrings.push_back(constant.type == LUA_TSTRING ? constant.stringId : 0);
+
+			PendingConstant entry;
+			entry.type = constant.type;
+			switch (constant.type) {
+			case LUA_TSTRING: {
+				entry.stringId = constant.stringId;
+				break;
+			}
+			case LUA_TNUMBER: {
+				entry.number = constant.number;
+				break;
+			}
+			case LUA_TIMPORT: {
+				// The path's parts are string constants before this one, as the scan has checked
+				uint32_t count = constant.importId >> 30;
+				for (uint32_t part = 0; part < count; part++)
+					entry.import.parts[part] = constantStrings[(constant.importId >> (20 - part * 10)) & 1023];
+				break;
+			}
+			default: {
+				return;
+			}
+			}
+
+			if (filtered)
+				pending.push_back(entry);
+			else
+				add(protoId, entry);
+		}
+
+		void onProto(const ScannedProto& proto) override {
+			constantStrings.clear();
+			if (!filtered) {
+				result.protos++;
+				return;
+			}
+
+			std::string debugname;
+			if (proto.debugname != 0)
+				debugname.assign(strings[proto.debugname - 1].first, strings[proto.debugname - 1].second);
+
+			if (options.wantsProto(proto.id, debugname)) {
+				result.protos++;
+				for (const PendingConstant& constant : pending)
+					add(proto.id, constant);
+			}
+
+			pending.clear();
+		}
+
+		void addProto(std::vector<uint32_t>& protos, uint32_t protoId) {
+			// Protos are scanned in order, so a repeat can only be the last one listed
+			if (listProtos && (protos.empty() || protos.back() != protoId))
+				protos.push_back(protoId);
+		}
+
+		void add(uint32_t protoId, const PendingConstant& constant) {
+			switch (constant.type) {
+			case LUA_TSTRING: {
+				if (stringIndices.size() <= constant.stringId)
+					stringIndices.resize(strings.size() + 1, NOT_EXTRACTED);
+
+				uint32_t& index = stringIndices[constant.stringId];
+				if (index == NOT_EXTRACTED) {
+					index = uint32_t(result.strings.size());
+					const std::pair<const char*, uint32_t>& str = strings[constant.stringId - 1];
+					result.strings.push_back({ std::string(str.first, str.second), {} });
+				}
+				addProto(result.strings[index].protos, protoId);
+				break;
+			}
+			case LUA_TNUMBER: {
+				uint64_t bits;
+				memcpy(&bits, &constant.number, sizeof(bits));
+
+				uint32_t& index = numberIndices.find(bits);
+				if (index == NOT_EXTRACTED) {
+					index = uint32_t(result.numbers.size());
+					result.numbers.push_back({ constant.number, {} });
+				}
+				addProto(result.numbers[index].protos, protoId);
+				break;
+			}
+			case LUA_TIMPORT: {
+				// The path text is only built the first time it is seen
+				uint32_t& index = importIndices.find(constant.import);
+				if (index == NOT_EXTRACTED) {
+					index = uint32_t(result.imports.size());
+					std::string path;
+					for (uint32_t part = 0; part < 3 && constant.import.parts[part] != 0; part++) {
+						if (part != 0)
+							path += '.';
+						path.append(strings[constant.import.parts[part] - 1].first, strings[constant.import.parts[part] - 1].second);
+					}
+					result.imports.push_back({ std::move(path), {} });
+				}
+				addProto(result.imports[index].protos, protoId);
+				break;
+			}
+			default: {
+				break;
+			}
+			}
+		}
+	};
+
+	ExtractedConstants extract_constants(const char* bytecode, size_t size, const DisassemblyOptions& options) {
+		ExtractedConstants result;
+		ConstantExtractor extractor(options, result);
+		scan_bytecode(bytecode, size, &extractor);
+		return result;
+	}
+
+	static void appendValue(std::string& output, const ExtractedConstants::Constant& constant, bool json, bool quote) {
+		if (json)
+			appendJsonString(output, constant.value);
+		else if (quote)
+			output += '\'' + constant.value + '\'';
+		else
+			output += constant.value;
+	}
+
+	// Numbers are JSON strings as well, so inf and nan stay valid JSON
+	static void appendValue(std::string& output, const ExtractedConstants::Number& number, bool json, bool) {
+		if (json)
+			output += '"';
+		appendNumber(output, number.value);
+		if (json)
+			output += '"';
+	}
+
+	template <typename Entry>
+	static void appendConstantsJson(std::string& output, const char* name, const std::vector<Entry>& constants, bool listProtos) {
+		output += '"';
+		output += name;
+		output += "\":[";
+
+		for (size_t i = 0; i < constants.size(); i++) {
+			if (i != 0)
+				output += ',';
+
+			if (!listProtos) {
+				appendValue(output, constants[i], true, false);
+				continue;
+			}
+
+			output += "{\"value\":";
+			appendValue(output, constants[i], true, false);
+			output += ",\"protos\":[";
+			for (size_t j = 0; j < constants[i].protos.size(); j++) {
+				if (j != 0)
+					output += ',';
+				output += std::to_string(constants[i].protos[j]);
+			}
+			output += "]}";
+		}
+
+		output += ']';
+	}
+
+	template <typename Entry>
+	static void appendConstantsText(std::string& output, const char* name, const std::vector<Entry>& constants, bool quote) {
+		output += "\n; ";
+		output += name;
+		output += '\n';
+
+		for (const Entry& constant : constants) {
+			appendValue(output, constant, false, quote);
+
+			for (size_t j = 0; j < constant.protos.size(); j++) {
+				output += j == 0 ? " ; protos " : ", ";
+				output += std::to_string(constant.protos[j]);
+			}
+			output += '\n';
+		}
+	}
+
+	std::string format_constants(const ExtractedConstants& constants, const DisassemblyOptions& options) {
+		std::string output;
+
+		if (options.format == OutputFormat::Json) {
+			output += "{\"protos\":" + std::to_string(constants.protos) + ',';
+			appendConstantsJson(output, "strings", constants.strings, options.listConstantProtos);
+			output += ',';
+			appendConstantsJson(output, "numbers", constants.numbers, options.listConstantProtos);
+			output += ',';
+			appendConstantsJson(output, "imports", constants.imports, options.listConstantProtos);
+			output += '}';
+			return output;
+		}
+
+		output += "; " + std::to_string(constants.strings.size()) + " strings, " + std::to_string(constants.numbers.size()) + " numbers, " +
+			std::to_string(constants.imports.size()) + " imports in " + std::to_string(constants.protos) + " protos\n";
+
+		appendConstantsText(output, "strings", constants.strings, true);
+		appendConstantsText(output, "numbers", constants.numbers, false);
+		appendConstantsText(output, "imports", constants.imports, false);
+
+		return output;
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	// The distinct string, number and import constants of a script's protos, in order of first use
+	struct ExtractedConstants {
+		struct Constant {
+			std::string value; // the string's bytes or the import path
+			std::vector<uint32_t> protos; // global ids of the protos using it, when the options ask for them
+		};
+
+		// Numbers are only turned into text when formatted, scripts can have tens of thousands of distinct ones
+		struct Number {
+			double value = 0;
+			std::vector<uint32_t> protos;
+		};
+
+		uint32_t protos = 0; // protos whose constants were taken
+		std::vector<Constant> strings;
+		std::vector<Number> numbers;
+		std::vector<Constant> imports;
+	};
+
+	// Reads the constants of the wanted protos from the string table and constant sections as the bytecode is scanned,
+	// stepping over code, line info and debug info, so no instruction is decoded and no proto is built
+	ExtractedConstants extract_constants(const char* bytecode, size_t size, const DisassemblyOptions& options);
+
+	std::string format_constants(const ExtractedConstants& constants, const DisassemblyOptions& options);
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <random>
+
+namespace LuauDisassembler {
+	// Small streaming 64-bit hash for content keys; not meant to resist deliberate collisions
+	struct Hasher {
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+
+		void add(uint64_t value) {
+			state ^= value;
+			state *= 0xFF51AFD7ED558CCDull;
+			state ^= state >> 29;
+		}
+
+		void add(const char* data, size_t size) {
+			add(uint64_t(size));
+
+			size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				uint64_t word;
+				memcpy(&word, data + i, sizeof(word));
+				add(word);
+			}
+
+			if (i < size) {
+				uint64_t word = 0;
+				memcpy(&word, data + i, size - i);
+				add(word);
+			}
+		}
+
+		void add(const std::string& str) {
+			add(str.data(), str.size());
+		}
+
+		uint64_t finish() const {
+			uint64_t h = state;
+			h ^= h >> 33;
+			h *= 0xC4CEB9FE1A85EC53ull;
+			h ^= h >> 33;
+			return h;
+		}
+	};
+
+	// Secret key of KeyedHasher, drawn once per process
+	struct HashKey {
+		uint64_t k0 = 0;
+		uint64_t k1 = 0;
+	};
+
+	inline const HashKey& get_process_hash_key() {
+		static const HashKey key = [] {
+			std::random_device random;
+			HashKey result;
+			result.k0 = (uint64_t(random()) << 32) | random();
+			result.k1 = (uint64_t(random()) << 32) | random();
+			return result;
+		}();
+		return key;
+	}
+
+	// SipHash-1-3 over the same words Hasher takes, keyed with the process' secret: for keys of caches shared between
+	// clients, where one client must not be able to collide with or guess another's keys
+	struct KeyedHasher {
+		uint64_t v0;
+		uint64_t v1;
+		uint64_t v2;
+		uint64_t v3;
+		uint64_t words = 0;
+
+		explicit KeyedHasher(const HashKey& key = get_process_hash_key()) :
+			v0(key.k0 ^ 0x736F6D6570736575ull),
+			v1(key.k1 ^ 0x646F72616E646F6Dull),
+			v2(key.k0 ^ 0x6C7967656E657261ull),
+			v3(key.k1 ^ 0x7465646279746573ull)
+		{}
+
+		static uint64_t rotate(uint64_t x, int bits) {
+			return (x << bits) | (x >> (64 - bits));
+		}
+
+		void round() {
+			v0 += v1; v1 = rotate(v1, 13); v1 ^= v0; v0 = rotate(v0, 32);
+			v2 += v3; v3 = rotate(v3, 16); v3 ^= v2;
+			v0 += v3; v3 = rotate(v3, 21); v3 ^= v0;
+			v2 += v1; v1 = rotate(v1, 17); v1 ^= v2; v2 = rotate(v2, 32);
+		}
+
+		void add(uint64_t value) {
+			v3 ^= value;
+			round();
+			v0 ^= value;
+			words++;
+		}
+
+		void add(const char* data, size_t size) {
+			add(uint64_t(size));
+
+			size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				uint64_t word;
+				memcpy(&word, data + i, sizeof(word));
+				add(word);
+			}
+
+			if (i < size) {
+				uint64_t word = 0;
+				memcpy(&word, data + i, size - i);
+				add(word);
+			}
+		}
+
+		void add(const std::string& str) {
+			add(str.data(), str.size());
+		}
+
+		uint64_t finish() const {
+			KeyedHasher h = *this;
+			uint64_t last = words << 56;
+			h.v3 ^= last;
+			h.round();
+			h.v0 ^= last;
+			h.v2 ^= 0xFF;
+			h.round();
+			h.round();
+			h.round();
+			return h.v0 ^ h.v1 ^ h.v2 ^ h.v3;
+		}
+	};
+}
\ No newline at end of file
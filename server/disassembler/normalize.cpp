@@ -0,0 +1,187 @@
+#include <cstdint>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "hash.hpp"
+#include "normalize.hpp"
+
+namespace LuauDisassembler {
+	static uint64_t getProtoHash(uint32_t globalId, const std::vector<uint64_t>& protoHashes) {
+		// Forward references can't be resolved, fall back to the id itself
+		return globalId < protoHashes.size() ? protoHashes[globalId] : globalId;
+	}
+
+	uint64_t hash_constant(const Proto* p, uint32_t index, const std::vector<uint64_t>& protoHashes) {
+		Hasher h;
+		if (index >= p->k.size()) {
+			h.add(uint64_t(index));
+			return h.finish();
+		}
+
+		const LuaValue& constant = p->k[index];
+		h.add(constant.type);
+
+		switch (constant.type) {
+		case LUA_TBOOLEAN: {
+			h.add(uint64_t(constant.boolean));
+			break;
+		}
+		case LUA_TNUMBER: {
+			uint64_t bits;
+			memcpy(&bits, &constant.number, sizeof(bits));
+			h.add(bits);
+			break;
+		}
+		case LUA_TSTRING: {
+			h.add(constant.str);
+			break;
+		}
+		case LUA_TIMPORT: {
+			h.add(constant.import.displayString);
+			break;
+		}
+		case LUA_TTABLE: {
+			for (uint32_t key : constant.tableKeys)
+				h.add(key < p->k.size() ? p->k[key].str : std::string());
+			break;
+		}
+		case LUA_TCLOSURE: {
+			h.add(getProtoHash(constant.closure, protoHashes));
+			break;
+		}
+		default: {
+			break;
+		}
+		}
+
+		return h.finish();
+	}
+
+	uint64_t hash_instruction(const Proto* p, size_t pc, const std::vector<uint64_t>& protoHashes) {
+		const std::vector<uint32_t>& code = p->code;
+		uint32_t instruction = code[pc];
+		uint8_t opcode = LUAU_INSN_OP(instruction);
+		uint32_t aux = getOpLength(opcode) > 1 && pc + 1 < code.size() ? code[pc + 1] : 0;
+
+		Hasher h;
+		h.add(opcode);
+
+		// Predicted hash slots (C of the *GLOBAL/*TABLEKS/NAMECALL instructions) follow from the constant, so they are left out
+		switch (opcode) {
+		case LOP_LOADK:
+		case LOP_GETIMPORT:
+		case LOP_DUPTABLE:
+		case LOP_DUPCLOSURE: {
+			h.add(LUAU_INSN_A(instruction));
+			h.add(hash_constant(p, uint32_t(LUAU_INSN_D(instruction)), protoHashes));
+			break;
+		}
+		case LOP_LOADKX:
+		case LOP_GETGLOBAL:
+		case LOP_SETGLOBAL: {
+			h.add(LUAU_INSN_A(instruction));
+			h.add(hash_constant(p, aux, protoHashes));
+			break;
+		}
+		case LOP_GETTABLEKS:
+		case LOP_SETTABLEKS:
+		case LOP_NAMECALL: {
+			h.add(LUAU_INSN_A(instruction));
+			h.add(LUAU_INSN_B(instruction));
+			h.add(hash_constant(p, aux, protoHashes));
+			break;
+		}
+		case LOP_ADDK:
+		case LOP_SUBK:
+		case LOP_MULK:
+		case LOP_DIVK:
+		case LOP_MODK:
+		case LOP_POWK:
+		case LOP_ANDK:
+		case LOP_ORK: {
+			h.add(LUAU_INSN_A(instruction));
+			h.add(LUAU_INSN_B(instruction));
+			h.add(hash_constant(p, LUAU_INSN_C(instruction), protoHashes));
+			break;
+		}
+		case LOP_JUMPIFEQK:
+		case LOP_JUMPIFNOTEQK: {
+			h.add(LUAU_INSN_A(instruction));
+			h.add(uint64_t(LUAU_INSN_D(instruction)));
+			h.add(hash_constant(p, aux, protoHashes));
+			break;
+		}
+		case LOP_FASTCALL2K: {
+			h.add(instruction >> 8);
+			h.add(hash_constant(p, aux, protoHashes));
+			break;
+		}
+		case LOP_NEWCLOSURE: {
+			uint32_t childIndex = uint32_t(LUAU_INSN_D(instruction));
+			h.add(LUAU_INSN_A(instruction));
+			h.add(childIndex < p->p.size() ? getProtoHash(p->p[childIndex], protoHashes) : childIndex);
+			break;
+		}
+		default: {
+			h.add(instruction >> 8);
+			h.add(aux);
+			break;
+		}
+		}
+
+		return h.finish();
+	}
+
+	static uint64_t hashProto(const Proto* p, const std::vector<uint64_t>& childHashes) {
+		Hasher h;
+		h.add(p->numparams);
+		h.add(p->nups);
+		h.add(p->is_vararg);
+
+		for (size_t pc = 0; pc < p->code.size(); pc += getOpLength(LUAU_INSN_OP(p->code[pc])))
+			h.add(hash_instruction(p, pc, childHashes));
+
+		// Constants are combined order-independently so renumbering them doesn't change the hash
+		uint64_t constants = 0;
+		for (uint32_t i = 0; i < p->k.size(); i++)
+			constants += hash_constant(p, i, childHashes);
+		h.add(constants);
+
+		return h.finish();
+	}
+
+	std::vector<uint64_t> hash_protos(const std::vector<Proto*>& protos) {
+		std::vector<uint64_t> protoHashes;
+		protoHashes.reserve(protos.size());
+
+		for (const Proto* p : protos)
+			protoHashes.push_back(hashProto(p, protoHashes));
+
+		return protoHashes;
+	}
+
+	std::vector<uint64_t> hash_proto_shapes(const std::vector<Proto*>& protos) {
+		std::vector<uint64_t> shapes;
+		shapes.reserve(protos.size());
+
+		for (const Proto* p : protos) {
+			Hasher h;
+			h.add(p->numparams);
+			h.add(p->nups);
+			h.add(p->is_vararg);
+			shapes.push_back(h.finish());
+		}
+
+		return shapes;
+	}
+
+	std::vector<uint64_t> hash_protos(const std::vector<Proto*>& protos, const std::vector<uint64_t>& childHashes) {
+		std::vector<uint64_t> protoHashes;
+		protoHashes.reserve(protos.size());
+
+		for (const Proto* p : protos)
+			protoHashes.push_back(hashProto(p, childHashes));
+
+		return protoHashes;
+	}
+} // namespace LuauDisassembler
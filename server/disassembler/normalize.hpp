@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "proto.hpp"
+
+namespace LuauDisassembler {
+	// Normalized hashes describe what code does rather than how it happens to be laid out:
+	// constant operands hash as the constant's value instead of its index, and closures as the content of the proto they create
+
+	// Hash of the value of constant index in proto p
+	uint64_t hash_constant(const Proto* p, uint32_t index, const std::vector<uint64_t>& protoHashes);
+
+	// Hash of the instruction at pc (including its AUX word) with constant and child proto references resolved
+	uint64_t hash_instruction(const Proto* p, size_t pc, const std::vector<uint64_t>& protoHashes);
+
+	// Normalized content hash of every proto, indexed by global id
+	// Child protos are serialized before their parents, so a parent's hash covers its children
+	std::vector<uint64_t> hash_protos(const std::vector<Proto*>& protos);
+
+	// Hash of what a parent sees of each proto without looking inside it: its parameters, upvalues and varargs
+	std::vector<uint64_t> hash_proto_shapes(const std::vector<Proto*>& protos);
+
+	// Same as hash_protos, but children hash as childHashes[id] instead of their content; with hash_proto_shapes, a change
+	// inside a closure leaves the hash of the proto creating it alone
+	std::vector<uint64_t> hash_protos(const std::vector<Proto*>& protos, const std::vector<uint64_t>& childHashes);
+}
\ No newline at end of file
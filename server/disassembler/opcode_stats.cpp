@@ -0,0 +1,206 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "bytecode.hpp"
+#include "scan.hpp"
+#include "disassembler.hpp"
+#include "opcode_stats.hpp"
+
+namespace LuauDisassembler {
+	const char* CONSTANT_TYPE_NAMES[7] = { "nil", "boolean", "number", "string", "import", "table", "closure" };
+
+	constexpr size_t LARGEST_PROTO_COUNT = 10;
+	constexpr size_t OPCODE_PAIR_COUNT = 20;
+
+	// Whether each opcode is followed by an AUX word
+	struct AuxTable {
+		uint8_t hasAux[256];
+
+		AuxTable() {
+			for (uint32_t op = 0; op < 256; op++)
+				hasAux[op] = getOpLength(uint8_t(op)) > 1;
+		}
+	};
+
+	static const AuxTable AUX_TABLE;
+
+	// Opcodes are the first byte of each little endian instruction word
+	// Every word is visited and counted with a 0 or 1 weight, so the only thing carried from one word to the next is
+	// whether it is an AUX word, rather than a load of the opcode and its length before the next word can be found
+	static void countOpcodes(const unsigned char* code, uint32_t sizecode, OpcodeStats& stats) {
+		uint64_t* opcodes = stats.opcodes;
+		uint32_t* pairs = stats.pairs.data();
+
+		// The first instruction of a proto has no predecessor, its pair goes to a row past the real ones
+		uint32_t previous = 256;
+		uint32_t isAux = 0;
+		uint64_t instructions = 0;
+
+		for (uint32_t pc = 0; pc < sizecode; pc++) {
+			uint32_t op = code[size_t(pc) * sizeof(uint32_t)];
+			uint32_t isInstruction = isAux ^ 1;
+
+			opcodes[op] += isInstruction;
+			pairs[previous << 8 | op] += isInstruction;
+			instructions += isInstruction;
+
+			previous = isInstruction ? op : previous;
+			isAux = isInstruction & AUX_TABLE.hasAux[op];
+		}
+
+		stats.instructions += instructions;
+	}
+
+	struct OpcodeStatsVisitor : ScanVisitor {
+		OpcodeStats& stats;
+		std::vector<std::pair<const char*, uint32_t>> strings;
+
+		explicit OpcodeStatsVisitor(OpcodeStats& stats) :
+			stats(stats)
+		{}
+
+		void onString(uint32_t, const char* data, uint32_t length) override {
+			strings.emplace_back(data, length);
+		}
+
+		void onConstant(uint32_t, uint32_t, const ScannedConstant& constant) override {
+			stats.constantTypes[constant.type]++;
+		}
+
+		void onProto(const ScannedProto& proto) override {
+			stats.protos++;
+			stats.codeWords += proto.sizecode;
+			countOpcodes(reinterpret_cast<const unsigned char*>(proto.code), proto.sizecode, stats);
+
+			// Kept sorted, it only holds a few entries
+			std::vector<OpcodeStats::LargeProto>& largest = stats.largest;
+			if (largest.size() == LARGEST_PROTO_COUNT && largest.back().sizecode >= proto.sizecode)
+				return;
+
+			OpcodeStats::LargeProto entry;
+			entry.id = proto.id;
+			entry.sizecode = proto.sizecode;
+			if (proto.debugname != 0 && proto.debugname <= strings.size())
+				entry.name.assign(strings[proto.debugname - 1].first, strings[proto.debugname - 1].second);
+
+			auto position = std::upper_bound(largest.begin(), largest.end(), entry, [](const OpcodeStats::LargeProto& a, const OpcodeStats::LargeProto& b) {
+				return a.sizecode > b.sizecode;
+			});
+			largest.insert(position, std::move(entry));
+			if (largest.size() > LARGEST_PROTO_COUNT)
+				largest.pop_back();
+		}
+	};
+
+	OpcodeStats collect_opcode_stats(const char* bytecode, size_t size) {
+		OpcodeStats stats;
+		stats.pairs.assign(257 * 256, 0);
+
+		OpcodeStatsVisitor visitor(stats);
+		BytecodeSummary summary = scan_bytecode(bytecode, size, &visitor);
+		stats.strings = summary.stringCount;
+
+		return stats;
+	}
+
+	static std::string getOpDisplayName(uint32_t op) {
+		if (const char* name = getOpName(uint8_t(op)))
+			return name;
+
+		char buffer[8];
+		snprintf(buffer, sizeof(buffer), "0x%02X", op);
+		return buffer;
+	}
+
+	std::string format_opcode_stats(const OpcodeStats& stats, const DisassemblyOptions& options) {
+		bool json = options.format == OutputFormat::Json;
+
+		std::vector<uint32_t> opcodes;
+		for (uint32_t op = 0; op < 256; op++) {
+			if (stats.opcodes[op])
+				opcodes.push_back(op);
+		}
+		std::stable_sort(opcodes.begin(), opcodes.end(), [&](uint32_t a, uint32_t b) {
+			return stats.opcodes[a] > stats.opcodes[b];
+		});
+
+		std::vector<uint32_t> pairs;
+		for (uint32_t pair = 0; pair < 256 * 256; pair++) {
+			if (stats.pairs[pair])
+				pairs.push_back(pair);
+		}
+		size_t pairCount = std::min(pairs.size(), OPCODE_PAIR_COUNT);
+		std::partial_sort(pairs.begin(), pairs.begin() + pairCount, pairs.end(), [&](uint32_t a, uint32_t b) {
+			return stats.pairs[a] != stats.pairs[b] ? stats.pairs[a] > stats.pairs[b] : a < b;
+		});
+		pairs.resize(pairCount);
+
+		std::string output;
+		if (json) {
+			output += "{\"protos\":" + std::to_string(stats.protos);
+			output += ",\"strings\":" + std::to_string(stats.strings);
+			output += ",\"instructions\":" + std::to_string(stats.instructions);
+			output += ",\"codeWords\":" + std::to_string(stats.codeWords);
+
+			output += ",\"opcodes\":{";
+			for (size_t i = 0; i < opcodes.size(); i++) {
+				if (i != 0)
+					output += ',';
+				output += '"' + getOpDisplayName(opcodes[i]) + "\":" + std::to_string(stats.opcodes[opcodes[i]]);
+			}
+
+			output += "},\"constants\":{";
+			for (uint32_t type = 0; type < 7; type++) {
+				if (type != 0)
+					output += ',';
+				output += '"' + std::string(CONSTANT_TYPE_NAMES[type]) + "\":" + std::to_string(stats.constantTypes[type]);
+			}
+
+			output += "},\"pairs\":[";
+			for (size_t i = 0; i < pairs.size(); i++) {
+				if (i != 0)
+					output += ',';
+				output += "{\"first\":\"" + getOpDisplayName(pairs[i] >> 8) + "\",\"second\":\"" + getOpDisplayName(pairs[i] & 255) + "\",\"count\":" + std::to_string(stats.pairs[pairs[i]]) + '}';
+			}
+
+			output += "],\"largest\":[";
+			for (size_t i = 0; i < stats.largest.size(); i++) {
+				if (i != 0)
+					output += ',';
+				output += "{\"id\":" + std::to_string(stats.largest[i].id) + ",\"name\":";
+				appendJsonString(output, stats.largest[i].name);
+				output += ",\"codeWords\":" + std::to_string(stats.largest[i].sizecode) + '}';
+			}
+			output += "]}";
+
+			return output;
+		}
+
+		output += "; " + std::to_string(stats.protos) + " protos, " + std::to_string(stats.instructions) + " instructions in " +
+			std::to_string(stats.codeWords) + " code words, " + std::to_string(stats.strings) + " strings\n";
+
+		output += "\n; opcodes\n";
+		for (uint32_t op : opcodes) {
+			char share[16];
+			snprintf(share, sizeof(share), "%.1f%%", 100.0 * double(stats.opcodes[op]) / double(stats.instructions));
+			output += getOpDisplayName(op) + ' ' + std::to_string(stats.opcodes[op]) + ' ' + share + '\n';
+		}
+
+		output += "\n; constants\n";
+		for (uint32_t type = 0; type < 7; type++)
+			output += std::string(CONSTANT_TYPE_NAMES[type]) + ' ' + std::to_string(stats.constantTypes[type]) + '\n';
+
+		output += "\n; opcode pairs\n";
+		for (uint32_t pair : pairs)
+			output += getOpDisplayName(pair >> 8) + ' ' + getOpDisplayName(pair & 255) + ' ' + std::to_string(stats.pairs[pair]) + '\n';
+
+		output += "\n; largest protos\n";
+		for (const OpcodeStats::LargeProto& proto : stats.largest)
+			output += "proto " + std::to_string(proto.id) + ' ' + proto.name + " ; " + std::to_string(proto.sizecode) + " code words\n";
+
+		return output;
+	}
+} // namespace LuauDisassembler
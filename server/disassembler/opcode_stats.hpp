@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	struct OpcodeStats {
+		uint32_t protos = 0;
+		uint32_t strings = 0;
+		uint64_t codeWords = 0;
+		uint64_t instructions = 0; // code words minus AUX words
+
+		uint64_t opcodes[256] = {};
+		uint64_t constantTypes[7] = {}; // by bytecode constant type, nil to closure
+
+		// Counts of each opcode followed by another in the same proto, by first * 256 + second
+		std::vector<uint32_t> pairs;
+
+		struct LargeProto {
+			uint32_t id = 0;
+			uint32_t sizecode = 0;
+			std::string name;
+		};
+		std::vector<LargeProto> largest; // largest code first
+	};
+
+	// Counts the opcodes of the bytecode straight from its code words, without deserializing it
+	// The bytecode is scanned as by scan_bytecode, so malformed input throws the same errors
+	OpcodeStats collect_opcode_stats(const char* bytecode, size_t size);
+
+	// Opcode and constant counts, the most common opcode pairs and the largest protos, as text or JSON
+	std::string format_opcode_stats(const OpcodeStats& stats, const DisassemblyOptions& options);
+}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	static uint64_t readOptionLEB128(const char* data, size_t size, size_t& offset) {
+		uint64_t result = 0;
+		uint32_t shift = 0;
+
+		uint8_t byte = 0;
+
+		do {
+			if (offset >= size || shift > 63)
+				throw std::runtime_error("Invalid options envelope");
+
+			byte = uint8_t(data[offset++]);
+			result |= uint64_t(byte & 127) << shift;
+			shift += 7;
+		} while (byte & 128);
+
+		return result;
+	}
+
+	// Page cursors are the script key, the next proto, the end of the range and the page size
+	static void decodeCursor(const std::string& cursor, DisassemblyOptions& options) {
+		unsigned long long script = 0;
+		unsigned int nextProto = 0;
+		unsigned int lastProto = 0;
+		unsigned long long pageBytes = 0;
+		int consumed = 0;
+
+		if (sscanf(cursor.c_str(), "%16llx.%u.%u.%llu%n", &script, &nextProto, &lastProto, &pageBytes, &consumed) != 4 || size_t(consumed) != cursor.size() || nextProto >= lastProto)
+			throw std::runtime_error("Invalid cursor");
+
+		options.hasCursor = true;
+		options.cursorScript = script;
+		options.firstProto = nextProto;
+		options.lastProto = lastProto;
+		options.pageBytes = size_t(pageBytes);
+	}
+
+	std::string encode_cursor(uint64_t script, uint32_t nextProto, const DisassemblyOptions& options) {
+		char cursor[80];
+		snprintf(cursor, sizeof(cursor), "%016llx.%u.%u.%llu", (unsigned long long)script, nextProto, options.lastProto, (unsigned long long)options.pageBytes);
+		return cursor;
+	}
+
+	bool DisassemblyOptions::hasProtoFilter() const {
+		return !protoIds.empty() || !protoNameGlob.empty() || firstProto != 0 || lastProto != UINT32_MAX;
+	}
+
+	bool DisassemblyOptions::wantsProto(uint32_t protoId, const std::string& debugname) const {
+		if (protoId < firstProto || protoId >= lastProto)
+			return false;
+
+		if (!protoIds.empty() && !std::binary_search(protoIds.begin(), protoIds.end(), protoId))
+			return false;
+
+		if (!protoNameGlob.empty() && !glob_match(protoNameGlob.c_str(), debugname.c_str()))
+			return false;
+
+		return true;
+	}
+
+	size_t parse_options(const char* data, size_t size, DisassemblyOptions& options) {
+		if (size < sizeof(OPTIONS_MAGIC) || memcmp(data, OPTIONS_MAGIC, sizeof(OPTIONS_MAGIC)) != 0)
+			return 0;
+
+		size_t offset = sizeof(OPTIONS_MAGIC);
+
+		// Applied after the other fields, a cursor overrides the range and page size
+		std::string cursor;
+		bool hasCursor = false;
+
+		for (;;) {
+			if (offset >= size)
+				throw std::runtime_error("Invalid options envelope");
+
+			uint8_t tag = uint8_t(data[offset++]);
+			if (tag == OPTION_END)
+				break;
+
+			uint64_t length = readOptionLEB128(data, size, offset);
+			if (length > size - offset)
+				throw std::runtime_error("Invalid options envelope");
+
+			const char* field = data + offset;
+			size_t fieldEnd = offset + size_t(length);
+
+			switch (tag) {
+			case OPTION_LINE_INFO: {
+				options.displayLineInfo = length > 0 && field[0] != 0;
+				break;
+			}
+			case OPTION_BLOCKS: {
+				options.showBlocks = length > 0 && field[0] != 0;
+				break;
+			}
+			case OPTION_OUTPUT_FORMAT: {
+				if (length < 1 || uint8_t(field[0]) > uint8_t(OutputFormat::Json))
+					throw std::runtime_error("Unknown output format");
+				options.format = OutputFormat(field[0]);
+				break;
+			}
+			case OPTION_PROTO_IDS: {
+				size_t fieldOffset = 0;
+				while (fieldOffset < length)
+					options.protoIds.push_back(uint32_t(readOptionLEB128(field, size_t(length), fieldOffset)));
+				break;
+			}
+			case OPTION_PROTO_NAME: {
+				options.protoNameGlob.assign(field, size_t(length));
+				break;
+			}
+			case OPTION_MAX_OUTPUT_BYTES: {
+				size_t fieldOffset = 0;
+				options.maxOutputBytes = size_t(readOptionLEB128(field, size_t(length), fieldOffset));
+				break;
+			}
+			case OPTION_ENCODING: {
+				if (length < 1 || uint8_t(field[0]) > uint8_t(ResponseEncoding::Base64))
+					throw std::runtime_error("Unknown response encoding");
+				options.encoding = ResponseEncoding(field[0]);
+				break;
+			}
+			case OPTION_MODE: {
+				if (length < 1 || uint8_t(field[0]) > uint8_t(RequestMode::Signatures))
+					throw std::runtime_error("Unknown request mode");
+				options.mode = RequestMode(field[0]);
+				break;
+			}
+			case OPTION_REFERENCE_QUERY: {
+				options.referenceQueries.emplace_back(field, size_t(length));
+				break;
+			}
+			case OPTION_DIFF_BASE_SIZE: {
+				size_t fieldOffset = 0;
+				options.diffBaseSize = size_t(readOptionLEB128(field, size_t(length), fieldOffset));
+				break;
+			}
+			case OPTION_DEADLINE_MS: {
+				size_t fieldOffset = 0;
+				options.deadlineMilliseconds = uint32_t(std::min<uint64_t>(readOptionLEB128(field, size_t(length), fieldOffset), UINT32_MAX));
+				break;
+			}
+			case OPTION_UPLOAD_SIZE: {
+				size_t fieldOffset = 0;
+				options.uploadSize = size_t(readOptionLEB128(field, size_t(length), fieldOffset));
+				break;
+			}
+			case OPTION_PAGE_BYTES: {
+				size_t fieldOffset = 0;
+				options.pageBytes = size_t(readOptionLEB128(field, size_t(length), fieldOffset));
+				break;
+			}
+			case OPTION_PROTO_RANGE: {
+				size_t fieldOffset = 0;
+				uint64_t first = readOptionLEB128(field, size_t(length), fieldOffset);
+				uint64_t count = readOptionLEB128(field, size_t(length), fieldOffset);
+				options.firstProto = uint32_t(std::min<uint64_t>(first, UINT32_MAX));
+				options.lastProto = count ? uint32_t(std::min<uint64_t>(first + count, UINT32_MAX)) : UINT32_MAX;
+				break;
+			}
+			case OPTION_CALL_NOTES: {
+				options.annotateCalls = length > 0 && field[0] != 0;
+				break;
+			}
+			case OPTION_SCRIPT_NAME: {
+				options.scriptName.assign(field, size_t(length));
+				break;
+			}
+			case OPTION_CONSTANT_PROTOS: {
+				options.listConstantProtos = length > 0 && field[0] != 0;
+				break;
+			}
+			case OPTION_SIGNATURE_MATCHES: {
+				options.matchSignatures = length > 0 && field[0] != 0;
+				break;
+			}
+			case OPTION_CURSOR: {
+				cursor.assign(field, size_t(length));
+				hasCursor = true;
+				break;
+			}
+			default: {
+				// Unknown fields are skipped so newer clients keep working against older servers
+				break;
+			}
+			}
+
+			offset = fieldEnd;
+		}
+
+		if (hasCursor)
+			decodeCursor(cursor, options);
+
+		// Sorted once here, wantsProto looks every proto up in it
+		std::sort(options.protoIds.begin(), options.protoIds.end());
+		options.protoIds.erase(std::unique(options.protoIds.begin(), options.protoIds.end()), options.protoIds.end());
+
+		return offset;
+	}
+
+	bool glob_match(const char* pattern, const char* str) {
+		// Iterative matcher that only ever backtracks to the last '*', so it stays linear-ish on adversarial patterns
+		const char* starPattern = nullptr;
+		const char* starStr = nullptr;
+
+		while (*str) {
+			if (*pattern == '*') {
+				starPattern = ++pattern;
+				starStr = str;
+			}
+			else if (*pattern == '?' || *pattern == *str) {
+				pattern++;
+				str++;
+			}
+			else if (starPattern) {
+				pattern = starPattern;
+				str = ++starStr;
+			}
+			else {
+				return false;
+			}
+		}
+
+		while (*pattern == '*')
+			pattern++;
+
+		return *pattern == '\0';
+	}
+
+	const char* getRequestModeName(RequestMode mode) {
+		switch (mode) {
+		case RequestMode::Disassemble: return "disassemble";
+		case RequestMode::References: return "references";
+		case RequestMode::Diff: return "diff";
+		case RequestMode::Stats: return "stats";
+		case RequestMode::Similar: return "similar";
+		case RequestMode::Opcodes: return "opcodes";
+		case RequestMode::Constants: return "constants";
+		case RequestMode::Signatures: return "signatures";
+		}
+		return "unknown";
+	}
+} // namespace LuauDisassembler
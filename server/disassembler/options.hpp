@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace LuauDisassembler {
+	// A request frame may start with an options envelope before the bytecode:
+	// the "LDOP" magic, then fields encoded as a tag byte, a LEB128 payload length and the payload, terminated by OPTION_END
+	// Bytecode always starts with its version byte, so frames without the magic are treated as plain bytecode with default options
+	constexpr char OPTIONS_MAGIC[4] = { 'L', 'D', 'O', 'P' };
+
+	enum OptionTag : uint8_t {
+		OPTION_END = 0x00,
+
+		// u8: 1 to prefix every instruction with its source line
+		OPTION_LINE_INFO = 0x01,
+
+		// u8: OutputFormat
+		OPTION_OUTPUT_FORMAT = 0x02,
+
+		// LEB128 list: global ids of the protos to output
+		OPTION_PROTO_IDS = 0x03,
+
+		// string: glob ('*' and '?') matched against the proto debugname
+		OPTION_PROTO_NAME = 0x04,
+
+		// LEB128: output is cut off with a truncation marker once it grows past this many bytes (0 = unlimited)
+		OPTION_MAX_OUTPUT_BYTES = 0x05,
+
+		// u8: ResponseEncoding
+		OPTION_ENCODING = 0x06,
+
+		// u8: 1 to split protos into basic blocks, with labels and predecessor lists
+		OPTION_BLOCKS = 0x07,
+
+		// u8: RequestMode
+		OPTION_MODE = 0x08,
+
+		// string: glob matched against referenced names (game.Players, print, :FireServer, .Name); may be repeated
+		OPTION_REFERENCE_QUERY = 0x09,
+
+		// LEB128: for diff requests, size of the old bytecode; the new bytecode follows it in the frame
+		OPTION_DIFF_BASE_SIZE = 0x0A,
+
+		// LEB128: milliseconds from when the server received the request, past which output stops with a truncation marker
+		OPTION_DEADLINE_MS = 0x0B,
+
+		// LEB128: total size of bytecode uploaded in pieces; the frame holds the first piece, the connection's next frames
+		// are raw continuation bytes (no envelope) until the total is reached
+		OPTION_UPLOAD_SIZE = 0x0C,
+
+		// LEB128: disassembly is split into pages of about this many bytes, each ending after the proto that fills it, with
+		// a cursor for the next page
+		OPTION_PAGE_BYTES = 0x0D,
+
+		// LEB128 first, LEB128 count: only output protos with global ids in [first, first + count) (count 0 = to the end)
+		OPTION_PROTO_RANGE = 0x0E,
+
+		// string: cursor from the previous page; resumes with that page's range and page size. The bytecode may be left
+		// out while the server still has the script cached
+		OPTION_CURSOR = 0x0F,
+
+		// u8: 1 to note what CALL, SETTABLEKS, RETURN and FASTCALL instructions work on, e.g. game:GetService('Players')
+		OPTION_CALL_NOTES = 0x10,
+
+		// string: name a similar request's protos are indexed under, reported when later scripts match them (default: a
+		// hash of the bytecode)
+		OPTION_SCRIPT_NAME = 0x11,
+
+		// u8: 1 for constants requests to list the global ids of the protos using each constant
+		OPTION_CONSTANT_PROTOS = 0x12,
+
+		// u8: 1 to list the matches of the server's signature set in each proto's header
+		OPTION_SIGNATURE_MATCHES = 0x13,
+	};
+
+	enum class RequestMode : uint8_t {
+		Disassemble = 0,
+		References = 1,
+		Diff = 2,
+		Stats = 3, // answered by the server with its request statistics, no bytecode needed
+		Similar = 4, // protos matching ones from earlier similar requests, which then add the script's protos to the index
+		Opcodes = 5, // opcode, opcode pair and constant counts and the largest protos, read from the bytecode without deserializing it
+		Constants = 6, // the distinct strings, numbers and import paths used as constants, also without deserializing
+		Signatures = 7, // matches of the server's signature set, also without deserializing
+	};
+
+	enum class OutputFormat : uint8_t {
+		Text = 0,
+		Json = 1,
+	};
+
+	// How the response is put on the wire; disassembly can contain arbitrary bytes from string constants,
+	// which aren't always valid UTF-8 for a text frame
+	enum class ResponseEncoding : uint8_t {
+		Text = 0,
+		Binary = 1,
+		Base64 = 2,
+	};
+
+	struct DisassemblyOptions {
+		RequestMode mode = RequestMode::Disassemble;
+
+		bool displayLineInfo = false;
+		bool showBlocks = false;
+		bool annotateCalls = false;
+		OutputFormat format = OutputFormat::Text;
+		ResponseEncoding encoding = ResponseEncoding::Text;
+
+		std::vector<uint32_t> protoIds; // sorted by parse_options
+		std::string protoNameGlob;
+
+		size_t maxOutputBytes = 0;
+
+		std::vector<std::string> referenceQueries;
+
+		size_t diffBaseSize = 0;
+
+		std::string scriptName;
+
+		bool listConstantProtos = false;
+
+		bool matchSignatures = false;
+
+		uint32_t deadlineMilliseconds = 0; // 0 = none
+
+		size_t uploadSize = 0; // 0 = the whole bytecode is in the frame
+
+		// Protos [firstProto, lastProto) are output, a cursor moves firstProto to where its page ended
+		uint32_t firstProto = 0;
+		uint32_t lastProto = UINT32_MAX;
+
+		size_t pageBytes = 0; // 0 = everything in one response
+		bool hasCursor = false;
+		uint64_t cursorScript = 0; // script cache key of the bytecode the cursor was made for
+
+		bool isPaged() const { return pageBytes || hasCursor; }
+
+		bool hasProtoFilter() const;
+		bool wantsProto(uint32_t protoId, const std::string& debugname) const;
+	};
+
+	// Parses the options envelope at the start of a request frame, if there is one
+	// Returns the offset at which the bytecode starts
+	size_t parse_options(const char* data, size_t size, DisassemblyOptions& options);
+
+	// Cursor of the page starting at nextProto, opaque to clients
+	std::string encode_cursor(uint64_t script, uint32_t nextProto, const DisassemblyOptions& options);
+
+	bool glob_match(const char* pattern, const char* str);
+
+	const char* getRequestModeName(RequestMode mode);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace LuauDisassembler {
+	enum LuaType : uint8_t {
+		LUA_TNIL,
+		LUA_TBOOLEAN,
+		LUA_TNUMBER,
+		LUA_TSTRING,
+		LUA_TIMPORT,
+		LUA_TTABLE,
+		LUA_TCLOSURE,
+	};
+
+	struct LuaImport {
+		uint8_t count = 0;
+		std::string displayString;
+		uint32_t id = 0; // the import id as encoded, with the constant index of each part of the path
+	};
+
+	struct LuaValue {
+		uint8_t type = LUA_TNIL;
+
+		bool boolean = false;
+		double number = 0.0;
+		std::string str;
+		LuaImport import;
+
+		uint32_t closure = 0; // global id of the proto, for LUA_TCLOSURE
+		std::vector<uint32_t> tableKeys; // constant indices of the keys, for LUA_TTABLE
+	};
+
+	struct Proto {
+		uint8_t maxstacksize = 0;
+		uint8_t numparams = 0;
+		uint8_t nups = 0;
+		uint8_t is_vararg = 0;
+
+		std::vector<uint32_t> code;
+		std::vector<LuaValue> k;
+		std::vector<uint32_t> p;
+		uint8_t* lineinfo;
+		int* abslineinfo;
+
+		std::string debugname = "UNNAMED";
+
+		uint8_t linegaplog2 = 0;
+		uint32_t sizelineinfo = 0;
+
+		uint32_t sizelocvars = 0;
+		uint32_t sizeupvalues = 0;
+
+		uint32_t linedefined = 0;
+
+		Proto() :
+			maxstacksize(0),
+			numparams(0),
+			nups(0),
+			is_vararg(0),
+			code(),
+			k(),
+			p(),
+			lineinfo(nullptr),
+			abslineinfo(nullptr),
+			debugname("UNNAMED"),
+			linegaplog2(0),
+			sizelineinfo(0),
+			sizelocvars(0),
+			sizeupvalues(0),
+			linedefined(0)
+		{}
+		~Proto() {
+			delete[] lineinfo;
+		}
+	};
+}
\ No newline at end of file
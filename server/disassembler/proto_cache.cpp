@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+
+#include "hash.hpp"
+#include "proto_cache.hpp"
+
+namespace LuauDisassembler {
+	uint64_t get_proto_cache_key(const Proto* p, const DisassemblyOptions& options) {
+		KeyedHasher h;
+		h.add(uint64_t(options.displayLineInfo) | uint64_t(options.showBlocks) << 1 | uint64_t(options.annotateCalls) << 2 | uint64_t(options.format) << 8);
+
+		h.add(reinterpret_cast<const char*>(p->code.data()), p->code.size() * sizeof(uint32_t));
+
+		// The rendering shows constants both by index and by value, so they are hashed in order
+		h.add(uint64_t(p->k.size()));
+		for (const LuaValue& constant : p->k) {
+			h.add(constant.type);
+			switch (constant.type) {
+			case LUA_TBOOLEAN: {
+				h.add(uint64_t(constant.boolean));
+				break;
+			}
+			case LUA_TNUMBER: {
+				uint64_t bits;
+				memcpy(&bits, &constant.number, sizeof(bits));
+				h.add(bits);
+				break;
+			}
+			case LUA_TSTRING: {
+				h.add(constant.str);
+				break;
+			}
+			case LUA_TIMPORT: {
+				h.add(constant.import.displayString);
+				break;
+			}
+			case LUA_TCLOSURE: {
+				h.add(uint64_t(constant.closure));
+				break;
+			}
+			case LUA_TTABLE: {
+				h.add(reinterpret_cast<const char*>(constant.tableKeys.data()), constant.tableKeys.size() * sizeof(uint32_t));
+				break;
+			}
+			default: {
+				break;
+			}
+			}
+		}
+
+		// Only the offsets and the absolute lines, not the padding between them
+		if (options.displayLineInfo && p->lineinfo) {
+			size_t intervals = ((p->code.size() - 1) >> p->linegaplog2) + 1;
+			h.add(uint64_t(p->linegaplog2));
+			h.add(reinterpret_cast<const char*>(p->lineinfo), p->code.size());
+			h.add(reinterpret_cast<const char*>(p->abslineinfo), intervals * sizeof(int));
+		}
+
+		return h.finish();
+	}
+
+	static thread_local uint64_t threadHits = 0;
+	static thread_local uint64_t threadMisses = 0;
+
+	ProtoCache::ProtoCache(size_t capacityBytes, size_t shardCount) :
+		shards(shardCount),
+		shardCapacity(capacityBytes / shardCount)
+	{}
+
+	std::shared_ptr<const CachedProtoBody> ProtoCache::find(uint64_t key) {
+		Shard& shard = getShard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto it = shard.index.find(key);
+		if (it == shard.index.end()) {
+			misses.fetch_add(1, std::memory_order_relaxed);
+			threadMisses++;
+			return nullptr;
+		}
+
+		shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+		hits.fetch_add(1, std::memory_order_relaxed);
+		threadHits++;
+
+		return it->second->body;
+	}
+
+	uint64_t ProtoCache::getThreadHits() {
+		return threadHits;
+	}
+
+	uint64_t ProtoCache::getThreadMisses() {
+		return threadMisses;
+	}
+
+	void ProtoCache::insert(uint64_t key, std::shared_ptr<const CachedProtoBody> body) {
+		size_t size = body->getMemoryUsage();
+		if (size > shardCapacity)
+			return;
+
+		Shard& shard = getShard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		if (shard.index.count(key))
+			return;
+
+		shard.entries.push_front({ key, std::move(body) });
+		shard.index.emplace(key, shard.entries.begin());
+		shard.memoryUsage += size;
+
+		while (shard.memoryUsage > shardCapacity) {
+			Entry& victim = shard.entries.back();
+			shard.memoryUsage -= victim.body->getMemoryUsage();
+			shard.index.erase(victim.key);
+			shard.entries.pop_back();
+		}
+	}
+
+	size_t ProtoCache::getMemoryUsage() {
+		size_t total = 0;
+		for (Shard& shard : shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			total += shard.memoryUsage;
+		}
+		return total;
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <atomic>
+#include <unordered_map>
+
+#include "proto.hpp"
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	// Rendered instructions of a proto with the global ids of its child protos left out,
+	// so the same body can be reused wherever an identical proto shows up, whatever its position in the script
+	struct CachedProtoBody {
+		std::string text;
+
+		// Global id of child proto childIndex goes at text offset
+		struct Patch {
+			size_t offset = 0;
+			uint32_t childIndex = 0;
+		};
+		std::vector<Patch> patches;
+
+		size_t getMemoryUsage() const {
+			return sizeof(CachedProtoBody) + text.capacity() + patches.capacity() * sizeof(Patch);
+		}
+	};
+
+	// Key covering everything a proto's rendered body depends on: its code, its constants and the rendering options
+	// Hits aren't compared against the proto and the cache is shared between clients, so the key is keyed with the process'
+	// secret: a client can't craft a proto whose key collides with another client's
+	uint64_t get_proto_cache_key(const Proto* p, const DisassemblyOptions& options);
+
+	// Thread-safe LRU cache of rendered proto bodies bounded by memory usage, sharded to keep lock contention down
+	class ProtoCache {
+	public:
+		explicit ProtoCache(size_t capacityBytes, size_t shardCount = 16);
+
+		std::shared_ptr<const CachedProtoBody> find(uint64_t key);
+		void insert(uint64_t key, std::shared_ptr<const CachedProtoBody> body);
+
+		uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+		uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+
+		// Lookups made by the calling thread over all caches, so a request can tell how much of it was served from cache
+		static uint64_t getThreadHits();
+		static uint64_t getThreadMisses();
+		size_t getMemoryUsage();
+
+	private:
+		struct Entry {
+			uint64_t key = 0;
+			std::shared_ptr<const CachedProtoBody> body;
+		};
+
+		struct Shard {
+			std::mutex mutex;
+			std::list<Entry> entries; // most recently used first
+			std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+			size_t memoryUsage = 0;
+		};
+
+		Shard& getShard(uint64_t key) { return shards[key % shards.size()]; }
+
+		std::vector<Shard> shards;
+		size_t shardCapacity;
+
+		std::atomic<uint64_t> hits{ 0 };
+		std::atomic<uint64_t> misses{ 0 };
+	};
+}
\ No newline at end of file
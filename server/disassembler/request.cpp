@@ -0,0 +1,325 @@
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "disassembler.hpp"
+#include "bytecode.hpp"
+#include "xref.hpp"
+#include "diff.hpp"
+#include "opcode_stats.hpp"
+#include "extract.hpp"
+#include "signature.hpp"
+#include "request.hpp"
+
+namespace LuauDisassembler {
+	using Clock = std::chrono::steady_clock;
+
+	static uint64_t getNanoseconds(Clock::time_point from, Clock::time_point to) {
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+	}
+
+	// Counts protos [first, last), a page only counts what it rendered
+	static void countProtos(const std::vector<Proto*>& protoTable, RequestMetrics& metrics, uint32_t first = 0, uint32_t last = UINT32_MAX) {
+		last = uint32_t(std::min<size_t>(last, protoTable.size()));
+		for (uint32_t protoId = first; protoId < last; protoId++) {
+			const Proto* p = protoTable[protoId];
+			metrics.protos++;
+			for (size_t pc = 0; pc < p->code.size(); pc += getOpLength(LUAU_INSN_OP(p->code[pc])))
+				metrics.instructions++;
+		}
+	}
+
+	// Signature matches in disassembly need the server's signature set
+	static const SignatureSet* getSignatures(const DisassemblyOptions& options, const RequestContext& context) {
+		if (!options.matchSignatures)
+			return nullptr;
+
+		if (!context.signatures)
+			throw std::runtime_error("This server has no signature set");
+
+		return context.signatures;
+	}
+
+	std::string run_request(const char* bytecode, size_t bytecode_size, const DisassemblyOptions& options, const RequestContext& context) {
+		Clock::time_point start = context.metrics ? Clock::now() : Clock::time_point();
+
+		switch (options.mode) {
+		case RequestMode::References: {
+			std::vector<Proto*> protoTable = deserialize_bytecode(bytecode, bytecode_size, false, context.cancellation);
+			ProtoTableOwner owner{ protoTable };
+			Clock::time_point deserialized = context.metrics ? Clock::now() : Clock::time_point();
+
+			ReferenceIndex index = build_reference_index(protoTable);
+			std::string output = format_references(index, protoTable, options);
+
+			if (context.metrics) {
+				context.metrics->deserializeNanoseconds = getNanoseconds(start, deserialized);
+				context.metrics->formatNanoseconds = getNanoseconds(deserialized, Clock::now());
+				countProtos(protoTable, *context.metrics);
+			}
+
+			return output;
+		}
+		case RequestMode::Diff: {
+			if (options.diffBaseSize == 0 || options.diffBaseSize >= bytecode_size)
+				throw std::runtime_error("Diff requests need the size of the old bytecode");
+
+			std::string output = diff_bytecode(bytecode, options.diffBaseSize, bytecode + options.diffBaseSize, bytecode_size - options.diffBaseSize, options);
+
+			// Both versions are deserialized inside the diff, so it is timed as one stage
+			if (context.metrics)
+				context.metrics->formatNanoseconds = getNanoseconds(start, Clock::now());
+
+			return output;
+		}
+		case RequestMode::Similar: {
+			if (!context.similarityIndex)
+				throw std::runtime_error("This server has no similarity index");
+
+			std::vector<Proto*> protoTable = deserialize_bytecode(bytecode, bytecode_size, false, context.cancellation);
+			ProtoTableOwner owner{ protoTable };
+			Clock::time_point deserialized = context.metrics ? Clock::now() : Clock::time_point();
+
+			std::string script = options.scriptName;
+			if (script.empty()) {
+				char key[17];
+				snprintf(key, sizeof(key), "%016llx", (unsigned long long)get_script_cache_key(bytecode, bytecode_size, false));
+				script = key;
+			}
+
+			std::string output = find_similar_protos(protoTable, script, *context.similarityIndex, options);
+
+			if (context.metrics) {
+				context.metrics->deserializeNanoseconds = getNanoseconds(start, deserialized);
+				context.metrics->formatNanoseconds = getNanoseconds(deserialized, Clock::now());
+				countProtos(protoTable, *context.metrics);
+			}
+
+			return output;
+		}
+		case RequestMode::Opcodes: {
+			OpcodeStats stats = collect_opcode_stats(bytecode, bytecode_size);
+			std::string output = format_opcode_stats(stats, options);
+
+			// Nothing is deserialized, it all counts as formatting
+			if (context.metrics) {
+				context.metrics->formatNanoseconds = getNanoseconds(start, Clock::now());
+				context.metrics->protos = stats.protos;
+				context.metrics->instructions = stats.instructions;
+			}
+
+			return output;
+		}
+		case RequestMode::Constants: {
+			ExtractedConstants constants = extract_constants(bytecode, bytecode_size, options);
+			std::string output = format_constants(constants, options);
+
+			if (context.metrics) {
+				context.metrics->formatNanoseconds = getNanoseconds(start, Clock::now());
+				context.metrics->protos = constants.protos;
+			}
+
+			return output;
+		}
+		case RequestMode::Signatures: {
+			if (!context.signatures)
+				throw std::runtime_error("This server has no signature set");
+
+			SignatureScan scan = scan_signatures(bytecode, bytecode_size, *context.signatures, options);
+			std::string output = format_signature_scan(scan, *context.signatures, options);
+
+			if (context.metrics) {
+				context.metrics->formatNanoseconds = getNanoseconds(start, Clock::now());
+				context.metrics->protos = scan.protos;
+			}
+
+			return output;
+		}
+		case RequestMode::Stats: {
+			throw std::runtime_error("Stats requests are answered by the server");
+		}
+		default: {
+			RequestRunner runner(bytecode, bytecode_size, options, context);
+			runner.step(UINT64_MAX);
+			return runner.takeResponse();
+		}
+		}
+	}
+
+	RequestRunner::RequestRunner(const char* bytecode, size_t bytecode_size, const DisassemblyOptions& options, const RequestContext& context) :
+		bytecode(bytecode),
+		bytecodeSize(bytecode_size),
+		options(options),
+		context(context)
+	{
+		if (context.cancellation)
+			cancellation = *context.cancellation;
+
+		if (options.deadlineMilliseconds && cancellation.deadline == CancellationToken::Clock::time_point::max())
+			cancellation.deadline = CancellationToken::Clock::now() + std::chrono::milliseconds(options.deadlineMilliseconds);
+
+		this->context.cancellation = &cancellation;
+	}
+
+	RequestRunner::~RequestRunner() {
+		renderer.reset();
+		free_protos(protoTable);
+	}
+
+	bool RequestRunner::step(uint64_t instructionBudget) {
+		// Only disassembly is split, references, diffs and similarity queries are cheap next to rendering
+		if (options.mode != RequestMode::Disassemble) {
+			response = run_request(bytecode, bytecodeSize, options, context);
+			return true;
+		}
+
+		Clock::time_point start = context.metrics ? Clock::now() : Clock::time_point();
+
+		if (!renderer) {
+			const SignatureSet* signatures = getSignatures(options, context);
+
+			uint64_t scriptKey = 0;
+			try {
+				if (options.isPaged())
+					scriptKey = loadScript();
+				else
+					protoTable = deserialize_bytecode(bytecode, bytecodeSize, options.displayLineInfo, &cancellation);
+			} catch (const RequestCancelled& e) {
+				if (!e.expired)
+					throw;
+
+				// Out of time before anything could be rendered, the renderer finds the deadline passed and outputs just the marker
+			}
+
+			const std::vector<Proto*>& protos = script ? script->protos : protoTable;
+			renderer = std::make_unique<ProtoRenderer>(protos, bytecodeSize * 6, options, context.protoCache, &cancellation);
+			renderer->setScriptKey(scriptKey);
+			renderer->setSignatures(signatures);
+
+			if (context.metrics) {
+				Clock::time_point deserialized = Clock::now();
+				context.metrics->deserializeNanoseconds += getNanoseconds(start, deserialized);
+				if (!script)
+					countProtos(protos, *context.metrics);
+				start = deserialized;
+			}
+		}
+
+		uint64_t hitsBefore = ProtoCache::getThreadHits();
+		uint64_t missesBefore = ProtoCache::getThreadMisses();
+
+		bool done = renderer->render(instructionBudget);
+		if (done)
+			response = renderer->finish();
+
+		if (context.metrics) {
+			if (done && script)
+				countProtos(script->protos, *context.metrics, options.firstProto, renderer->getNextProto());
+			context.metrics->formatNanoseconds += getNanoseconds(start, Clock::now());
+			context.metrics->cacheHits += uint32_t(ProtoCache::getThreadHits() - hitsBefore);
+			context.metrics->cacheMisses += uint32_t(ProtoCache::getThreadMisses() - missesBefore);
+		}
+
+		return done;
+	}
+
+	// Finds the script of a paged request in the script cache, or deserializes it and caches it for the next pages
+	uint64_t RequestRunner::loadScript() {
+		uint64_t key = bytecodeSize ? get_script_cache_key(bytecode, bytecodeSize, options.displayLineInfo) : options.cursorScript;
+		if (options.hasCursor && key != options.cursorScript)
+			throw std::runtime_error("Cursor is for a different script or line info setting");
+
+		if (context.scriptCache)
+			script = context.scriptCache->find(key);
+
+		// Keys are 64 bits, a script that isn't the one sent is deserialized again rather than served
+		if (script && bytecodeSize && script->bytecodeSize != bytecodeSize)
+			script = nullptr;
+
+		if (script) {
+			if (context.metrics)
+				context.metrics->scriptCacheHit = true;
+			return key;
+		}
+
+		if (!bytecodeSize)
+			throw std::runtime_error("Script for this cursor is no longer cached, send the bytecode again with the cursor");
+
+		std::shared_ptr<CachedScript> parsed = std::make_shared<CachedScript>();
+		parsed->protos = deserialize_bytecode(bytecode, bytecodeSize, options.displayLineInfo, &cancellation);
+		parsed->memoryUsage = get_protos_memory_usage(parsed->protos);
+		parsed->bytecodeSize = bytecodeSize;
+
+		if (context.scriptCache)
+			context.scriptCache->insert(key, parsed);
+
+		script = std::move(parsed);
+		return key;
+	}
+
+	StreamingRunner::StreamingRunner(size_t bytecode_size, const DisassemblyOptions& options, const RequestContext& context) :
+		options(options),
+		context(context),
+		stream(bytecode_size, options.displayLineInfo)
+	{
+		if (context.cancellation)
+			cancellation = *context.cancellation;
+
+		if (options.deadlineMilliseconds && cancellation.deadline == CancellationToken::Clock::time_point::max())
+			cancellation.deadline = CancellationToken::Clock::now() + std::chrono::milliseconds(options.deadlineMilliseconds);
+
+		this->context.cancellation = &cancellation;
+
+		renderer = std::make_unique<ProtoRenderer>(stream.getProtos(), bytecode_size * 6, options, context.protoCache, &cancellation);
+		renderer->setSignatures(getSignatures(options, context));
+	}
+
+	StreamingRunner::~StreamingRunner() {
+		// The renderer refers to the deserializer's proto table
+		renderer.reset();
+	}
+
+	void StreamingRunner::push(const char* data, size_t size) {
+		if (cancellation.isCancelled())
+			throw RequestCancelled(false);
+
+		Clock::time_point start = context.metrics ? Clock::now() : Clock::time_point();
+
+		size_t protosBefore = stream.getProtos().size();
+
+		stream.push(data, size);
+
+		if (context.metrics)
+			context.metrics->deserializeNanoseconds += getNanoseconds(start, Clock::now());
+
+		if (stream.getProtos().size() != protosBefore)
+			caughtUp = false;
+	}
+
+	bool StreamingRunner::step(uint64_t instructionBudget) {
+		Clock::time_point start = context.metrics ? Clock::now() : Clock::time_point();
+		uint64_t hitsBefore = ProtoCache::getThreadHits();
+		uint64_t missesBefore = ProtoCache::getThreadMisses();
+
+		caughtUp = renderer->render(instructionBudget);
+
+		bool done = renderer->isTruncated() || (caughtUp && stream.isComplete());
+		if (done)
+			response = renderer->finish();
+
+		if (context.metrics) {
+			context.metrics->formatNanoseconds += getNanoseconds(start, Clock::now());
+			context.metrics->cacheHits += uint32_t(ProtoCache::getThreadHits() - hitsBefore);
+			context.metrics->cacheMisses += uint32_t(ProtoCache::getThreadMisses() - missesBefore);
+			if (done)
+				countProtos(stream.getProtos(), *context.metrics);
+		}
+
+		return done;
+	}
+} // namespace LuauDisassembler
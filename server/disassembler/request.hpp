@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "options.hpp"
+#include "proto.hpp"
+#include "proto_cache.hpp"
+#include "script_cache.hpp"
+#include "similarity.hpp"
+#include "signature.hpp"
+#include "cancellation.hpp"
+#include "stream.hpp"
+
+namespace LuauDisassembler {
+	// Where a request spent its time, filled in by run_request when the context asks for it
+	struct RequestMetrics {
+		uint64_t deserializeNanoseconds = 0;
+		uint64_t formatNanoseconds = 0; // everything after deserialization: rendering, indexing or diffing
+		uint32_t protos = 0;
+		uint64_t instructions = 0;
+		uint32_t cacheHits = 0;
+		uint32_t cacheMisses = 0;
+		bool scriptCacheHit = false; // a paged request found its script already deserialized
+	};
+
+	// State shared between requests; everything is optional
+	struct RequestContext {
+		ProtoCache* protoCache = nullptr;
+		RequestMetrics* metrics = nullptr;
+
+		// Deserialized scripts of paged requests, so the following pages skip deserialization
+		ScriptCache* scriptCache = nullptr;
+
+		// Fingerprints of the protos of earlier similar requests; similar requests fail without it
+		SimilarityIndex* similarityIndex = nullptr;
+
+		// Loaded at startup; signature requests, and disassembly asking for signature matches, fail without it
+		const SignatureSet* signatures = nullptr;
+
+		// Checked between protos; the options' deadline is applied by RequestRunner when the token has none
+		const CancellationToken* cancellation = nullptr;
+	};
+
+	// Runs a request in the mode selected by its options and returns the response body
+	std::string run_request(const char* bytecode, size_t bytecode_size, const DisassemblyOptions& options, const RequestContext& context = {});
+
+	class ProtoRenderer;
+
+	// A request run a slice at a time, so a scheduler can put other requests between the slices of a long one
+	// Disassembly is deserialized in the first slice and then rendered a few protos per slice, other modes run whole in the
+	// first slice. Paged disassembly goes through the context's script cache, and with a cursor the bytecode can be empty
+	// while the script is still cached. The bytecode and options must outlive the runner
+	// Cancellation throws RequestCancelled out of step, a deadline that passes during disassembly ends the output early instead
+	class RequestRunner {
+	public:
+		RequestRunner(const char* bytecode, size_t bytecode_size, const DisassemblyOptions& options, const RequestContext& context = {});
+		~RequestRunner();
+
+		RequestRunner(const RequestRunner&) = delete;
+		RequestRunner& operator=(const RequestRunner&) = delete;
+
+		// Does about instructionBudget code words of work, returns true once the response is ready; metrics add up over slices
+		bool step(uint64_t instructionBudget);
+
+		std::string takeResponse() { return std::move(response); }
+
+	private:
+		const char* bytecode;
+		size_t bytecodeSize;
+		const DisassemblyOptions& options;
+		RequestContext context;
+		CancellationToken cancellation;
+
+		std::vector<Proto*> protoTable;
+		std::shared_ptr<const CachedScript> script; // paged requests render from this instead of protoTable
+		std::unique_ptr<ProtoRenderer> renderer;
+		std::string response;
+
+		uint64_t loadScript();
+	};
+
+	// A disassembly whose bytecode arrives in pieces: protos are rendered as soon as they are deserialized, so most of the
+	// work is done by the time the last piece arrives. The options must outlive the runner
+	class StreamingRunner {
+	public:
+		StreamingRunner(size_t bytecode_size, const DisassemblyOptions& options, const RequestContext& context = {});
+		~StreamingRunner();
+
+		StreamingRunner(const StreamingRunner&) = delete;
+		StreamingRunner& operator=(const StreamingRunner&) = delete;
+
+		// Deserializes what the piece completes; throws on malformed bytecode, or if the bytecode ends with the last piece
+		void push(const char* data, size_t size);
+
+		// Renders about instructionBudget code words of what is deserialized, returns true once the response is ready
+		// The response can be ready before every piece is pushed, when the output was cut off
+		bool step(uint64_t instructionBudget);
+
+		// Everything deserialized so far is rendered, the next step needs another piece
+		bool needsData() const { return caughtUp && !stream.isComplete(); }
+
+		std::string takeResponse() { return std::move(response); }
+
+	private:
+		const DisassemblyOptions& options;
+		RequestContext context;
+		CancellationToken cancellation;
+
+		StreamingDeserializer stream;
+		std::unique_ptr<ProtoRenderer> renderer;
+		bool caughtUp = true;
+		std::string response;
+	};
+}
\ No newline at end of file
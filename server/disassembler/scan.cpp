@@ -0,0 +1,303 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "proto.hpp"
+#include "scan.hpp"
+
+namespace LuauDisassembler {
+	// Bounds checked reader, every failure is reported as the same malformed bytecode error
+	struct ScanReader {
+		const char* data;
+		size_t size;
+		size_t offset = 0;
+
+		[[noreturn]] static void fail() {
+			throw std::runtime_error("Malformed bytecode");
+		}
+
+		uint8_t u8() {
+			if (offset >= size)
+				fail();
+			return uint8_t(data[offset++]);
+		}
+
+		uint32_t u32() {
+			if (size - offset < sizeof(uint32_t))
+				fail();
+			uint32_t result;
+			memcpy(&result, data + offset, sizeof(result));
+			offset += sizeof(result);
+			return result;
+		}
+
+		uint32_t leb128() {
+			uint32_t result = 0;
+			uint32_t shift = 0;
+
+			uint8_t byte = 0;
+
+			do {
+				if (shift > 28)
+					fail();
+				byte = u8();
+				result |= uint32_t(byte & 127) << shift;
+				shift += 7;
+			} while (byte & 128);
+
+			return result;
+		}
+
+		void skip(uint64_t bytes) {
+			if (bytes > size - offset)
+				fail();
+			offset += size_t(bytes);
+		}
+
+		// Counts read from the input can't be trusted, but each element takes at least minimumSize bytes to encode
+		void checkCount(uint64_t count, size_t minimumSize) {
+			if (count > (size - offset) / minimumSize)
+				fail();
+		}
+	};
+
+	BytecodeSummary scan_bytecode(const char* data, size_t size, ScanVisitor* visitor) {
+		BytecodeSummary summary;
+		ScanReader reader{ data, size };
+
+		summary.version = reader.u8();
+		if (summary.version != 2)
+			throw std::runtime_error("Invalid bytecode");
+
+		summary.stringCount = reader.leb128();
+		reader.checkCount(summary.stringCount, 1);
+		for (uint32_t i = 0; i < summary.stringCount; i++) {
+			uint32_t length = reader.leb128();
+			reader.skip(length);
+			summary.stringBytes += length;
+
+			if (visitor)
+				visitor->onString(i + 1, data + reader.offset - length, length);
+		}
+
+		auto checkStringId = [&](uint32_t id) {
+			if (id > summary.stringCount)
+				ScanReader::fail();
+		};
+
+		summary.protoCount = reader.leb128();
+		reader.checkCount(summary.protoCount, 8);
+
+		for (uint32_t i = 0; i < summary.protoCount; i++) {
+			reader.skip(4); // maxstacksize, numparams, nups, is_vararg
+
+			ScannedProto proto;
+			proto.id = i;
+
+			uint32_t sizecode = reader.leb128();
+			reader.checkCount(sizecode, sizeof(uint32_t));
+			proto.code = data + reader.offset;
+			proto.sizecode = sizecode;
+			reader.skip(uint64_t(sizecode) * sizeof(uint32_t));
+			summary.codeWords += sizecode;
+
+			uint32_t sizek = reader.leb128();
+			reader.checkCount(sizek, 1);
+			summary.constantCount += sizek;
+			proto.sizek = sizek;
+
+			for (uint32_t j = 0; j < sizek; j++) {
+				ScannedConstant constant;
+				constant.type = reader.u8();
+				switch (constant.type) {
+				case 0: { // nil
+					break;
+				}
+				case 1: { // boolean
+					constant.boolean = reader.u8() != 0;
+					break;
+				}
+				case 2: { // number
+					reader.skip(sizeof(double));
+					memcpy(&constant.number, data + reader.offset - sizeof(double), sizeof(double));
+					break;
+				}
+				case 3: { // string
+					uint32_t id = reader.leb128();
+					if (id == 0)
+						ScanReader::fail();
+					checkStringId(id);
+					constant.stringId = id;
+					summary.stringConstantCount++;
+					break;
+				}
+				case 4: { // import
+					// Import paths index constants already read, up to and including this one
+					uint32_t iid = reader.u32();
+					constant.importId = iid;
+					uint32_t count = iid >> 30;
+					if (count == 0)
+						ScanReader::fail();
+					for (uint32_t part = 0; part < count; part++) {
+						if (((iid >> (20 - part * 10)) & 1023) > j)
+							ScanReader::fail();
+					}
+					break;
+				}
+				case 5: { // table
+					uint32_t keys = reader.leb128();
+					reader.checkCount(keys, 1);
+					for (uint32_t key = 0; key < keys; key++)
+						reader.leb128();
+					break;
+				}
+				case 6: { // closure
+					reader.leb128();
+					break;
+				}
+				default: {
+					throw std::runtime_error("Unknown constant type");
+				}
+				}
+
+				if (visitor)
+					visitor->onConstant(i, j, constant);
+			}
+
+			// Children are written before their parents
+			uint32_t sizep = reader.leb128();
+			reader.checkCount(sizep, 1);
+			for (uint32_t j = 0; j < sizep; j++) {
+				if (reader.leb128() >= i)
+					ScanReader::fail();
+			}
+			summary.childCount += sizep;
+
+			reader.leb128(); // linedefined
+			proto.debugname = reader.leb128();
+			checkStringId(proto.debugname);
+
+			if (reader.u8()) { // lineinfo
+				if (sizecode == 0)
+					ScanReader::fail();
+
+				uint8_t linegaplog2 = reader.u8();
+				if (linegaplog2 > 31)
+					ScanReader::fail();
+
+				uint64_t intervals = ((uint64_t(sizecode) - 1) >> linegaplog2) + 1;
+				reader.skip(sizecode + intervals * sizeof(uint32_t));
+				summary.lineInfoBytes += ((uint64_t(sizecode) + 3) & ~uint64_t(3)) + intervals * sizeof(int);
+			}
+
+			if (reader.u8()) { // debuginfo
+				uint32_t sizelocvars = reader.leb128();
+				reader.checkCount(sizelocvars, 4);
+				for (uint32_t j = 0; j < sizelocvars; j++) {
+					reader.leb128();
+					reader.leb128();
+					reader.leb128();
+					reader.skip(1);
+				}
+
+				uint32_t sizeupvalues = reader.leb128();
+				reader.checkCount(sizeupvalues, 1);
+				for (uint32_t j = 0; j < sizeupvalues; j++)
+					reader.leb128();
+			}
+
+			if (visitor)
+				visitor->onProto(proto);
+		}
+
+		summary.mainProto = reader.leb128();
+		if (summary.protoCount == 0 || summary.mainProto >= summary.protoCount)
+			ScanReader::fail();
+
+		summary.size = reader.offset;
+		return summary;
+	}
+
+	size_t estimate_request_memory(const BytecodeSummary& summary, const DisassemblyOptions& options) {
+		// Opcode counts are read straight from the bytecode, into a fixed size table of opcode pairs
+		if (options.mode == RequestMode::Opcodes)
+			return summary.stringCount * 16 + (size_t(256) << 10);
+
+		// Constants are copied out of the bytecode once each, and listed with their protos at most once per constant
+		if (options.mode == RequestMode::Constants)
+			return size_t(summary.stringCount * 16 + summary.stringBytes * 3 + summary.constantCount * 64);
+
+		// One proto's code and constants at a time, besides the string table
+		if (options.mode == RequestMode::Signatures)
+			return size_t(summary.stringCount * 16 + summary.codeWords * 8 + summary.constantCount * sizeof(ScannedConstant));
+
+		uint64_t averageStringSize = summary.stringCount ? summary.stringBytes / summary.stringCount : 0;
+
+		uint64_t memory = 0;
+
+		// String table, which lives until deserialization finishes
+		memory += summary.stringCount * sizeof(std::string) + summary.stringBytes;
+
+		// Protos, each string constant keeps its own copy of the string
+		memory += summary.protoCount * (sizeof(Proto) + sizeof(Proto*));
+		memory += summary.codeWords * sizeof(uint32_t);
+		memory += summary.constantCount * sizeof(LuaValue) + summary.stringConstantCount * averageStringSize;
+		memory += summary.childCount * sizeof(uint32_t);
+		if (options.displayLineInfo)
+			memory += summary.lineInfoBytes;
+
+		// render_protos reserves six times the bytecode size for the output up front, a page only holds about its size
+		if (options.pageBytes)
+			memory += std::min<uint64_t>(uint64_t(summary.size) * 6, uint64_t(options.pageBytes) * 2);
+		else
+			memory += uint64_t(summary.size) * 6;
+
+		return size_t(memory);
+	}
+
+	size_t estimate_upload_memory(size_t size, const DisassemblyOptions& options) {
+		// Scanned bytecode typically needs 11 to 12 times its size, the rest is headroom for constant heavy protos
+		uint64_t memory = uint64_t(size) * 16;
+		if (options.displayLineInfo)
+			memory += size;
+
+		return size_t(memory);
+	}
+
+	uint64_t estimate_request_work(const BytecodeSummary& summary, const DisassemblyOptions& options) {
+		// A table increment per instruction instead of a line of text
+		if (options.mode == RequestMode::Opcodes)
+			return summary.codeWords / 32 + summary.constantCount / 8;
+
+		// Code is skipped, only the constants are read
+		if (options.mode == RequestMode::Constants)
+			return summary.codeWords / 256 + summary.constantCount + summary.stringBytes / 16;
+
+		// A transition table lookup per instruction
+		if (options.mode == RequestMode::Signatures)
+			return summary.codeWords / 16 + summary.constantCount / 8;
+
+		// Rendering dominates, at roughly the same cost per code word whatever the opcode; deserialization is an order of
+		// magnitude cheaper and mostly goes on strings and constants
+		uint64_t work = summary.codeWords + summary.constantCount + summary.stringBytes / 16;
+
+		// Blocks add a CFG pass and a label per block, call notes a CFG and a register tracking pass, signatures an automaton
+		// pass, line info a lookup per instruction
+		if (options.showBlocks)
+			work += summary.codeWords / 4;
+		if (options.annotateCalls)
+			work += summary.codeWords / 2;
+		if (options.matchSignatures)
+			work += summary.codeWords / 16;
+		if (options.displayLineInfo)
+			work += summary.codeWords / 8;
+
+		// A page renders only its share, at around 16 bytes of output per code word
+		if (options.pageBytes)
+			work = std::min<uint64_t>(work, summary.constantCount + summary.stringBytes / 16 + options.pageBytes / 16);
+
+		return work;
+	}
+} // namespace LuauDisassembler
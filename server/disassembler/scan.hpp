@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	// Sizes of everything deserialize_bytecode would build, gathered without allocating
+	struct BytecodeSummary {
+		uint8_t version = 0;
+		uint32_t stringCount = 0;
+		uint64_t stringBytes = 0;
+		uint32_t protoCount = 0;
+		uint64_t codeWords = 0;
+		uint64_t constantCount = 0;
+		uint64_t stringConstantCount = 0;
+		uint64_t childCount = 0;
+		uint64_t lineInfoBytes = 0; // what deserialize_bytecode allocates for line info when it is kept
+		uint32_t mainProto = 0;
+		size_t size = 0; // bytes the bytecode occupies, anything after is not part of it
+	};
+
+	// A proto as scan_bytecode passes it to a visitor, once everything up to its debug info has been checked
+	struct ScannedProto {
+		uint32_t id = 0;
+		const char* code = nullptr; // sizecode little endian words straight from the bytecode, not necessarily aligned
+		uint32_t sizecode = 0;
+		uint32_t sizek = 0;
+		uint32_t debugname = 0; // string id, 0 = none
+	};
+
+	struct ScannedConstant {
+		uint8_t type = 0; // LuaValue's numbering, nil to closure
+		bool boolean = false;
+		double number = 0;
+		uint32_t stringId = 0; // from 1
+		uint32_t importId = 0; // count in the top 2 bits, then up to three 10-bit constant indices of the path's strings
+	};
+
+	// Lets a request read what it needs from the bytecode as it is scanned, without deserializing it
+	struct ScanVisitor {
+		virtual ~ScanVisitor() = default;
+
+		// Strings are numbered from 1, as constants and debug names refer to them
+		virtual void onString(uint32_t /*id*/, const char* /*data*/, uint32_t /*length*/) {}
+		virtual void onConstant(uint32_t /*protoId*/, uint32_t /*index*/, const ScannedConstant& /*constant*/) {}
+		virtual void onProto(const ScannedProto& /*proto*/) {}
+	};
+
+	// Walks the bytecode the same way deserialize_bytecode reads it, with the same checks but without allocating: every read
+	// against the size and every string, constant and proto id against what precedes it. Throws std::runtime_error on
+	// malformed input. Instruction operands aren't checked here, only by deserialization
+	BytecodeSummary scan_bytecode(const char* data, size_t size, ScanVisitor* visitor = nullptr);
+
+	// Upper estimate of the memory a request over this bytecode needs: deserialized protos and the output buffer
+	size_t estimate_request_memory(const BytecodeSummary& summary, const DisassemblyOptions& options);
+
+	// The same estimate for bytecode uploaded in pieces, which can't be scanned before it arrives: from its declared size alone
+	size_t estimate_upload_memory(size_t size, const DisassemblyOptions& options);
+
+	// Rough cost of a request over this bytecode in code words rendered, the unit of RequestRunner's slice budget
+	uint64_t estimate_request_work(const BytecodeSummary& summary, const DisassemblyOptions& options);
+}
\ No newline at end of file
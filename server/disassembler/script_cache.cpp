@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <iterator>
+
+#include "hash.hpp"
+#include "disassembler.hpp"
+#include "script_cache.hpp"
+
+namespace LuauDisassembler {
+	CachedScript::~CachedScript() {
+		free_protos(protos);
+	}
+
+	uint64_t get_script_cache_key(const char* bytecode, size_t size, bool keepLineInfo) {
+		KeyedHasher h;
+		h.add(uint64_t(keepLineInfo));
+		h.add(bytecode, size);
+		return h.finish();
+	}
+
+	size_t get_protos_memory_usage(const std::vector<Proto*>& protos) {
+		size_t memory = protos.capacity() * sizeof(Proto*);
+
+		for (const Proto* p : protos) {
+			memory += sizeof(Proto) + p->debugname.capacity();
+			memory += p->code.capacity() * sizeof(uint32_t);
+			memory += p->p.capacity() * sizeof(uint32_t);
+			memory += p->sizelineinfo;
+
+			memory += p->k.capacity() * sizeof(LuaValue);
+			for (const LuaValue& constant : p->k)
+				memory += constant.str.capacity() + constant.import.displayString.capacity() + constant.tableKeys.capacity() * sizeof(uint32_t);
+		}
+
+		return memory;
+	}
+
+	ScriptCache::ScriptCache(size_t capacityBytes) :
+		capacity(capacityBytes)
+	{}
+
+	std::shared_ptr<const CachedScript> ScriptCache::find(uint64_t key) {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = index.find(key);
+		if (it == index.end()) {
+			misses.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		entries.splice(entries.begin(), entries, it->second);
+		hits.fetch_add(1, std::memory_order_relaxed);
+
+		return it->second->script;
+	}
+
+	void ScriptCache::insert(uint64_t key, std::shared_ptr<const CachedScript> script) {
+		size_t size = script->memoryUsage;
+		if (size > capacity)
+			return;
+
+		// Evicted scripts are freed outside the lock, a request still paging through one keeps it alive until it is done
+		std::list<Entry> evicted;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (index.count(key))
+				return;
+
+			entries.push_front({ key, std::move(script) });
+			index.emplace(key, entries.begin());
+			memoryUsage += size;
+
+			while (memoryUsage > capacity) {
+				Entry& victim = entries.back();
+				memoryUsage -= victim.script->memoryUsage;
+				index.erase(victim.key);
+				evicted.splice(evicted.begin(), entries, std::prev(entries.end()));
+			}
+		}
+	}
+
+	size_t ScriptCache::getMemoryUsage() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return memoryUsage;
+	}
+} // namespace LuauDisassembler
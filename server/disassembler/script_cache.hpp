@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <atomic>
+#include <unordered_map>
+
+#include "proto.hpp"
+
+namespace LuauDisassembler {
+	// Deserialized protos of a script, kept between the requests paging through its output; read only once cached
+	struct CachedScript {
+		std::vector<Proto*> protos;
+		size_t memoryUsage = 0;
+		size_t bytecodeSize = 0; // checked on a hit by requests that send the bytecode
+
+		CachedScript() = default;
+		~CachedScript();
+
+		CachedScript(const CachedScript&) = delete;
+		CachedScript& operator=(const CachedScript&) = delete;
+	};
+
+	// Key covering what the deserialized protos depend on: the bytecode, and whether line info was kept
+	// The key goes into cursors and a cursor alone can page through a cached script, so it is keyed with the process' secret:
+	// a client can't guess the key of a script it hasn't sent, or craft bytecode colliding with another client's
+	uint64_t get_script_cache_key(const char* bytecode, size_t size, bool keepLineInfo);
+
+	size_t get_protos_memory_usage(const std::vector<Proto*>& protos);
+
+	// Thread-safe LRU cache of deserialized scripts bounded by memory usage
+	// Lookups happen once per page rather than once per proto, so a single lock is enough
+	class ScriptCache {
+	public:
+		explicit ScriptCache(size_t capacityBytes);
+
+		std::shared_ptr<const CachedScript> find(uint64_t key);
+		void insert(uint64_t key, std::shared_ptr<const CachedScript> script);
+
+		uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+		uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+		size_t getMemoryUsage();
+
+	private:
+		struct Entry {
+			uint64_t key = 0;
+			std::shared_ptr<const CachedScript> script;
+		};
+
+		std::mutex mutex;
+		std::list<Entry> entries; // most recently used first
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+		size_t memoryUsage = 0;
+		size_t capacity;
+
+		std::atomic<uint64_t> hits{ 0 };
+		std::atomic<uint64_t> misses{ 0 };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,611 @@
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <charconv>
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include "bytecode.hpp"
+#include "scan.hpp"
+#include "disassembler.hpp"
+#include "signature.hpp"
+
+namespace LuauDisassembler {
+	constexpr uint32_t NO_CONSTANT = UINT32_MAX;
+	constexpr uint32_t NO_STATE = UINT32_MAX;
+
+	// Set on transitions into states some signature ends in, so the scan only looks at outputs when there are some
+	constexpr uint32_t HAS_OUTPUT = 0x80000000;
+
+	struct OpLengthTable {
+		uint8_t lengths[256];
+
+		OpLengthTable() {
+			for (uint32_t op = 0; op < 256; op++)
+				lengths[op] = uint8_t(getOpLength(uint8_t(op)));
+		}
+	};
+
+	static const OpLengthTable OP_LENGTHS;
+
+	// States this many opcodes deep or less get a full row of transitions; there are few of them, and most of a scan is spent
+	// in them, while the rows of all the deeper states wouldn't fit in the cache with a few thousand signatures
+	constexpr uint32_t DENSE_DEPTH = 2;
+
+	// Index of the constant an instruction uses, NO_CONSTANT for opcodes that use none
+	static uint32_t getConstantOperand(const uint32_t* code, uint32_t sizecode, uint32_t pc) {
+		uint32_t instruction = code[pc];
+		uint32_t aux = pc + 1 < sizecode ? code[pc + 1] : NO_CONSTANT;
+
+		switch (LUAU_INSN_OP(instruction)) {
+		case LOP_LOADK:
+		case LOP_GETIMPORT: {
+			return uint32_t(LUAU_INSN_D(instruction));
+		}
+		case LOP_ADDK:
+		case LOP_SUBK:
+		case LOP_MULK:
+		case LOP_DIVK:
+		case LOP_MODK:
+		case LOP_POWK:
+		case LOP_ANDK:
+		case LOP_ORK: {
+			return LUAU_INSN_C(instruction);
+		}
+		case LOP_LOADKX:
+		case LOP_GETGLOBAL:
+		case LOP_SETGLOBAL:
+		case LOP_GETTABLEKS:
+		case LOP_SETTABLEKS:
+		case LOP_NAMECALL:
+		case LOP_FASTCALL2K:
+		case LOP_JUMPIFEQK:
+		case LOP_JUMPIFNOTEQK: {
+			return aux;
+		}
+		default: {
+			return NO_CONSTANT;
+		}
+		}
+	}
+
+	static bool usesConstant(uint8_t op) {
+		uint32_t code[2] = { op, 0 };
+		return getConstantOperand(code, 2, 0) != NO_CONSTANT;
+	}
+
+	static void appendNumber(std::string& text, double number) {
+		char buffer[32];
+		std::to_chars_result formatted = std::to_chars(buffer, buffer + sizeof(buffer), number);
+		text.append(buffer, formatted.ptr);
+	}
+
+	// Reads the opcodes and pins after a signature's colon
+	struct SignatureParser {
+		const std::string& line;
+		size_t position;
+		uint32_t lineNumber;
+
+		[[noreturn]] void fail(const std::string& message) {
+			throw std::runtime_error("Signature line " + std::to_string(lineNumber) + ": " + message);
+		}
+
+		void skipSpace() {
+			while (position < line.size() && isspace((unsigned char)line[position]))
+				position++;
+		}
+
+		std::string readQuoted() {
+			std::string text;
+			for (position++; position < line.size(); position++) {
+				char c = line[position];
+				if (c == '"') {
+					position++;
+					return text;
+				}
+				if (c == '\\' && position + 1 < line.size())
+					c = line[++position];
+				text += c;
+			}
+			fail("unterminated string");
+		}
+
+		std::string readWord() {
+			size_t start = position;
+			while (position < line.size() && !isspace((unsigned char)line[position]) && line[position] != '"')
+				position++;
+			return line.substr(start, position - start);
+		}
+	};
+
+	SignatureSet::SignatureSet(const std::string& text) {
+		// Opcode names as getOpName spells them
+		std::vector<std::pair<std::string, uint8_t>> opcodeNames;
+		for (uint32_t op = 0; op < 256; op++) {
+			if (const char* name = getOpName(uint8_t(op)))
+				opcodeNames.emplace_back(name, uint8_t(op));
+		}
+
+		std::vector<std::vector<uint8_t>> opcodes;
+
+		uint32_t lineNumber = 0;
+		size_t lineStart = 0;
+		while (lineStart < text.size()) {
+			size_t lineEnd = text.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = text.size();
+
+			std::string line = text.substr(lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 1;
+			lineNumber++;
+
+			SignatureParser parser{ line, 0, lineNumber };
+			parser.skipSpace();
+			if (parser.position == line.size() || line[parser.position] == '#')
+				continue;
+
+			size_t colon = line.find(':');
+			if (colon == std::string::npos)
+				parser.fail("expected a name and a colon");
+
+			Signature signature;
+			signature.name = line.substr(parser.position, colon - parser.position);
+			signature.name.erase(signature.name.find_last_not_of(" \t") + 1);
+			if (signature.name.empty())
+				parser.fail("missing name");
+
+			std::vector<uint8_t> sequence;
+			parser.position = colon + 1;
+			while (true) {
+				parser.skipSpace();
+				if (parser.position == line.size())
+					break;
+
+				if (line[parser.position] == '"') {
+					if (sequence.empty() || (!signature.pins.empty() && signature.pins.back().instruction == sequence.size() - 1))
+						parser.fail("a constant has to follow an opcode");
+					if (!usesConstant(sequence.back()))
+						parser.fail(std::string(getOpName(sequence.back())) + " doesn't use a constant");
+
+					signature.pins.push_back({ uint32_t(sequence.size() - 1), parser.readQuoted() });
+					continue;
+				}
+
+				std::string word = parser.readWord();
+				for (char& c : word)
+					c = char(toupper((unsigned char)c));
+
+				bool found = false;
+				for (const std::pair<std::string, uint8_t>& opcode : opcodeNames) {
+					if (opcode.first == word) {
+						sequence.push_back(opcode.second);
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+					parser.fail("unknown opcode " + word);
+			}
+
+			if (sequence.empty())
+				parser.fail("no opcodes");
+
+			signature.length = uint32_t(sequence.size());
+			while (pinWindow < signature.length)
+				pinWindow *= 2;
+
+			signatures.push_back(std::move(signature));
+			opcodes.push_back(std::move(sequence));
+		}
+
+		compile(opcodes);
+	}
+
+	void SignatureSet::compile(const std::vector<std::vector<uint8_t>>& opcodes) {
+		// Only the opcodes signatures use get a symbol of their own, which keeps the transition table a fraction of
+		// 256 entries per state
+		for (const std::vector<uint8_t>& sequence : opcodes) {
+			for (uint8_t op : sequence) {
+				if (symbols[op] == 0)
+					symbols[op] = uint8_t(alphabetSize++);
+			}
+		}
+
+		// Trie of the sequences, missing transitions left as NO_STATE
+		transitions.assign(alphabetSize, NO_STATE);
+		std::vector<std::vector<uint32_t>> stateOutputs(1);
+
+		for (uint32_t signature = 0; signature < opcodes.size(); signature++) {
+			uint32_t state = 0;
+			for (uint8_t op : opcodes[signature]) {
+				uint32_t& next = transitions[size_t(state) * alphabetSize + symbols[op]];
+				if (next == NO_STATE) {
+					next = uint32_t(stateOutputs.size());
+					stateOutputs.emplace_back();
+					transitions.resize(transitions.size() + alphabetSize, NO_STATE);
+				}
+				state = transitions[size_t(state) * alphabetSize + symbols[op]];
+			}
+			stateOutputs[state].push_back(signature);
+		}
+
+		// The trie alone, for the children of the states that don't get a full row
+		std::vector<uint32_t> trie = transitions;
+
+		// Breadth first, so a state's failure link is done before it: missing transitions become those of the failure
+		// link, and outputs take in the failure link's outputs, which are the signatures ending in a suffix
+		uint32_t stateCount = uint32_t(stateOutputs.size());
+		std::vector<uint32_t> failure(stateCount, 0);
+		std::vector<uint32_t> depth(stateCount, 0);
+		std::vector<uint32_t> queue;
+		queue.reserve(stateCount);
+
+		for (uint32_t symbol = 0; symbol < alphabetSize; symbol++) {
+			uint32_t& next = transitions[symbol];
+			if (next == NO_STATE) {
+				next = 0;
+			}
+			else {
+				depth[next] = 1;
+				queue.push_back(next);
+			}
+		}
+
+		for (size_t i = 0; i < queue.size(); i++) {
+			uint32_t state = queue[i];
+			const std::vector<uint32_t>& inherited = stateOutputs[failure[state]];
+			stateOutputs[state].insert(stateOutputs[state].end(), inherited.begin(), inherited.end());
+
+			for (uint32_t symbol = 0; symbol < alphabetSize; symbol++) {
+				uint32_t& next = transitions[size_t(state) * alphabetSize + symbol];
+				uint32_t fallback = transitions[size_t(failure[state]) * alphabetSize + symbol];
+				if (next == NO_STATE) {
+					next = fallback;
+				}
+				else {
+					failure[next] = fallback;
+					depth[next] = depth[state] + 1;
+					queue.push_back(next);
+				}
+			}
+		}
+
+		// Renumbered in breadth first order, so the shallow states get the first ids and their rows share the start of the table
+		std::vector<uint32_t> order;
+		order.reserve(stateCount);
+		order.push_back(0);
+		order.insert(order.end(), queue.begin(), queue.end());
+
+		std::vector<uint32_t> renumbered(stateCount);
+		for (uint32_t state = 0; state < stateCount; state++)
+			renumbered[order[state]] = state;
+
+		auto getTarget = [&](uint32_t state) {
+			return renumbered[state] | (stateOutputs[state].empty() ? 0 : HAS_OUTPUT);
+		};
+
+		while (denseStates < stateCount && depth[order[denseStates]] <= DENSE_DEPTH)
+			denseStates++;
+
+		std::vector<uint32_t> automaton = std::move(transitions);
+		transitions.resize(size_t(denseStates) * alphabetSize);
+		for (uint32_t state = 0; state < denseStates; state++) {
+			for (uint32_t symbol = 0; symbol < alphabetSize; symbol++)
+				transitions[size_t(state) * alphabetSize + symbol] = getTarget(automaton[size_t(order[state]) * alphabetSize + symbol]);
+		}
+
+		for (uint32_t state = denseStates; state < stateCount; state++) {
+			childOffsets.push_back(uint32_t(children.size()));
+			for (uint32_t symbol = 0; symbol < alphabetSize; symbol++) {
+				uint32_t child = trie[size_t(order[state]) * alphabetSize + symbol];
+				if (child != NO_STATE)
+					children.push_back({ symbol, getTarget(child) });
+			}
+			failures.push_back(renumbered[failure[order[state]]]);
+		}
+		childOffsets.push_back(uint32_t(children.size()));
+
+		outputOffsets.reserve(stateCount + 1);
+		for (uint32_t state = 0; state < stateCount; state++) {
+			const std::vector<uint32_t>& stateOutput = stateOutputs[order[state]];
+			outputOffsets.push_back(uint32_t(outputs.size()));
+			outputs.insert(outputs.end(), stateOutput.begin(), stateOutput.end());
+		}
+		outputOffsets.push_back(uint32_t(outputs.size()));
+	}
+
+	uint32_t SignatureSet::step(uint32_t state, uint32_t symbol) const {
+		// No signature has the opcode, so nothing can be under way after it
+		if (symbol == 0)
+			return 0;
+
+		// Failure links lead to shallower states, so this ends at a state with a full row at the latest
+		while (state >= denseStates) {
+			uint32_t sparse = state - denseStates;
+			for (uint32_t i = childOffsets[sparse]; i < childOffsets[sparse + 1]; i++) {
+				if (children[i].symbol == symbol)
+					return children[i].next;
+			}
+			state = failures[sparse];
+		}
+
+		return transitions[size_t(state) * alphabetSize + symbol];
+	}
+
+	void SignatureSet::match(const uint32_t* code, uint32_t sizecode, const SignatureConstants& constants, std::vector<SignatureMatch>& matches) const {
+		if (signatures.empty())
+			return;
+
+		// pc of each instruction so far, to find where a match starts and the instructions its pins are on
+		std::vector<uint32_t> pcs;
+		pcs.reserve(sizecode);
+
+		// Constant text of the last pinWindow instructions, by their index in pcs: signatures sharing a shape and differing in
+		// their constants check the same instructions, which are only turned into text once
+		struct PinText {
+			uint32_t instruction = UINT32_MAX;
+			bool valid = false;
+			std::string text;
+		};
+		std::vector<PinText> pinTexts;
+
+		uint32_t state = 0;
+		uint32_t pc = 0;
+		while (pc < sizecode) {
+			uint8_t op = LUAU_INSN_OP(code[pc]);
+			pcs.push_back(pc);
+			pc += OP_LENGTHS.lengths[op];
+
+			uint32_t next = step(state, symbols[op]);
+			state = next & ~HAS_OUTPUT;
+			if (!(next & HAS_OUTPUT))
+				continue;
+
+			for (uint32_t i = outputOffsets[state]; i < outputOffsets[state + 1]; i++) {
+				const Signature& signature = signatures[outputs[i]];
+				size_t first = pcs.size() - signature.length;
+
+				bool pinned = true;
+				for (const Pin& pin : signature.pins) {
+					if (pinTexts.empty())
+						pinTexts.resize(pinWindow);
+
+					uint32_t instruction = uint32_t(first + pin.instruction);
+					PinText& pinText = pinTexts[instruction & (pinWindow - 1)];
+					if (pinText.instruction != instruction) {
+						uint32_t constant = getConstantOperand(code, sizecode, pcs[instruction]);
+						pinText.instruction = instruction;
+						pinText.text.clear();
+						pinText.valid = constant != NO_CONSTANT && constants.getText(constant, pinText.text);
+					}
+
+					if (!pinText.valid || pinText.text != pin.text) {
+						pinned = false;
+						break;
+					}
+				}
+
+				if (pinned)
+					matches.push_back({ outputs[i], pcs[first] });
+			}
+		}
+	}
+
+	struct ProtoConstants : SignatureConstants {
+		const Proto* proto;
+
+		explicit ProtoConstants(const Proto* proto) :
+			proto(proto)
+		{}
+
+		bool getText(uint32_t index, std::string& text) const override {
+			if (index >= proto->k.size())
+				return false;
+
+			const LuaValue& constant = proto->k[index];
+			switch (constant.type) {
+			case LUA_TNIL: {
+				text += "nil";
+				return true;
+			}
+			case LUA_TBOOLEAN: {
+				text += constant.boolean ? "true" : "false";
+				return true;
+			}
+			case LUA_TNUMBER: {
+				appendNumber(text, constant.number);
+				return true;
+			}
+			case LUA_TSTRING: {
+				text += constant.str;
+				return true;
+			}
+			case LUA_TIMPORT: {
+				// Parts that aren't strings are displayed empty, the scan finds no text for them either
+				for (uint32_t part = 0; part < constant.import.count; part++) {
+					if (proto->k[(constant.import.id >> (20 - part * 10)) & 1023].type != LUA_TSTRING)
+						return false;
+				}
+				text += constant.import.displayString;
+				return true;
+			}
+			default: {
+				return false;
+			}
+			}
+		}
+	};
+
+	void SignatureSet::match(const Proto* p, std::vector<SignatureMatch>& matches) const {
+		match(p->code.data(), uint32_t(p->code.size()), ProtoConstants(p), matches);
+	}
+
+	struct SignatureScanner : ScanVisitor, SignatureConstants {
+		const SignatureSet& signatures;
+		const DisassemblyOptions& options;
+		SignatureScan& scan;
+
+		std::vector<std::pair<const char*, uint32_t>> strings;
+		std::vector<ScannedConstant> constants; // the current proto's
+		std::vector<uint32_t> code; // the current proto's, copied to be word aligned
+		std::vector<SignatureMatch> matches;
+
+		SignatureScanner(const SignatureSet& signatures, const DisassemblyOptions& options, SignatureScan& scan) :
+			signatures(signatures),
+			options(options),
+			scan(scan)
+		{}
+
+		void onString(uint32_t, const char* data, uint32_t length) override {
+			strings.emplace_back(data, length);
+		}
+
+		void onConstant(uint32_t, uint32_t, const ScannedConstant& constant) override {
+			constants.push_back(constant);
+		}
+
+		// Named like the deserializer names it, so name filters work the same as for disassembly
+		std::string getDebugname(const ScannedProto& proto) const {
+			if (proto.debugname == 0)
+				return "UNNAMED";
+			return std::string(strings[proto.debugname - 1].first, strings[proto.debugname - 1].second);
+		}
+
+		void onProto(const ScannedProto& proto) override {
+			if (!options.hasProtoFilter() || options.wantsProto(proto.id, getDebugname(proto))) {
+				scan.protos++;
+
+				// Without code there is nothing to match, and code.data() may be null
+				if (proto.sizecode) {
+					code.resize(proto.sizecode);
+					memcpy(code.data(), proto.code, size_t(proto.sizecode) * sizeof(uint32_t));
+					signatures.match(code.data(), proto.sizecode, *this, matches);
+				}
+
+				if (!matches.empty()) {
+					scan.matched.push_back({ proto.id, getDebugname(proto), std::move(matches) });
+					matches.clear();
+				}
+			}
+
+			constants.clear();
+		}
+
+		bool getText(uint32_t index, std::string& text) const override {
+			if (index >= constants.size())
+				return false;
+
+			const ScannedConstant& constant = constants[index];
+			switch (constant.type) {
+			case LUA_TNIL: {
+				text += "nil";
+				return true;
+			}
+			case LUA_TBOOLEAN: {
+				text += constant.boolean ? "true" : "false";
+				return true;
+			}
+			case LUA_TNUMBER: {
+				appendNumber(text, constant.number);
+				return true;
+			}
+			case LUA_TSTRING: {
+				text.append(strings[constant.stringId - 1].first, strings[constant.stringId - 1].second);
+				return true;
+			}
+			case LUA_TIMPORT: {
+				// The scan only checks that the path's parts come before this constant, any part that isn't a string (or is the
+				// import itself) leaves the path without a text to pin
+				uint32_t count = constant.importId >> 30;
+				for (uint32_t part = 0; part < count; part++) {
+					const ScannedConstant& partConstant = constants[(constant.importId >> (20 - part * 10)) & 1023];
+					if (partConstant.type != LUA_TSTRING)
+						return false;
+
+					if (part != 0)
+						text += '.';
+					text.append(strings[partConstant.stringId - 1].first, strings[partConstant.stringId - 1].second);
+				}
+				return true;
+			}
+			default: {
+				return false;
+			}
+			}
+		}
+	};
+
+	SignatureScan scan_signatures(const char* bytecode, size_t size, const SignatureSet& signatures, const DisassemblyOptions& options) {
+		SignatureScan scan;
+		SignatureScanner scanner(signatures, options, scan);
+		scan_bytecode(bytecode, size, &scanner);
+		return scan;
+	}
+
+	std::string format_signature_scan(const SignatureScan& scan, const SignatureSet& signatures, const DisassemblyOptions& options) {
+		bool json = options.format == OutputFormat::Json;
+		size_t matchCount = 0;
+
+		std::string output;
+		if (json)
+			output += "{\"protos\":[";
+
+		for (size_t i = 0; i < scan.matched.size(); i++) {
+			const SignatureScan::ProtoMatches& proto = scan.matched[i];
+			matchCount += proto.matches.size();
+
+			if (json) {
+				if (i != 0)
+					output += ',';
+				output += "{\"id\":" + std::to_string(proto.protoId) + ",\"name\":";
+				appendJsonString(output, proto.name);
+				output += ',';
+				append_signature_json(output, proto.matches, signatures);
+				output += '}';
+				continue;
+			}
+
+			output += "proto " + std::to_string(proto.protoId) + ' ' + proto.name + " ; " + std::to_string(proto.matches.size()) +
+				(proto.matches.size() == 1 ? " match\n" : " matches\n");
+			for (const SignatureMatch& match : proto.matches)
+				output += "\tpc " + std::to_string(match.pc) + ' ' + signatures.getName(match.signature) + '\n';
+		}
+
+		if (json) {
+			output += "],\"matches\":" + std::to_string(matchCount) + ",\"scanned\":" + std::to_string(scan.protos) +
+				",\"signatures\":" + std::to_string(signatures.getSize()) + '}';
+		}
+		else {
+			output += "; " + std::to_string(matchCount) + " matches in " + std::to_string(scan.matched.size()) + " of " +
+				std::to_string(scan.protos) + " protos against " + std::to_string(signatures.getSize()) + " signatures\n";
+		}
+
+		return output;
+	}
+
+	void append_signature_header(std::string& output, const std::vector<SignatureMatch>& matches, const SignatureSet& signatures) {
+		if (matches.empty())
+			return;
+
+		output += "; signatures: ";
+		for (size_t i = 0; i < matches.size(); i++) {
+			if (i != 0)
+				output += ", ";
+			output += signatures.getName(matches[i].signature) + " at pc " + std::to_string(matches[i].pc);
+		}
+		output += '\n';
+	}
+
+	void append_signature_json(std::string& output, const std::vector<SignatureMatch>& matches, const SignatureSet& signatures) {
+		output += "\"signatures\":[";
+		for (size_t i = 0; i < matches.size(); i++) {
+			if (i != 0)
+				output += ',';
+			output += "{\"pc\":" + std::to_string(matches[i].pc) + ",\"signature\":";
+			appendJsonString(output, signatures.getName(matches[i].signature));
+			output += '}';
+		}
+		output += ']';
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "proto.hpp"
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	struct SignatureMatch {
+		uint32_t signature = 0; // index in the set
+		uint32_t pc = 0; // of the first instruction
+	};
+
+	// Text of a proto's constants, for signatures pinned to them
+	struct SignatureConstants {
+		virtual ~SignatureConstants() = default;
+
+		// False for constants that can't be pinned (tables, closures) and indices out of range
+		virtual bool getText(uint32_t index, std::string& text) const = 0;
+	};
+
+	// A set of known instruction sequences, compiled into one Aho-Corasick automaton over opcodes so a proto's code is
+	// checked against every signature in a single pass
+	// A signature file has one signature per line, a name, a colon and opcode names; registers and constants match anything
+	// unless an opcode is followed by a quoted constant it has to use (string, import path, number or boolean):
+	//   kick_player: GETIMPORT "game.Players" GETTABLEKS "LocalPlayer" NAMECALL "Kick" CALL
+	// Blank lines and lines starting with # are skipped
+	class SignatureSet {
+	public:
+		// Throws std::runtime_error with the line number of the first malformed signature
+		explicit SignatureSet(const std::string& text);
+
+		size_t getSize() const { return signatures.size(); }
+		const std::string& getName(uint32_t signature) const { return signatures[signature].name; }
+
+		// Appends the matches of every signature in the code, in order of where they end
+		void match(const uint32_t* code, uint32_t sizecode, const SignatureConstants& constants, std::vector<SignatureMatch>& matches) const;
+		void match(const Proto* p, std::vector<SignatureMatch>& matches) const;
+
+	private:
+		struct Pin {
+			uint32_t instruction = 0; // position in the signature
+			std::string text;
+		};
+
+		struct Signature {
+			std::string name;
+			uint32_t length = 0;
+			std::vector<Pin> pins;
+		};
+
+		std::vector<Signature> signatures;
+		uint32_t pinWindow = 1; // the longest signature's length, rounded up to a power of 2
+
+		// Opcodes that appear in no signature share symbol 0, which always leads back to the root
+		uint8_t symbols[256] = {};
+		uint32_t alphabetSize = 1;
+
+		struct Child {
+			uint32_t symbol = 0;
+			uint32_t next = 0;
+		};
+
+		// The first denseStates states, the shallowest, go to transitions[s * alphabetSize + symbol]. Deeper states only
+		// keep their trie children, childOffsets and failures are indexed by s - denseStates, and go to their failure link's
+		// transition for other symbols. Targets have the HAS_OUTPUT bit set when signatures end there: those ending in state s,
+		// or in its suffixes, are outputs[outputOffsets[s]] up to outputs[outputOffsets[s + 1]]
+		uint32_t denseStates = 1;
+		std::vector<uint32_t> transitions;
+		std::vector<uint32_t> childOffsets;
+		std::vector<Child> children;
+		std::vector<uint32_t> failures;
+		std::vector<uint32_t> outputOffsets;
+		std::vector<uint32_t> outputs;
+
+		void compile(const std::vector<std::vector<uint8_t>>& opcodes);
+		uint32_t step(uint32_t state, uint32_t symbol) const;
+	};
+
+	struct SignatureScan {
+		struct ProtoMatches {
+			uint32_t protoId = 0;
+			std::string name;
+			std::vector<SignatureMatch> matches;
+		};
+
+		uint32_t protos = 0; // protos scanned
+		uint64_t instructions = 0;
+		std::vector<ProtoMatches> matched; // only protos with matches, in order
+	};
+
+	// Matches the wanted protos' code as the bytecode is scanned, without deserializing it
+	SignatureScan scan_signatures(const char* bytecode, size_t size, const SignatureSet& signatures, const DisassemblyOptions& options);
+
+	std::string format_signature_scan(const SignatureScan& scan, const SignatureSet& signatures, const DisassemblyOptions& options);
+
+	// Text and JSON forms of one proto's matches, as the disassembly shows them in the proto's header
+	void append_signature_header(std::string& output, const std::vector<SignatureMatch>& matches, const SignatureSet& signatures);
+	void append_signature_json(std::string& output, const std::vector<SignatureMatch>& matches, const SignatureSet& signatures);
+}
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <algorithm>
+
+#include "bytecode.hpp"
+#include "hash.hpp"
+#include "normalize.hpp"
+#include "disassembler.hpp"
+#include "similarity.hpp"
+
+namespace LuauDisassembler {
+	constexpr uint32_t LSH_ROWS = MINHASH_SIZE / LSH_BANDS;
+
+	// Entries past this many in one bucket aren't linked into it, so a query's candidate set stays bounded
+	constexpr uint32_t MAX_BUCKET_ENTRIES = 64;
+
+	constexpr size_t SIMILAR_PROTO_LIMIT = 5;
+	constexpr double MIN_SIMILARITY = 0.5;
+
+	// MinHash permutations as h * a + b on the 64-bit trigram hash, keeping the high half
+	struct MinHashSeeds {
+		uint64_t multipliers[MINHASH_SIZE];
+		uint64_t offsets[MINHASH_SIZE];
+
+		MinHashSeeds() {
+			uint64_t state = 0x2545F4914F6CDD1Dull;
+			auto next = [&] {
+				// splitmix64
+				uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				return z ^ (z >> 31);
+			};
+
+			for (uint32_t i = 0; i < MINHASH_SIZE; i++) {
+				multipliers[i] = next() | 1;
+				offsets[i] = next();
+			}
+		}
+	};
+
+	static const MinHashSeeds MINHASH_SEEDS;
+
+	static void addShingle(ProtoFingerprint& fingerprint, uint64_t shingle) {
+		for (uint32_t i = 0; i < MINHASH_SIZE; i++) {
+			uint32_t value = uint32_t((shingle * MINHASH_SEEDS.multipliers[i] + MINHASH_SEEDS.offsets[i]) >> 32);
+			fingerprint.minhash[i] = std::min(fingerprint.minhash[i], value);
+		}
+	}
+
+	// The opcode, plus the name for instructions that use a global, import, key or method
+	static uint64_t getInstructionToken(const Proto* p, size_t pc, const std::vector<uint64_t>& constantHashes) {
+		uint32_t instruction = p->code[pc];
+		uint8_t opcode = LUAU_INSN_OP(instruction);
+		uint32_t aux = pc + 1 < p->code.size() ? p->code[pc + 1] : 0;
+
+		uint32_t constant = UINT32_MAX;
+		switch (opcode) {
+		case LOP_GETIMPORT: {
+			constant = uint32_t(LUAU_INSN_D(instruction));
+			break;
+		}
+		case LOP_GETGLOBAL:
+		case LOP_SETGLOBAL:
+		case LOP_GETTABLEKS:
+		case LOP_SETTABLEKS:
+		case LOP_NAMECALL: {
+			constant = aux;
+			break;
+		}
+		default: {
+			break;
+		}
+		}
+
+		if (constant >= constantHashes.size())
+			return opcode;
+
+		Hasher h;
+		h.add(opcode);
+		h.add(constantHashes[constant]);
+		return h.finish();
+	}
+
+	std::vector<ProtoFingerprint> fingerprint_protos(const std::vector<Proto*>& protos) {
+		std::vector<ProtoFingerprint> fingerprints(protos.size());
+
+		// hash_protos' values, children are fingerprinted before their parents
+		std::vector<uint64_t> protoHashes;
+		protoHashes.reserve(protos.size());
+
+		std::vector<uint64_t> constantHashes;
+
+		for (size_t protoId = 0; protoId < protos.size(); protoId++) {
+			const Proto* p = protos[protoId];
+			ProtoFingerprint& fingerprint = fingerprints[protoId];
+			std::fill(std::begin(fingerprint.minhash), std::end(fingerprint.minhash), UINT32_MAX);
+
+			constantHashes.resize(p->k.size());
+			for (uint32_t i = 0; i < p->k.size(); i++)
+				constantHashes[i] = hash_constant(p, i, protoHashes);
+
+			Hasher exact;
+			exact.add(p->numparams);
+			exact.add(p->nups);
+			exact.add(p->is_vararg);
+
+			uint64_t tokens[3] = {};
+			for (size_t pc = 0; pc < p->code.size(); pc += getOpLength(LUAU_INSN_OP(p->code[pc]))) {
+				exact.add(hash_instruction(p, pc, protoHashes));
+
+				tokens[0] = tokens[1];
+				tokens[1] = tokens[2];
+				tokens[2] = getInstructionToken(p, pc, constantHashes);
+
+				if (++fingerprint.instructions >= 3) {
+					Hasher shingle;
+					shingle.add(tokens[0]);
+					shingle.add(tokens[1]);
+					shingle.add(tokens[2]);
+					addShingle(fingerprint, shingle.finish());
+				}
+			}
+
+			uint64_t constants = 0;
+			for (uint64_t constantHash : constantHashes)
+				constants += constantHash;
+			exact.add(constants);
+
+			fingerprint.exact = exact.finish();
+			protoHashes.push_back(fingerprint.exact);
+		}
+
+		return fingerprints;
+	}
+
+	double estimate_similarity(const ProtoFingerprint& a, const ProtoFingerprint& b) {
+		uint32_t equal = 0;
+		for (uint32_t i = 0; i < MINHASH_SIZE; i++)
+			equal += a.minhash[i] == b.minhash[i];
+
+		return double(equal) / MINHASH_SIZE;
+	}
+
+	static uint64_t getBandKey(const ProtoFingerprint& fingerprint, uint32_t band) {
+		Hasher h;
+		h.add(band);
+		for (uint32_t row = 0; row < LSH_ROWS; row++)
+			h.add(fingerprint.minhash[band * LSH_ROWS + row]);
+		return h.finish();
+	}
+
+	SimilarityIndex::SimilarityIndex(size_t maxProtos) :
+		buckets(1024),
+		maxProtos(maxProtos)
+	{}
+
+	const SimilarityIndex::Bucket* SimilarityIndex::findBucket(uint64_t key) const {
+		size_t mask = buckets.size() - 1;
+		for (size_t i = size_t(key) & mask;; i = (i + 1) & mask) {
+			const Bucket& bucket = buckets[i];
+			if (bucket.head == NONE)
+				return nullptr;
+			if (bucket.key == key)
+				return &bucket;
+		}
+	}
+
+	SimilarityIndex::Bucket& SimilarityIndex::getBucket(uint64_t key) {
+		// Kept at most half full
+		if ((bucketsUsed + 1) * 2 > buckets.size()) {
+			std::vector<Bucket> old(buckets.size() * 2);
+			old.swap(buckets);
+
+			size_t mask = buckets.size() - 1;
+			for (const Bucket& bucket : old) {
+				if (bucket.head == NONE)
+					continue;
+
+				size_t i = size_t(bucket.key) & mask;
+				while (buckets[i].head != NONE)
+					i = (i + 1) & mask;
+				buckets[i] = bucket;
+			}
+		}
+
+		size_t mask = buckets.size() - 1;
+		size_t i = size_t(key) & mask;
+		while (buckets[i].head != NONE && buckets[i].key != key)
+			i = (i + 1) & mask;
+
+		if (buckets[i].head == NONE) {
+			buckets[i].key = key;
+			bucketsUsed++;
+		}
+
+		return buckets[i];
+	}
+
+	std::vector<SimilarProto> SimilarityIndex::query(const ProtoFingerprint& fingerprint, size_t limit, double minScore) const {
+		std::shared_lock<std::shared_mutex> lock(mutex);
+
+		std::vector<uint32_t> candidates;
+
+		auto exact = exactIndex.find(fingerprint.exact);
+		if (exact != exactIndex.end())
+			candidates.push_back(exact->second);
+
+		for (uint32_t band = 0; band < LSH_BANDS; band++) {
+			const Bucket* bucket = findBucket(getBandKey(fingerprint, band));
+			if (!bucket)
+				continue;
+
+			for (uint32_t entry = bucket->head; entry != NONE; entry = entries[entry].next[band])
+				candidates.push_back(entry);
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+		std::vector<SimilarProto> matches;
+		for (uint32_t candidate : candidates) {
+			const Entry& entry = entries[candidate];
+
+			SimilarProto match;
+			match.exact = entry.fingerprint.exact == fingerprint.exact;
+			match.score = match.exact ? 1.0 : estimate_similarity(entry.fingerprint, fingerprint);
+			if (match.score < minScore)
+				continue;
+
+			match.script = &scripts[entry.script];
+			match.protoId = entry.protoId;
+			match.name = &entry.name;
+			matches.push_back(match);
+		}
+
+		// Exact matches first, then by score
+		size_t count = std::min(limit, matches.size());
+		std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), [](const SimilarProto& a, const SimilarProto& b) {
+			if (a.exact != b.exact)
+				return a.exact;
+			return a.score > b.score;
+		});
+		matches.resize(count);
+
+		return matches;
+	}
+
+	size_t SimilarityIndex::insert(const std::string& script, const std::vector<Proto*>& protos, const std::vector<ProtoFingerprint>& fingerprints) {
+		std::unique_lock<std::shared_mutex> lock(mutex);
+
+		auto [scriptEntry, newScript] = scriptIds.try_emplace(script, uint32_t(scripts.size()));
+		if (newScript)
+			scripts.push_back(script);
+
+		size_t added = 0;
+		for (uint32_t protoId = 0; protoId < fingerprints.size() && entries.size() < maxProtos; protoId++) {
+			const ProtoFingerprint& fingerprint = fingerprints[protoId];
+			if (fingerprint.instructions < MIN_FINGERPRINT_INSTRUCTIONS)
+				continue;
+
+			uint32_t entryId = uint32_t(entries.size());
+			if (!exactIndex.try_emplace(fingerprint.exact, entryId).second)
+				continue;
+
+			Entry& entry = entries.emplace_back();
+			entry.fingerprint = fingerprint;
+			entry.script = scriptEntry->second;
+			entry.protoId = protoId;
+			entry.name = protos[protoId]->debugname;
+
+			for (uint32_t band = 0; band < LSH_BANDS; band++) {
+				Bucket& bucket = getBucket(getBandKey(fingerprint, band));
+				entry.next[band] = NONE;
+
+				if (bucket.count < MAX_BUCKET_ENTRIES) {
+					entry.next[band] = bucket.head;
+					bucket.head = entryId;
+					bucket.count++;
+				}
+			}
+
+			added++;
+		}
+
+		return added;
+	}
+
+	size_t SimilarityIndex::getSize() const {
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return entries.size();
+	}
+
+	std::string find_similar_protos(const std::vector<Proto*>& protos, const std::string& script, SimilarityIndex& index, const DisassemblyOptions& options) {
+		std::vector<ProtoFingerprint> fingerprints = fingerprint_protos(protos);
+		bool json = options.format == OutputFormat::Json;
+
+		size_t indexed = index.getSize();
+		uint32_t compared = 0;
+
+		std::string output;
+		if (json)
+			output += "{\"protos\":[";
+
+		bool first = true;
+		for (uint32_t protoId = 0; protoId < protos.size(); protoId++) {
+			const Proto* p = protos[protoId];
+			const ProtoFingerprint& fingerprint = fingerprints[protoId];
+			if (fingerprint.instructions < MIN_FINGERPRINT_INSTRUCTIONS || !options.wantsProto(protoId, p->debugname))
+				continue;
+
+			compared++;
+
+			// Only protos with matches are listed
+			std::vector<SimilarProto> matches = index.query(fingerprint, SIMILAR_PROTO_LIMIT, MIN_SIMILARITY);
+			if (matches.empty())
+				continue;
+
+			if (json) {
+				if (!first)
+					output += ',';
+				output += "{\"id\":" + std::to_string(protoId) + ",\"name\":";
+				appendJsonString(output, p->debugname);
+				output += ",\"instructions\":" + std::to_string(fingerprint.instructions) + ",\"similar\":[";
+			}
+			else {
+				output += "proto " + std::to_string(protoId) + ' ' + p->debugname + " ; " + std::to_string(fingerprint.instructions) + " instructions\n";
+			}
+			first = false;
+
+			for (size_t i = 0; i < matches.size(); i++) {
+				const SimilarProto& match = matches[i];
+				char score[16];
+				snprintf(score, sizeof(score), "%.3f", match.score);
+
+				if (json) {
+					if (i != 0)
+						output += ',';
+					output += "{\"script\":";
+					appendJsonString(output, *match.script);
+					output += ",\"id\":" + std::to_string(match.protoId) + ",\"name\":";
+					appendJsonString(output, *match.name);
+					output += ",\"score\":" + std::string(score) + ",\"exact\":" + (match.exact ? "true" : "false") + '}';
+				}
+				else {
+					output += '\t' + std::string(score) + (match.exact ? " exact" : "") + " proto " + std::to_string(match.protoId) + ' ' + *match.name + " in " + *match.script + '\n';
+				}
+			}
+
+			if (json)
+				output += "]}";
+		}
+
+		size_t added = index.insert(script, protos, fingerprints);
+
+		if (json) {
+			output += "],\"compared\":" + std::to_string(compared) + ",\"indexed\":" + std::to_string(indexed) + ",\"added\":" + std::to_string(added) + '}';
+		}
+		else {
+			output += "; " + std::to_string(compared) + " protos compared against " + std::to_string(indexed) + " indexed, " + std::to_string(added) + " added as " + script + '\n';
+		}
+
+		return output;
+	}
+} // namespace LuauDisassembler
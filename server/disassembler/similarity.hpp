@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <deque>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "proto.hpp"
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	constexpr uint32_t MINHASH_SIZE = 32;
+
+	// MinHash values are split into bands of MINHASH_SIZE / LSH_BANDS rows; protos sharing a whole band become candidates,
+	// which finds most protos above about 60% similarity
+	constexpr uint32_t LSH_BANDS = 8;
+
+	// Protos shorter than this (getters, empty functions) look alike everywhere and are neither indexed nor compared
+	constexpr uint32_t MIN_FINGERPRINT_INSTRUCTIONS = 4;
+
+	struct ProtoFingerprint {
+		// Same as hash_protos: equal for protos that only differ in how their constants and children are numbered
+		uint64_t exact = 0;
+
+		// Over opcode trigrams, where instructions naming a global, import, key or method also carry the name, so
+		// protos that do the same thing with different registers and constants still come out close
+		uint32_t minhash[MINHASH_SIZE] = {};
+
+		uint32_t instructions = 0;
+	};
+
+	// Fingerprints of every proto, indexed by global id, in one pass over each proto's code and constants
+	std::vector<ProtoFingerprint> fingerprint_protos(const std::vector<Proto*>& protos);
+
+	// Estimated Jaccard similarity of the two protos' trigram sets, from the fraction of equal MinHash values
+	double estimate_similarity(const ProtoFingerprint& a, const ProtoFingerprint& b);
+
+	struct SimilarProto {
+		const std::string* script = nullptr; // owned by the index, which never removes anything
+		uint32_t protoId = 0;
+		const std::string* name = nullptr;
+		double score = 0;
+		bool exact = false;
+	};
+
+	// Thread-safe index of the fingerprints of protos from earlier requests, for finding the same function in other scripts
+	// Candidates come from LSH buckets of bounded size, so a query compares a few hundred fingerprints at most however
+	// large the index grows. Protos with an exact match already indexed aren't added again, and once maxProtos are
+	// indexed nothing more is added
+	class SimilarityIndex {
+	public:
+		explicit SimilarityIndex(size_t maxProtos);
+
+		// Up to limit of the most similar indexed protos, best first, leaving out those under minScore
+		std::vector<SimilarProto> query(const ProtoFingerprint& fingerprint, size_t limit, double minScore) const;
+
+		// Adds the script's protos under its name, returns how many were new
+		size_t insert(const std::string& script, const std::vector<Proto*>& protos, const std::vector<ProtoFingerprint>& fingerprints);
+
+		size_t getSize() const;
+
+	private:
+		static constexpr uint32_t NONE = UINT32_MAX;
+
+		struct Entry {
+			ProtoFingerprint fingerprint;
+			uint32_t script = 0;
+			uint32_t protoId = 0;
+			std::string name;
+			uint32_t next[LSH_BANDS]; // next entry in the same bucket of each band
+		};
+
+		// Open addressing table from band keys to the chain of entries sharing them
+		struct Bucket {
+			uint64_t key = 0;
+			uint32_t head = NONE;
+			uint32_t count = 0;
+		};
+
+		mutable std::shared_mutex mutex;
+		std::deque<Entry> entries; // never reallocated, SimilarProto points into it
+		std::deque<std::string> scripts;
+		std::unordered_map<std::string, uint32_t> scriptIds;
+		std::unordered_map<uint64_t, uint32_t> exactIndex;
+		std::vector<Bucket> buckets;
+		size_t bucketsUsed = 0;
+		size_t maxProtos;
+
+		const Bucket* findBucket(uint64_t key) const;
+		Bucket& getBucket(uint64_t key);
+	};
+
+	// Compares the wanted protos against the index, renders the matches, then adds the script's protos to the index
+	std::string find_similar_protos(const std::vector<Proto*>& protos, const std::string& script, SimilarityIndex& index, const DisassemblyOptions& options);
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "disassembler.hpp"
+#include "bytecode_reader.hpp"
+#include "stream.hpp"
+
+namespace LuauDisassembler {
+	StreamingDeserializer::StreamingDeserializer(size_t totalSize, bool keepLineInfo) :
+		totalSize(totalSize),
+		keepLineInfo(keepLineInfo)
+	{}
+
+	StreamingDeserializer::~StreamingDeserializer() {
+		free_protos(protoTable);
+	}
+
+	void StreamingDeserializer::push(const char* data, size_t size) {
+		if (size > totalSize - received)
+			throw std::runtime_error("Bytecode is larger than its declared size");
+
+		received += size;
+
+		// Once the bytecode is complete, anything left over isn't part of it
+		if (isComplete())
+			return;
+
+		// Most pushes end between sections or are parsed straight from the caller's buffer, only an incomplete section is copied
+		if (pending.empty()) {
+			size_t parsed = parse(data, size);
+			if (!isComplete())
+				pending.assign(data + parsed, size - parsed);
+			return;
+		}
+
+		pending.append(data, size);
+		if (pending.size() < retryAt && received < totalSize)
+			return;
+
+		size_t parsed = parse(pending.data(), pending.size());
+		if (isComplete())
+			pending = std::string();
+		else
+			pending.erase(0, parsed);
+	}
+
+	// Parses as many whole sections as data holds and returns the bytes they took
+	size_t StreamingDeserializer::parse(const char* data, size_t size) {
+		CheckedReader reader{ data, size, totalSize - consumed };
+		size_t parsed = 0;
+
+		try {
+			while (section != Section::Done) {
+				switch (section) {
+				case Section::Header: {
+					uint8_t version = reader.u8();
+					if (version != 2)
+						throw std::runtime_error("Invalid bytecode");
+
+					stringCount = reader.leb128();
+					reader.checkCount(stringCount, 1);
+					stringTable.reserve(stringCount);
+					section = Section::Strings;
+					break;
+				}
+				case Section::Strings: {
+					if (stringTable.size() == stringCount) {
+						section = Section::ProtoCount;
+						break;
+					}
+
+					uint32_t length = reader.leb128();
+					stringTable.emplace_back(reader.bytes(length), length);
+					break;
+				}
+				case Section::ProtoCount: {
+					protoCount = reader.leb128();
+					reader.checkCount(protoCount, 8);
+					protoTable.reserve(protoCount);
+					section = Section::Protos;
+					break;
+				}
+				case Section::Protos: {
+					if (protoTable.size() == protoCount) {
+						section = Section::MainId;
+						break;
+					}
+
+					protoTable.push_back(read_proto(reader, stringTable, uint32_t(protoTable.size()), keepLineInfo));
+					break;
+				}
+				case Section::MainId: {
+					uint32_t mainid = reader.leb128();
+					reader.check(protoCount != 0 && mainid < protoCount);
+
+					// Only the protos are needed from here on
+					stringTable = std::vector<std::string>();
+					section = Section::Done;
+					break;
+				}
+				default: {
+					break;
+				}
+				}
+
+				parsed = reader.offset;
+			}
+		} catch (const NeedMoreData& e) {
+			// The incomplete section is parsed again once it is complete, or half as big again as this attempt
+			size_t attempted = size - parsed;
+			retryAt = std::max(e.required - parsed, attempted + attempted / 2);
+		}
+
+		consumed += parsed;
+		return parsed;
+	}
+} // namespace LuauDisassembler
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "proto.hpp"
+
+namespace LuauDisassembler {
+	// Deserializes bytecode that arrives in pieces, like a large script uploaded over several messages
+	// Bytes are parsed as they are pushed, a section (the header, each string, each proto, the main proto id) at a time:
+	// a section that isn't complete yet waits for more bytes, everything before it is already in the proto table
+	// and can be rendered. Every read is checked, since nothing has scanned the bytecode beforehand
+	class StreamingDeserializer {
+	public:
+		// totalSize is the whole bytecode's size, known up front; pushing past it is an error
+		explicit StreamingDeserializer(size_t totalSize, bool keepLineInfo = true);
+		~StreamingDeserializer();
+
+		StreamingDeserializer(const StreamingDeserializer&) = delete;
+		StreamingDeserializer& operator=(const StreamingDeserializer&) = delete;
+
+		// Parses whatever the bytes so far complete, throws std::runtime_error on malformed bytecode; the bytecode ending
+		// before its last section does, once all totalSize bytes are pushed, is malformed too
+		void push(const char* data, size_t size);
+
+		bool isComplete() const { return section == Section::Done; }
+		size_t getBytesReceived() const { return received; }
+
+		// Grows as protos are parsed, children always come before their parents
+		const std::vector<Proto*>& getProtos() const { return protoTable; }
+
+	private:
+		enum class Section {
+			Header,
+			Strings,
+			ProtoCount,
+			Protos,
+			MainId,
+			Done,
+		};
+
+		size_t totalSize;
+		bool keepLineInfo;
+
+		Section section = Section::Header;
+		uint32_t stringCount = 0;
+		uint32_t protoCount = 0;
+		std::vector<std::string> stringTable;
+		std::vector<Proto*> protoTable;
+
+		size_t received = 0;
+		size_t consumed = 0; // bytes of complete sections
+
+		// Bytes of an incomplete section, kept until it can be parsed
+		std::string pending;
+		// Pending size at which to parse again; sections are retried at geometrically growing sizes, so a proto spread over
+		// many small pushes isn't parsed from the start again for every one of them
+		size_t retryAt = 0;
+
+		size_t parse(const char* data, size_t size);
+	};
+}
\ No newline at end of file
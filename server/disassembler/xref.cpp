@@ -0,0 +1,209 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "bytecode.hpp"
+#include "options.hpp"
+#include "disassembler.hpp"
+#include "xref.hpp"
+
+namespace LuauDisassembler {
+	const char* REFERENCE_KIND_NAMES[4] = { "import", "global", "method", "key" };
+
+	const char* getReferenceKindName(ReferenceKind kind) {
+		return REFERENCE_KIND_NAMES[uint8_t(kind)];
+	}
+
+	std::vector<uint32_t> ReferenceIndex::find(const char* glob) const {
+		std::vector<uint32_t> result;
+		for (uint32_t i = 0; i < symbols.size(); i++) {
+			if (glob_match(glob, symbols[i].c_str()))
+				result.push_back(i);
+		}
+		return result;
+	}
+
+	struct ReferenceIndexBuilder {
+		explicit ReferenceIndexBuilder(ReferenceIndex& index) : index(index) {}
+
+		ReferenceIndex& index;
+		std::unordered_map<std::string, uint32_t> symbolIds;
+
+		// (symbol, site) pairs in the order they were found
+		std::vector<uint32_t> siteSymbols;
+		std::vector<ReferenceSite> unsortedSites;
+
+		uint32_t getSymbol(ReferenceKind kind, const std::string& name) {
+			std::string display;
+			switch (kind) {
+			case ReferenceKind::Method: {
+				display = ":" + name;
+				break;
+			}
+			case ReferenceKind::Key: {
+				display = "." + name;
+				break;
+			}
+			default: {
+				display = name;
+				break;
+			}
+			}
+
+			// Kind is part of the key so an import and a global with the same name stay separate
+			auto [it, inserted] = symbolIds.try_emplace(char(kind) + display, uint32_t(index.symbols.size()));
+			if (inserted) {
+				index.symbols.push_back(std::move(display));
+				index.kinds.push_back(kind);
+			}
+
+			return it->second;
+		}
+	};
+
+	ReferenceIndex build_reference_index(const std::vector<Proto*>& protos) {
+		ReferenceIndex index;
+		ReferenceIndexBuilder builder(index);
+
+		// Symbol id of each (kind, constant) pair already seen in the current proto, so names are only hashed once per proto
+		std::vector<uint32_t> constantSymbols;
+
+		for (uint32_t protoId = 0; protoId < protos.size(); protoId++) {
+			const Proto* p = protos[protoId];
+			const std::vector<uint32_t>& code = p->code;
+			const std::vector<LuaValue>& k = p->k;
+
+			constantSymbols.assign(k.size() * 4, UINT32_MAX);
+
+			auto addReference = [&](ReferenceKind kind, uint32_t constantIndex, uint8_t expectedType, size_t pc) {
+				if (constantIndex >= k.size() || k[constantIndex].type != expectedType)
+					return;
+
+				uint32_t& symbol = constantSymbols[constantIndex * 4 + uint8_t(kind)];
+				if (symbol == UINT32_MAX) {
+					const LuaValue& constant = k[constantIndex];
+					symbol = builder.getSymbol(kind, expectedType == LUA_TIMPORT ? constant.import.displayString : constant.str);
+				}
+
+				builder.siteSymbols.push_back(symbol);
+				builder.unsortedSites.push_back({ protoId, uint32_t(pc) });
+			};
+
+			for (size_t pc = 0; pc < code.size(); pc += getOpLength(LUAU_INSN_OP(code[pc]))) {
+				uint32_t instruction = code[pc];
+
+				switch (LUAU_INSN_OP(instruction)) {
+				case LOP_GETIMPORT: {
+					addReference(ReferenceKind::Import, uint32_t(LUAU_INSN_D(instruction)), LUA_TIMPORT, pc);
+					break;
+				}
+				case LOP_GETGLOBAL:
+				case LOP_SETGLOBAL: {
+					if (pc + 1 < code.size())
+						addReference(ReferenceKind::Global, code[pc + 1], LUA_TSTRING, pc);
+					break;
+				}
+				case LOP_NAMECALL: {
+					if (pc + 1 < code.size())
+						addReference(ReferenceKind::Method, code[pc + 1], LUA_TSTRING, pc);
+					break;
+				}
+				case LOP_GETTABLEKS: {
+					if (pc + 1 < code.size())
+						addReference(ReferenceKind::Key, code[pc + 1], LUA_TSTRING, pc);
+					break;
+				}
+				default: {
+					break;
+				}
+				}
+			}
+		}
+
+		// Group the sites by symbol with a counting sort, which keeps them in proto/pc order
+		index.siteOffsets.assign(index.symbols.size() + 1, 0);
+		for (uint32_t symbol : builder.siteSymbols)
+			index.siteOffsets[symbol + 1]++;
+
+		for (size_t i = 1; i < index.siteOffsets.size(); i++)
+			index.siteOffsets[i] += index.siteOffsets[i - 1];
+
+		std::vector<uint32_t> cursor(index.siteOffsets.begin(), index.siteOffsets.end() - 1);
+		index.sites.resize(builder.unsortedSites.size());
+		for (size_t i = 0; i < builder.unsortedSites.size(); i++)
+			index.sites[cursor[builder.siteSymbols[i]]++] = builder.unsortedSites[i];
+
+		return index;
+	}
+
+	std::string format_references(const ReferenceIndex& index, const std::vector<Proto*>& protos, const DisassemblyOptions& options) {
+		// Without a query every symbol is listed
+		std::vector<uint32_t> matches;
+		if (options.referenceQueries.empty()) {
+			matches.resize(index.symbols.size());
+			for (uint32_t i = 0; i < matches.size(); i++)
+				matches[i] = i;
+		}
+		else {
+			std::vector<bool> seen(index.symbols.size(), false);
+			for (const std::string& query : options.referenceQueries) {
+				for (uint32_t symbol : index.find(query.c_str())) {
+					if (!seen[symbol]) {
+						seen[symbol] = true;
+						matches.push_back(symbol);
+					}
+				}
+			}
+		}
+
+		std::string output;
+		bool json = options.format == OutputFormat::Json;
+
+		if (json)
+			output += "{\"references\":[";
+
+		for (size_t m = 0; m < matches.size(); m++) {
+			uint32_t symbol = matches[m];
+			const char* kindName = getReferenceKindName(index.kinds[symbol]);
+
+			if (json) {
+				if (m != 0)
+					output += ',';
+				output += "{\"symbol\":";
+				appendJsonString(output, index.symbols[symbol]);
+				output += ",\"kind\":\"";
+				output += kindName;
+				output += "\",\"sites\":[";
+			}
+			else {
+				output += index.symbols[symbol] + " ; " + kindName + ", " +
+					std::to_string(index.siteOffsets[symbol + 1] - index.siteOffsets[symbol]) + " sites\n";
+			}
+
+			for (uint32_t i = index.siteOffsets[symbol]; i < index.siteOffsets[symbol + 1]; i++) {
+				const ReferenceSite& site = index.sites[i];
+
+				if (json) {
+					if (i != index.siteOffsets[symbol])
+						output += ',';
+					output += "{\"proto\":" + std::to_string(site.protoId) + ",\"pc\":" + std::to_string(site.pc) + '}';
+				}
+				else {
+					char siteBuffer[48];
+					snprintf(siteBuffer, sizeof(siteBuffer), "\tproto %u [%03u] ", site.protoId, site.pc);
+					output += siteBuffer + protos[site.protoId]->debugname + '\n';
+				}
+			}
+
+			if (json)
+				output += "]}";
+		}
+
+		if (json)
+			output += "]}";
+
+		return output;
+	}
+} // namespace LuauDisassembler
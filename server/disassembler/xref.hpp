@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "proto.hpp"
+#include "options.hpp"
+
+namespace LuauDisassembler {
+	enum class ReferenceKind : uint8_t {
+		Import, // GETIMPORT path, e.g. game.Players
+		Global, // GETGLOBAL/SETGLOBAL name
+		Method, // NAMECALL method name, displayed as :Name
+		Key, // GETTABLEKS key, displayed as .Name
+	};
+
+	struct ReferenceSite {
+		uint32_t protoId = 0;
+		uint32_t pc = 0;
+	};
+
+	// Inverted index from referenced names to the places that reference them
+	// Sites of symbol i are sites[siteOffsets[i]..siteOffsets[i + 1]), in proto/pc order
+	struct ReferenceIndex {
+		std::vector<std::string> symbols;
+		std::vector<ReferenceKind> kinds;
+		std::vector<uint32_t> siteOffsets;
+		std::vector<ReferenceSite> sites;
+
+		// Ids of the symbols whose display name matches the glob
+		std::vector<uint32_t> find(const char* glob) const;
+	};
+
+	const char* getReferenceKindName(ReferenceKind kind);
+
+	// Builds the index in one pass over the code of every proto
+	ReferenceIndex build_reference_index(const std::vector<Proto*>& protos);
+
+	// Renders the symbols matching the request's reference queries (all of them without a query) with their sites
+	std::string format_references(const ReferenceIndex& index, const std::vector<Proto*>& protos, const DisassemblyOptions& options);
+}
\ No newline at end of file
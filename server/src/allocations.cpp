@@ -0,0 +1,127 @@
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "stats.hpp"
+
+// The whole set of replaceable allocation functions, so no form of new or delete bypasses the count or frees with the
+// wrong function. They live in a file of their own: nothing here allocates, so a delete is never inlined next to the new
+// that made its pointer, which GCC reports as a mismatched free
+
+static thread_local uint64_t threadAllocations = 0;
+
+static void* allocate(size_t size) {
+	threadAllocations++;
+	return malloc(size ? size : 1);
+}
+
+static void* allocateAligned(size_t size, std::align_val_t alignment) {
+	threadAllocations++;
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, size_t(alignment));
+#else
+	void* ptr = nullptr;
+	size_t align = size_t(alignment) < sizeof(void*) ? sizeof(void*) : size_t(alignment);
+	return posix_memalign(&ptr, align, size ? size : 1) == 0 ? ptr : nullptr;
+#endif
+}
+
+static void deallocateAligned(void* ptr) {
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+// Counting happens in a thread_local so allocation heavy requests don't contend on a shared counter
+uint64_t get_thread_allocations() {
+	return threadAllocations;
+}
+
+void* operator new(size_t size) {
+	if (void* ptr = allocate(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	if (void* ptr = allocateAligned(size, alignment))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return allocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	deallocateAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+	deallocateAligned(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+	deallocateAligned(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+	deallocateAligned(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+	deallocateAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+	deallocateAligned(ptr);
+}
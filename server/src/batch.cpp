@@ -0,0 +1,408 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+
+#include "disassembler/bytecode.hpp"
+#include "disassembler/disassembler.hpp"
+#include "mapped_file.hpp"
+
+// Disassembles files and directories of bytecode offline on every core, writing one output file per input
+// Files are spread over per-thread queues and idle threads steal from the others; large files are split into proto ranges
+// that are rendered in parallel and joined in order when the last range finishes
+
+using Clock = std::chrono::steady_clock;
+
+// Inputs past this many code words are split into ranges of about this size
+constexpr uint64_t BATCH_DEFAULT_RANGE_INSTRUCTIONS = 65536;
+
+// Outputs are written through a buffer this large, most outputs go out in a handful of writes
+constexpr size_t BATCH_WRITE_BUFFER_SIZE = size_t(1) << 20;
+
+struct BatchOptions {
+	LuauDisassembler::DisassemblyOptions disassembly;
+	std::filesystem::path outputDirectory; // empty renders without writing, for measuring throughput
+	size_t threadCount = 0;
+	uint64_t rangeInstructions = BATCH_DEFAULT_RANGE_INSTRUCTIONS;
+};
+
+struct BatchInput {
+	std::filesystem::path path;
+	std::filesystem::path outputPath;
+	uint64_t size = 0;
+};
+
+struct BatchStats {
+	std::atomic<uint64_t> files{ 0 };
+	std::atomic<uint64_t> failures{ 0 };
+	std::atomic<uint64_t> bytesIn{ 0 };
+	std::atomic<uint64_t> bytesOut{ 0 };
+	std::atomic<uint64_t> instructions{ 0 };
+	std::atomic<uint64_t> ranges{ 0 };
+};
+
+// Thread pool where every worker owns a queue: it takes its own newest task first, and when it runs dry steals the oldest
+// task of another worker. Tasks are whole files or proto ranges, milliseconds each, so a mutex per queue costs nothing next
+// to them
+class WorkStealingPool {
+public:
+	using Task = std::function<void()>;
+
+	explicit WorkStealingPool(size_t workerCount) : queues(workerCount) {}
+
+	// Before run, tasks are dealt round robin; from inside a task they go to the running worker's own queue
+	void push(Task task) {
+		outstanding.fetch_add(1, std::memory_order_relaxed);
+
+		size_t index = currentWorker != SIZE_MAX ? currentWorker : nextQueue++ % queues.size();
+		std::lock_guard<std::mutex> lock(queues[index].mutex);
+		queues[index].tasks.push_back(std::move(task));
+	}
+
+	// Runs until every task, including the ones tasks push, has finished
+	void run() {
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < queues.size(); i++)
+			workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	uint64_t getSteals() const {
+		return steals.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<Queue> queues;
+	std::atomic<size_t> outstanding{ 0 };
+	std::atomic<uint64_t> steals{ 0 };
+	size_t nextQueue = 0;
+
+	static thread_local size_t currentWorker;
+
+	bool popOwn(size_t index, Task& task) {
+		Queue& queue = queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			return false;
+
+		task = std::move(queue.tasks.back());
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool steal(size_t thief, Task& task) {
+		for (size_t i = 1; i < queues.size(); i++) {
+			Queue& queue = queues[(thief + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+				continue;
+
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	void workerLoop(size_t index) {
+		currentWorker = index;
+
+		int idleRounds = 0;
+		while (outstanding.load(std::memory_order_acquire) > 0) {
+			Task task;
+			if (popOwn(index, task) || steal(index, task)) {
+				task();
+				outstanding.fetch_sub(1, std::memory_order_acq_rel);
+				idleRounds = 0;
+				continue;
+			}
+
+			// Nothing to take, but running tasks may still push more
+			if (++idleRounds < 64)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+		currentWorker = SIZE_MAX;
+	}
+};
+
+thread_local size_t WorkStealingPool::currentWorker = SIZE_MAX;
+
+static void collectInputs(const std::filesystem::path& path, const std::filesystem::path& outputDirectory, std::vector<BatchInput>& inputs) {
+	std::error_code ec;
+	if (std::filesystem::is_directory(path, ec)) {
+		// Outputs mirror the directory tree below the directory given
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
+			if (entry.is_regular_file())
+				inputs.push_back({ entry.path(), outputDirectory / std::filesystem::relative(entry.path(), path), entry.file_size() });
+		}
+		return;
+	}
+
+	inputs.push_back({ path, outputDirectory / path.filename(), std::filesystem::file_size(path, ec) });
+}
+
+static uint64_t countInstructions(const std::vector<LuauDisassembler::Proto*>& protoTable) {
+	uint64_t count = 0;
+	for (const LuauDisassembler::Proto* p : protoTable) {
+		for (size_t pc = 0; pc < p->code.size(); pc += getOpLength(LUAU_INSN_OP(p->code[pc])))
+			count++;
+	}
+	return count;
+}
+
+// A file split into proto ranges, alive until its last range is rendered and the output written
+struct SplitFile {
+	const BatchInput* input = nullptr;
+	std::vector<LuauDisassembler::Proto*> protoTable;
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
+	std::vector<std::string> outputs;
+	std::atomic<size_t> remaining{ 0 };
+
+	~SplitFile() {
+		LuauDisassembler::free_protos(protoTable);
+	}
+};
+
+class BatchRunner {
+public:
+	BatchRunner(const BatchOptions& options, const std::vector<BatchInput>& inputs, size_t threadCount) : options(options), inputs(inputs), pool(threadCount) {}
+
+	void run() {
+		// Largest first, so the long files start early instead of finishing last on one core
+		std::vector<size_t> order(inputs.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return inputs[a].size > inputs[b].size; });
+
+		for (size_t i : order)
+			pool.push([this, i] { processFile(inputs[i]); });
+
+		pool.run();
+	}
+
+	const BatchStats& getStats() const { return stats; }
+	uint64_t getSteals() const { return pool.getSteals(); }
+
+private:
+	const BatchOptions& options;
+	const std::vector<BatchInput>& inputs;
+	WorkStealingPool pool;
+	BatchStats stats;
+	std::mutex errorMutex;
+
+	void fail(const BatchInput& input, const std::string& error) {
+		stats.failures.fetch_add(1, std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(errorMutex);
+		std::cerr << input.path.string() << ": " << error << '\n';
+	}
+
+	void processFile(const BatchInput& input) {
+		std::vector<LuauDisassembler::Proto*> protoTable;
+
+		{
+			MappedFile file;
+			if (!file.open(input.path.string())) {
+				fail(input, "can't open file");
+				return;
+			}
+
+			// Deserialization stays inside the mapping; the protos copy what they need, so the mapping goes as soon as they
+			// are built
+			try {
+				protoTable = LuauDisassembler::deserialize_bytecode(file.getData(), file.getSize(), options.disassembly.displayLineInfo);
+			} catch (const std::exception& e) {
+				fail(input, e.what());
+				return;
+			}
+
+			stats.bytesIn.fetch_add(file.getSize(), std::memory_order_relaxed);
+		}
+
+		stats.instructions.fetch_add(countInstructions(protoTable), std::memory_order_relaxed);
+
+		std::vector<std::pair<uint32_t, uint32_t>> ranges;
+		uint64_t rangeSize = 0;
+		uint32_t rangeStart = 0;
+		for (uint32_t protoId = 0; protoId < protoTable.size(); protoId++) {
+			rangeSize += protoTable[protoId]->code.size();
+			if (rangeSize >= options.rangeInstructions || protoId + 1 == protoTable.size()) {
+				ranges.emplace_back(rangeStart, protoId + 1);
+				rangeStart = protoId + 1;
+				rangeSize = 0;
+			}
+		}
+
+		if (ranges.size() <= 1) {
+			std::vector<std::string> parts;
+			parts.push_back(LuauDisassembler::render_protos(protoTable, input.size * 6, options.disassembly));
+			LuauDisassembler::free_protos(protoTable);
+
+			writeOutput(input, parts);
+			return;
+		}
+
+		std::shared_ptr<SplitFile> split = std::make_shared<SplitFile>();
+		split->input = &input;
+		split->protoTable = std::move(protoTable);
+		split->ranges = std::move(ranges);
+		split->outputs.resize(split->ranges.size());
+		split->remaining = split->ranges.size();
+		stats.ranges.fetch_add(split->ranges.size(), std::memory_order_relaxed);
+
+		// Pushed in reverse, this worker takes the first range next while thieves take the last ones
+		for (size_t i = split->ranges.size(); i-- > 0;)
+			pool.push([this, split, i] { renderRange(split, i); });
+	}
+
+	void renderRange(const std::shared_ptr<SplitFile>& split, size_t index) {
+		auto [first, last] = split->ranges[index];
+		LuauDisassembler::render_proto_range(split->outputs[index], split->protoTable, first, last, options.disassembly);
+
+		if (split->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+
+		// Last range done, the file is complete
+		std::vector<std::string> parts;
+		bool json = options.disassembly.format == LuauDisassembler::OutputFormat::Json;
+		if (json) {
+			parts.push_back("{\"protos\":[");
+			for (std::string& output : split->outputs) {
+				if (output.empty())
+					continue;
+				if (parts.size() > 1)
+					parts.push_back(",");
+				parts.push_back(std::move(output));
+			}
+			parts.push_back("],\"truncated\":false}");
+		} else {
+			parts = std::move(split->outputs);
+		}
+
+		writeOutput(*split->input, parts);
+	}
+
+	void writeOutput(const BatchInput& input, const std::vector<std::string>& parts) {
+		uint64_t size = 0;
+		for (const std::string& part : parts)
+			size += part.size();
+
+		stats.bytesOut.fetch_add(size, std::memory_order_relaxed);
+		stats.files.fetch_add(1, std::memory_order_relaxed);
+
+		if (options.outputDirectory.empty())
+			return;
+
+		std::filesystem::path path = input.outputPath;
+		path += options.disassembly.format == LuauDisassembler::OutputFormat::Json ? ".json" : ".txt";
+
+		std::error_code ec;
+		std::filesystem::create_directories(path.parent_path(), ec);
+
+		FILE* file = fopen(path.string().c_str(), "wb");
+		if (!file) {
+			fail(input, "can't write " + path.string());
+			return;
+		}
+
+		// Parts larger than the buffer go straight to the file, the small ones around them are batched
+		static thread_local std::vector<char> buffer(BATCH_WRITE_BUFFER_SIZE);
+		setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+		bool written = true;
+		for (const std::string& part : parts)
+			written &= fwrite(part.data(), 1, part.size(), file) == part.size();
+
+		written &= fclose(file) == 0;
+		if (!written)
+			fail(input, "failed writing " + path.string());
+	}
+};
+
+int main(int argc, char* argv[]) {
+	BatchOptions options;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--out" && i + 1 < argc) {
+			options.outputDirectory = argv[++i];
+		} else if (arg == "--threads" && i + 1 < argc) {
+			options.threadCount = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--range-instructions" && i + 1 < argc) {
+			options.rangeInstructions = std::max<uint64_t>(1, strtoull(argv[++i], nullptr, 10));
+		} else if (arg == "--line-info") {
+			options.disassembly.displayLineInfo = true;
+		} else if (arg == "--json") {
+			options.disassembly.format = LuauDisassembler::OutputFormat::Json;
+		} else if (arg == "--blocks") {
+			options.disassembly.showBlocks = true;
+		} else if (arg == "--calls") {
+			options.disassembly.annotateCalls = true;
+		} else {
+			paths.push_back(arg);
+		}
+	}
+
+	if (paths.empty()) {
+		std::cerr << "usage: disasm_batch [--out directory] [--threads N] [--json] [--line-info] [--blocks] [--calls] [--range-instructions N] <bytecode file or directory>...\n";
+		return 1;
+	}
+
+	std::vector<BatchInput> inputs;
+	for (const std::string& path : paths)
+		collectInputs(path, options.outputDirectory, inputs);
+
+	size_t threadCount = options.threadCount ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+
+	Clock::time_point start = Clock::now();
+	BatchRunner runner(options, inputs, threadCount);
+	runner.run();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	const BatchStats& stats = runner.getStats();
+	printf(
+		"batch: %llu files (%llu failed), %zu threads, %.3f s%s\n",
+		(unsigned long long)stats.files.load(),
+		(unsigned long long)stats.failures.load(),
+		threadCount,
+		seconds,
+		options.outputDirectory.empty() ? ", output discarded" : ""
+	);
+	printf(
+		"throughput: %.2f MB/s in, %.2f MB/s out, %.2f Minsn/s, %.1f files/s\n",
+		double(stats.bytesIn.load()) / seconds / (1 << 20),
+		double(stats.bytesOut.load()) / seconds / (1 << 20),
+		double(stats.instructions.load()) / seconds / 1e6,
+		double(stats.files.load()) / seconds
+	);
+	printf(
+		"scheduling: %llu proto ranges from split files, %llu tasks stolen\n",
+		(unsigned long long)stats.ranges.load(),
+		(unsigned long long)runner.getSteals()
+	);
+
+	return stats.failures.load() ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "capture.hpp"
+
+static void writeLEB128(std::string& out, uint64_t value) {
+	do {
+		uint8_t byte = value & 127;
+		value >>= 7;
+		if (value)
+			byte |= 128;
+		out += char(byte);
+	} while (value);
+}
+
+static uint64_t readLEB128(const std::string& data, size_t& offset) {
+	uint64_t result = 0;
+	uint32_t shift = 0;
+
+	uint8_t byte = 0;
+
+	do {
+		if (offset >= data.size() || shift > 63)
+			throw std::runtime_error("Truncated capture file");
+
+		byte = uint8_t(data[offset++]);
+		result |= uint64_t(byte & 127) << shift;
+		shift += 7;
+	} while (byte & 128);
+
+	return result;
+}
+
+CaptureWriter::~CaptureWriter() {
+	if (!file)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+
+	fclose(file);
+}
+
+bool CaptureWriter::open(const std::string& path) {
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	uint64_t startTime = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+	std::string header(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	header += char(CAPTURE_VERSION);
+	header.append(reinterpret_cast<const char*>(&startTime), sizeof(startTime));
+	fwrite(header.data(), 1, header.size(), file);
+
+	lastRecord = std::chrono::steady_clock::now();
+	writer = std::thread(&CaptureWriter::writerLoop, this);
+	return true;
+}
+
+bool CaptureWriter::isOpen() const {
+	return file != nullptr;
+}
+
+void CaptureWriter::record(uint8_t opcode, uint32_t connectionId, const std::string& payload) {
+	if (!file)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (pending.size() + payload.size() > CAPTURE_MAX_PENDING_BYTES) {
+			droppedFrames.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// The delta is taken under the lock so records stay in timestamp order
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		writeLEB128(pending, uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now - lastRecord).count()));
+		lastRecord = now;
+
+		pending += char(opcode);
+		writeLEB128(pending, connectionId);
+		writeLEB128(pending, payload.size());
+		pending += payload;
+	}
+	wake.notify_one();
+}
+
+uint64_t CaptureWriter::getDroppedFrames() const {
+	return droppedFrames.load(std::memory_order_relaxed);
+}
+
+void CaptureWriter::writerLoop() {
+	std::string writing;
+
+	for (;;) {
+		bool done;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || !pending.empty(); });
+
+			// Swapping keeps both buffers' capacity, so steady state capture doesn't allocate
+			writing.swap(pending);
+			done = stopping;
+		}
+
+		if (!writing.empty()) {
+			fwrite(writing.data(), 1, writing.size(), file);
+			fflush(file);
+			writing.clear();
+		}
+
+		if (done)
+			break;
+	}
+}
+
+std::vector<CapturedFrame> read_capture(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("Can't open capture file " + path);
+
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	size_t headerSize = sizeof(CAPTURE_MAGIC) + 1 + sizeof(uint64_t);
+	if (data.size() < headerSize || memcmp(data.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0)
+		throw std::runtime_error("Not a capture file");
+	if (uint8_t(data[sizeof(CAPTURE_MAGIC)]) != CAPTURE_VERSION)
+		throw std::runtime_error("Unsupported capture version");
+
+	std::vector<CapturedFrame> frames;
+	uint64_t timestamp = 0;
+
+	size_t offset = headerSize;
+	while (offset < data.size()) {
+		CapturedFrame frame;
+		timestamp += readLEB128(data, offset);
+		frame.timestamp = timestamp;
+
+		if (offset >= data.size())
+			throw std::runtime_error("Truncated capture file");
+		frame.opcode = uint8_t(data[offset++]);
+
+		frame.connectionId = uint32_t(readLEB128(data, offset));
+
+		uint64_t size = readLEB128(data, offset);
+		if (size > data.size() - offset)
+			throw std::runtime_error("Truncated capture file");
+		frame.payload.assign(data, offset, size_t(size));
+		offset += size_t(size);
+
+		frames.push_back(std::move(frame));
+	}
+
+	return frames;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+// Capture files start with CAPTURE_MAGIC, a version byte and the capture's start time (u64 microseconds since the Unix epoch),
+// followed by one record per frame: LEB128 microseconds since the previous record, opcode byte, LEB128 connection id,
+// LEB128 payload size and the payload
+constexpr char CAPTURE_MAGIC[4] = { 'L', 'D', 'C', 'P' };
+constexpr uint8_t CAPTURE_VERSION = 1;
+
+// Frames queued but not yet written are capped, past this new frames are dropped rather than stalling requests
+constexpr size_t CAPTURE_MAX_PENDING_BYTES = size_t(64) << 20;
+
+struct CapturedFrame {
+	uint64_t timestamp = 0; // microseconds since the capture started
+	uint8_t opcode = 0; // websocket frame opcode
+	uint32_t connectionId = 0;
+	std::string payload;
+};
+
+// Appends incoming frames to a capture file from a background thread, the request path only copies the frame into a buffer
+class CaptureWriter {
+public:
+	CaptureWriter() = default;
+	~CaptureWriter();
+
+	CaptureWriter(const CaptureWriter&) = delete;
+	CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+	bool open(const std::string& path);
+	bool isOpen() const;
+
+	void record(uint8_t opcode, uint32_t connectionId, const std::string& payload);
+
+	uint64_t getDroppedFrames() const;
+
+private:
+	FILE* file = nullptr;
+	std::thread writer;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::string pending;
+	bool stopping = false;
+	std::chrono::steady_clock::time_point lastRecord;
+
+	std::atomic<uint64_t> droppedFrames{ 0 };
+
+	void writerLoop();
+};
+
+// Reads a whole capture file, throws std::runtime_error if it is malformed
+std::vector<CapturedFrame> read_capture(const std::string& path);
\ No newline at end of file
@@ -1,5 +1,41 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
-constexpr uint16_t DISASSEMBLER_DEFAULT_SERVER_PORT = 5395;
\ No newline at end of file
+constexpr uint16_t DISASSEMBLER_DEFAULT_SERVER_PORT = 5395;
+
+// Memory budget for rendered proto bodies shared between requests (0 disables the cache)
+constexpr size_t DISASSEMBLER_DEFAULT_PROTO_CACHE_SIZE = size_t(256) << 20;
+
+// Memory budget for deserialized scripts kept for the next page of paged requests (0 disables the cache)
+constexpr size_t DISASSEMBLER_DEFAULT_SCRIPT_CACHE_SIZE = size_t(128) << 20;
+
+// Protos fingerprinted by similar requests are kept for later ones, at about 550 bytes each; once this many are indexed
+// nothing more is added (0 disables similar requests)
+constexpr size_t DISASSEMBLER_DEFAULT_SIMILARITY_MAX_PROTOS = 500000;
+
+// Frames larger than this are refused by websocketpp, which closes the connection with "message too big"
+constexpr size_t DISASSEMBLER_DEFAULT_MAX_MESSAGE_SIZE = size_t(32) << 20;
+
+// Requests waiting for a worker, past this new requests are answered with an overload error
+constexpr size_t DISASSEMBLER_DEFAULT_QUEUE_CAPACITY = 256;
+
+// Limits on requests admitted but not yet answered, memory is estimated from the bytecode before anything is allocated
+constexpr uint32_t DISASSEMBLER_DEFAULT_MAX_CONNECTION_REQUESTS = 16;
+constexpr size_t DISASSEMBLER_DEFAULT_MAX_CONNECTION_MEMORY = size_t(512) << 20;
+constexpr size_t DISASSEMBLER_DEFAULT_MAX_TOTAL_MEMORY = size_t(2) << 30;
+
+// Scheduling: requests run shortest estimated work first, a request's head start over longer ones is capped by the
+// priority delay, so a long request waits at most that long behind requests that arrive after it (0 runs them in arrival order)
+// Work estimates are in code words, converted to time at about what rendering costs per code word
+constexpr uint32_t DISASSEMBLER_DEFAULT_MAX_PRIORITY_DELAY_MS = 250;
+constexpr uint64_t DISASSEMBLER_NANOSECONDS_PER_INSTRUCTION = 1000;
+
+// Disassembly is rendered in slices of this many code words, long requests go back in the queue between slices so short
+// ones can run in between (0 runs every request whole)
+constexpr uint64_t DISASSEMBLER_DEFAULT_SLICE_INSTRUCTIONS = 8192;
+
+// A chunked upload holds its admitted memory until it is answered; one that goes this long without a piece is answered
+// with an error and its connection closed (0 waits forever)
+constexpr uint32_t DISASSEMBLER_DEFAULT_UPLOAD_IDLE_TIMEOUT_MS = 10000;
\ No newline at end of file
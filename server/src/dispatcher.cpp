@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "dispatcher.hpp"
+
+Dispatcher::Dispatcher(size_t workerCount, size_t queueCapacity) : queueCapacity(queueCapacity) {
+	queue.reserve(queueCapacity);
+
+	for (size_t i = 0; i < workerCount; i++)
+		workers.emplace_back(&Dispatcher::workerLoop, this);
+}
+
+Dispatcher::~Dispatcher() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+bool Dispatcher::submit(Task task, Clock::time_point deadline) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping || queue.size() >= queueCapacity)
+			return false;
+
+		push(std::move(task), deadline);
+	}
+	wake.notify_one();
+
+	return true;
+}
+
+void Dispatcher::requeue(Task task, Clock::time_point deadline) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping)
+			return;
+
+		push(std::move(task), deadline);
+	}
+	wake.notify_one();
+}
+
+size_t Dispatcher::getQueueDepth() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size();
+}
+
+// Heap order for std::push_heap, which keeps the largest element on top, so the comparison is reversed
+bool Dispatcher::runsAfter(const Entry& a, const Entry& b) {
+	if (a.deadline != b.deadline)
+		return a.deadline > b.deadline;
+	return a.sequence > b.sequence;
+}
+
+void Dispatcher::push(Task task, Clock::time_point deadline) {
+	queue.push_back({ deadline, nextSequence++, std::move(task) });
+	std::push_heap(queue.begin(), queue.end(), runsAfter);
+}
+
+void Dispatcher::workerLoop() {
+	for (;;) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || !queue.empty(); });
+
+			// Queued tasks are dropped on shutdown, their connections are going away with the server
+			if (stopping)
+				return;
+
+			std::pop_heap(queue.begin(), queue.end(), runsAfter);
+			task = std::move(queue.back().task);
+			queue.pop_back();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// Fixed pool of worker threads fed from a bounded queue, so disassembly runs off the websocket io thread
+// When the queue is full submit refuses the task instead of letting work pile up without bound
+// Tasks run earliest deadline first. A deadline is a virtual one picked by the caller, its enqueue time plus the work it
+// expects, so short tasks overtake long ones but a long task is only ever overtaken by tasks queued up to its expected
+// work later, it can't starve
+class Dispatcher {
+public:
+	using Task = std::function<void()>;
+	using Clock = std::chrono::steady_clock;
+
+	Dispatcher(size_t workerCount, size_t queueCapacity);
+	~Dispatcher();
+
+	Dispatcher(const Dispatcher&) = delete;
+	Dispatcher& operator=(const Dispatcher&) = delete;
+
+	// Returns false if the queue is full
+	bool submit(Task task, Clock::time_point deadline);
+
+	// Queues the next slice of a task that has already been admitted, past the capacity if need be so started work is
+	// never dropped
+	void requeue(Task task, Clock::time_point deadline);
+
+	size_t getQueueDepth();
+	size_t getWorkerCount() const { return workers.size(); }
+
+private:
+	struct Entry {
+		Clock::time_point deadline;
+		uint64_t sequence = 0; // ties run in submission order
+		Task task;
+	};
+
+	size_t queueCapacity;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Entry> queue; // binary heap, earliest deadline on top
+	uint64_t nextSequence = 0;
+	bool stopping = false;
+
+	std::vector<std::thread> workers;
+
+	static bool runsAfter(const Entry& a, const Entry& b);
+	void push(Task task, Clock::time_point deadline);
+	void workerLoop();
+};
\ No newline at end of file
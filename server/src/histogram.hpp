@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <vector>
+#include <algorithm>
+
+// Log-linear latency histogram in the style of HdrHistogram
+// Values below 2^SUB_BUCKET_BITS are counted exactly, larger values share a bucket with others of the same leading bits, so every
+// recorded value is within 1 / 2^(SUB_BUCKET_BITS - 1) (about 1.6%) of its bucket's reported value, at any magnitude
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKET_BITS = 7;
+	static constexpr size_t SUB_BUCKET_COUNT = size_t(1) << SUB_BUCKET_BITS;
+	static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 2) * (SUB_BUCKET_COUNT / 2);
+
+	LatencyHistogram() : counts(BUCKET_COUNT, 0) {}
+
+	void record(uint64_t value, uint64_t times = 1) {
+		counts[getBucketIndex(value)] += times;
+		count += times;
+		sum += value * times;
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+
+	void merge(const LatencyHistogram& other) {
+		for (size_t i = 0; i < counts.size(); i++)
+			counts[i] += other.counts[i];
+		count += other.count;
+		sum += other.sum;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+	}
+
+	void reset() {
+		std::fill(counts.begin(), counts.end(), 0);
+		count = 0;
+		sum = 0;
+		min = UINT64_MAX;
+		max = 0;
+	}
+
+	// Smallest recorded value (to bucket precision) that at least percentile% of the values are at or below
+	uint64_t getPercentile(double percentile) const {
+		if (count == 0)
+			return 0;
+
+		uint64_t rank = std::max<uint64_t>(1, uint64_t(percentile / 100 * double(count) + 0.5));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < counts.size(); i++) {
+			seen += counts[i];
+			if (seen >= rank)
+				return std::clamp(getBucketValue(i), min, max);
+		}
+		return max;
+	}
+
+	uint64_t getCount() const {
+		return count;
+	}
+
+	uint64_t getMin() const {
+		return count ? min : 0;
+	}
+
+	uint64_t getMax() const {
+		return max;
+	}
+
+	double getMean() const {
+		return count ? double(sum) / double(count) : 0;
+	}
+
+	// Bucket 0 holds values that fit in SUB_BUCKET_BITS, bucket n holds values whose top bit is SUB_BUCKET_BITS + n - 1
+	static size_t getBucketIndex(uint64_t value) {
+		if (value < SUB_BUCKET_COUNT)
+			return size_t(value);
+
+		int magnitude = int(std::bit_width(value)) - SUB_BUCKET_BITS;
+		size_t subBucket = size_t(value >> magnitude) - SUB_BUCKET_COUNT / 2;
+		return size_t(magnitude) * (SUB_BUCKET_COUNT / 2) + SUB_BUCKET_COUNT / 2 + subBucket;
+	}
+
+	static uint64_t getBucketValue(size_t index) {
+		if (index < SUB_BUCKET_COUNT)
+			return index;
+
+		size_t magnitude = (index - SUB_BUCKET_COUNT / 2) / (SUB_BUCKET_COUNT / 2);
+		uint64_t subBucket = (index - SUB_BUCKET_COUNT / 2) % (SUB_BUCKET_COUNT / 2) + SUB_BUCKET_COUNT / 2;
+		// Report the top of the bucket so percentiles never understate latency
+		return ((subBucket + 1) << magnitude) - 1;
+	}
+
+private:
+	std::vector<uint64_t> counts;
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t min = UINT64_MAX;
+	uint64_t max = 0;
+};
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include <ctime>
+#include <chrono>
+#include <cstdarg>
+#include <cstring>
+#include <algorithm>
+
+#include "logger.hpp"
+
+static const char* LOG_LEVEL_NAMES[] = { "error", "warn", "info", "debug" };
+
+bool parse_log_level(const std::string& name, LogLevel& level) {
+	for (uint8_t i = 0; i < 4; i++) {
+		if (name == LOG_LEVEL_NAMES[i]) {
+			level = LogLevel(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* get_log_level_name(LogLevel level) {
+	return LOG_LEVEL_NAMES[uint8_t(level)];
+}
+
+std::string quote_log_value(const std::string& value) {
+	std::string result = "\"";
+	for (char c : value) {
+		switch (c) {
+		case '"': {
+			result += "\\\"";
+			break;
+		}
+		case '\\': {
+			result += "\\\\";
+			break;
+		}
+		case '\n': {
+			result += "\\n";
+			break;
+		}
+		case '\r': {
+			result += "\\r";
+			break;
+		}
+		case '\t': {
+			result += "\\t";
+			break;
+		}
+		default: {
+			if (uint8_t(c) < 0x20) {
+				char escaped[5];
+				snprintf(escaped, sizeof(escaped), "\\x%02x", unsigned(uint8_t(c)));
+				result += escaped;
+			} else {
+				result += c;
+			}
+			break;
+		}
+		}
+	}
+	result += '"';
+	return result;
+}
+
+// Timestamps are formatted by the flusher rather than the caller, to keep the request path short
+static void appendLinePrefix(std::string& buffer, uint64_t timestamp, LogLevel level) {
+	time_t seconds = time_t(timestamp / 1000000);
+	tm utc;
+#ifdef _WIN32
+	gmtime_s(&utc, &seconds);
+#else
+	gmtime_r(&seconds, &utc);
+#endif
+
+	char prefix[64];
+	size_t length = strftime(prefix, sizeof(prefix), "time=%Y-%m-%dT%H:%M:%S", &utc);
+	length += snprintf(prefix + length, sizeof(prefix) - length, ".%06uZ level=%s ", unsigned(timestamp % 1000000), get_log_level_name(level));
+
+	buffer.append(prefix, length);
+}
+
+static uint64_t getTimestamp() {
+	return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Logger::Logger(FILE* out, LogLevel level) : out(out), level(level), slots(new Slot[RING_SIZE]) {
+	for (size_t i = 0; i < RING_SIZE; i++)
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+
+	flusher = std::thread(&Logger::flushLoop, this);
+}
+
+Logger::~Logger() {
+	stopping.store(true, std::memory_order_release);
+	flusher.join();
+}
+
+void Logger::log(LogLevel lineLevel, const char* format, ...) {
+	if (!isEnabled(lineLevel))
+		return;
+
+	// Bounded multi-producer queue in the style of Vyukov's: a slot is free for position p once its sequence is p
+	uint64_t position = enqueuePosition.load(std::memory_order_relaxed);
+	Slot* slot;
+	for (;;) {
+		slot = &slots[position & (RING_SIZE - 1)];
+		int64_t difference = int64_t(slot->sequence.load(std::memory_order_acquire)) - int64_t(position);
+
+		if (difference == 0) {
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		} else if (difference < 0) {
+			droppedLines.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->timestamp = getTimestamp();
+	slot->level = lineLevel;
+
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(slot->text, LINE_CAPACITY, format, args);
+	va_end(args);
+	slot->length = uint16_t(length < 0 ? 0 : std::min<size_t>(size_t(length), LINE_CAPACITY - 1));
+
+	slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+// Moves every finished line into the buffer, returns false if there was nothing to move
+bool Logger::drain(std::string& buffer) {
+	bool any = false;
+
+	for (;;) {
+		Slot& slot = slots[dequeuePosition & (RING_SIZE - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+			break;
+
+		appendLinePrefix(buffer, slot.timestamp, slot.level);
+		buffer.append(slot.text, slot.length);
+		buffer += '\n';
+
+		slot.sequence.store(dequeuePosition + RING_SIZE, std::memory_order_release);
+		dequeuePosition++;
+		any = true;
+	}
+
+	return any;
+}
+
+void Logger::flushLoop() {
+	std::string buffer;
+	uint64_t reportedDrops = 0;
+
+	for (;;) {
+		bool stop = stopping.load(std::memory_order_acquire);
+
+		if (drain(buffer)) {
+			uint64_t drops = droppedLines.load(std::memory_order_relaxed);
+			if (drops != reportedDrops) {
+				appendLinePrefix(buffer, getTimestamp(), LogLevel::Warn);
+				buffer += "event=log_dropped lines=" + std::to_string(drops - reportedDrops) + '\n';
+				reportedDrops = drops;
+			}
+
+			fwrite(buffer.data(), 1, buffer.size(), out);
+			fflush(out);
+			buffer.clear();
+		} else if (stop) {
+			break;
+		} else {
+			// Polling keeps producers free of any lock or notification, lines wait at most this long
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+enum class LogLevel : uint8_t {
+	Error = 0,
+	Warn = 1,
+	Info = 2,
+	Debug = 3,
+};
+
+bool parse_log_level(const std::string& name, LogLevel& level);
+const char* get_log_level_name(LogLevel level);
+
+// A logfmt value in double quotes, with quotes, backslashes and control characters escaped so it can't break the line
+std::string quote_log_value(const std::string& value);
+
+// printf format checking, where the compiler has it
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_FORMAT_CHECK(formatIndex, firstArgument) __attribute__((format(printf, formatIndex, firstArgument)))
+#else
+#define LOG_FORMAT_CHECK(formatIndex, firstArgument)
+#endif
+
+// Asynchronous line logger: callers format into a slot of a lock-free ring buffer and return, a background thread writes
+// the lines out in batches. When the ring is full lines are dropped (and counted) rather than blocking the caller
+// Lines are logfmt, "time=... level=... " followed by the caller's key=value pairs
+class Logger {
+public:
+	static constexpr size_t RING_SIZE = 4096; // must be a power of two
+	static constexpr size_t LINE_CAPACITY = 496;
+
+	explicit Logger(FILE* out = stdout, LogLevel level = LogLevel::Info);
+	~Logger();
+
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+
+	void setLevel(LogLevel level) { this->level.store(level, std::memory_order_relaxed); }
+	LogLevel getLevel() const { return level.load(std::memory_order_relaxed); }
+
+	bool isEnabled(LogLevel lineLevel) const { return lineLevel <= getLevel(); }
+
+	// Lines longer than LINE_CAPACITY are cut short
+	void log(LogLevel lineLevel, const char* format, ...) LOG_FORMAT_CHECK(3, 4);
+
+	uint64_t getDroppedLines() const { return droppedLines.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 }; // position + 1 once written, position + RING_SIZE once consumed
+		uint64_t timestamp = 0; // microseconds since the Unix epoch
+		LogLevel level = LogLevel::Info;
+		uint16_t length = 0;
+		char text[LINE_CAPACITY];
+	};
+
+	FILE* out;
+	std::atomic<LogLevel> level;
+
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<uint64_t> enqueuePosition{ 0 };
+	uint64_t dequeuePosition = 0; // only touched by the flusher
+
+	std::atomic<uint64_t> droppedLines{ 0 };
+	std::atomic<bool> stopping{ false };
+	std::thread flusher;
+
+	void flushLoop();
+	bool drain(std::string& buffer);
+};
\ No newline at end of file
@@ -1,62 +1,587 @@
+#include <map>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
+#include <system_error>
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 
 #include "disassembler/disassembler.hpp"
+#include "disassembler/request.hpp"
 #include "config.hpp"
+#include "capture.hpp"
+#include "stats.hpp"
+#include "logger.hpp"
+#include "service.hpp"
+#include "raw_transport.hpp"
+#include "query_options.hpp"
 
 #include "websocketpp/server.hpp"
 #include "websocketpp/config/asio_no_tls.hpp"
 
 using server = websocketpp::server<websocketpp::config::asio>;
+using Clock = std::chrono::steady_clock;
 
-int main(int argc, char* argv[]) {
+static uint64_t getNanoseconds(Clock::time_point from, Clock::time_point to) {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+// One websocket server with its own io thread and acceptor. Several listeners share the port through SO_REUSEPORT, and the
+// kernel spreads new connections over them, so accepting and frame handling aren't bound to one thread
+struct Listener {
+	server s;
+
+	// Admission state of every open connection, only touched on this listener's io thread
+	std::map<websocketpp::connection_hdl, std::shared_ptr<ServiceConnection>, std::owner_less<websocketpp::connection_hdl>> connections;
+
+	// Raw requests on the same io thread
+	std::unique_ptr<RawTransport> rawTransport;
+};
+
+struct ListenerOptions {
 	uint16_t port = DISASSEMBLER_DEFAULT_SERVER_PORT;
+	size_t maxMessageSize = DISASSEMBLER_DEFAULT_MAX_MESSAGE_SIZE;
+	LogLevel logLevel = LogLevel::Info;
+	bool reusePort = false;
+};
 
-	if (argc > 1) { // Check for arguments
-		std::string flag = std::string(argv[1]);
-		if ((flag == "-p" || flag == "--port") && argc == 3) {
-			port = std::stoi(std::string(argv[2]), nullptr, 10);
-			if (!port) return 1;
-		}
+#ifdef SO_REUSEPORT
+static std::error_code setReusePort(int socket) {
+	int enable = 1;
+	if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0)
+		return std::error_code(errno, std::system_category());
+	return std::error_code();
+}
+#endif
+
+static void startListener(Listener& listener, const ListenerOptions& options, RequestService& service, ServerStats& serverStats, Logger& logger, CaptureWriter& capture) {
+	server& s = listener.s;
+	auto& connections = listener.connections;
+
+	// websocketpp's own access log writes every frame header synchronously, so it only comes back at the debug level
+	s.clear_access_channels(websocketpp::log::alevel::all);
+	if (options.logLevel == LogLevel::Debug) {
+		s.set_access_channels(websocketpp::log::alevel::all);
+		s.clear_access_channels(websocketpp::log::alevel::frame_payload);
 	}
 
-	std::cout << "Starting server on port " << port << '\n';
+	// Oversized frames are refused while they are read, the connection is closed with "message too big"
+	s.set_max_message_size(options.maxMessageSize);
+	s.set_max_http_body_size(options.maxMessageSize);
 
-	server s;
+	s.set_open_handler([&](websocketpp::connection_hdl hdl) {
+		std::shared_ptr<ServiceConnection> connection = service.openConnection();
+		connections[hdl] = connection;
+
+		if (logger.isEnabled(LogLevel::Info))
+			logger.log(LogLevel::Info, "event=open conn=%u remote=%s", connection->id, s.get_con_from_hdl(hdl)->get_remote_endpoint().c_str());
+	});
 
-	// Set logging settings
-	s.set_access_channels(websocketpp::log::alevel::all);
-	s.clear_access_channels(websocketpp::log::alevel::frame_payload);
+	s.set_close_handler([&](websocketpp::connection_hdl hdl) {
+		auto it = connections.find(hdl);
+		if (it == connections.end())
+			return;
 
-	// Initialize ASIO
-	s.init_asio();
-	s.set_reuse_addr(true);
+		// Whatever the connection still has in flight is cancelled, workers stop on it at the next proto
+		service.closeConnection(it->second);
+
+		logger.log(LogLevel::Info, "event=close conn=%u in_flight=%u", it->second->id, it->second->inFlightRequests.load());
+		connections.erase(it);
+	});
 
 	// Register our message handler
 	s.set_message_handler([&](websocketpp::connection_hdl hdl, server::message_ptr msg) {
-		const std::string& payload = msg->get_payload();
+		auto it = connections.find(hdl);
+		if (it == connections.end())
+			return;
+
 		websocketpp::frame::opcode::value opcode = msg->get_opcode();
+		if (opcode != websocketpp::frame::opcode::binary && opcode != websocketpp::frame::opcode::text)
+			return;
+
+		if (capture.isOpen())
+			capture.record(uint8_t(opcode), it->second->id, msg->get_payload());
+
+		Clock::time_point received = Clock::now();
+
+		RequestSample sample;
+		sample.bytesIn = msg->get_payload().size();
 
 		// Some client websocket interfaces don't support sending binary data, like Synapse X, so they are Base64 encoded
 		// We can tell if a message is meant to be binary or text based on the message's opcode
+		std::string request;
 		if (opcode == websocketpp::frame::opcode::binary) {
-			std::string disassembly = LuauDisassembler::disassemble(payload.c_str(), payload.size(), false);
-			s.send(hdl, disassembly, websocketpp::frame::opcode::text);
-		} else if (opcode == websocketpp::frame::opcode::text) {
-			std::string decoded = websocketpp::base64_decode(payload);
-			std::string disassembly = LuauDisassembler::disassemble(decoded.c_str(), decoded.size(), false);
-			s.send(hdl, disassembly, websocketpp::frame::opcode::text);
+			request = std::move(msg->get_raw_payload());
+		} else {
+			request = websocketpp::base64_decode(msg->get_payload());
+			sample.stageNanoseconds[STAGE_DECODE] = getNanoseconds(received, Clock::now());
+		}
+
+		service.submit(it->second, std::move(request), received, sample, [&s, hdl](const std::string& response, LuauDisassembler::ResponseEncoding encoding, RequestStatus, bool endConnection) {
+			// The connection may have closed while the request ran, so failures to send are ignored
+			websocketpp::lib::error_code ec;
+
+			switch (encoding) {
+			case LuauDisassembler::ResponseEncoding::Binary: {
+				s.send(hdl, response, websocketpp::frame::opcode::binary, ec);
+				break;
+			}
+			case LuauDisassembler::ResponseEncoding::Base64: {
+				s.send(hdl, websocketpp::base64_encode(response), websocketpp::frame::opcode::text, ec);
+				break;
+			}
+			default: {
+				s.send(hdl, response, websocketpp::frame::opcode::text, ec);
+				break;
+			}
+			}
+
+			// The close frame is queued behind the response
+			if (endConnection)
+				s.close(hdl, websocketpp::close::status::policy_violation, "upload ended early", ec);
+		});
+	});
+
+	// Plain HTTP requests on the websocket port: GET /stats returns the request statistics as JSON, POST /disassemble takes
+	// bytecode as the body with options as query parameters and returns the response once it is done
+	s.set_http_handler([&](websocketpp::connection_hdl hdl) {
+		server::connection_ptr con = s.get_con_from_hdl(hdl);
+
+		const std::string& method = con->get_request().get_method();
+		const std::string& resource = con->get_resource();
+		size_t queryStart = resource.find('?');
+		std::string path = resource.substr(0, queryStart);
+
+		if (method == "GET" && path == "/stats") {
+			con->set_status(websocketpp::http::status_code::ok);
+			con->append_header("Content-Type", "application/json");
+			con->set_body(serverStats.format(true));
+		} else if (method == "POST" && path == "/disassemble") {
+			Clock::time_point received = Clock::now();
+
+			std::string request;
+			LuauDisassembler::DisassemblyOptions options;
+			try {
+				request = encode_query_options(queryStart == std::string::npos ? std::string() : resource.substr(queryStart + 1));
+				LuauDisassembler::parse_options(request.c_str(), request.size(), options);
+			} catch (const std::exception& e) {
+				con->set_status(websocketpp::http::status_code::bad_request);
+				con->set_body(std::string("; error: ") + e.what() + '\n');
+				return;
+			}
+			request += con->get_request_body();
+
+			// Each HTTP request is admitted as a connection of its own
+			std::shared_ptr<ServiceConnection> connection = service.openConnection();
+
+			if (capture.isOpen())
+				capture.record(uint8_t(websocketpp::frame::opcode::binary), connection->id, request);
+
+			RequestSample sample;
+			sample.bytesIn = request.size();
+
+			const char* contentType = options.format == LuauDisassembler::OutputFormat::Json ? "application/json" : "text/plain; charset=utf-8";
+
+			// The response is sent once the request finishes, from the io thread since workers finish on their own
+			con->defer_http_response();
+			service.submit(connection, std::move(request), received, sample, [&s, &service, hdl, connection, contentType](const std::string& response, LuauDisassembler::ResponseEncoding, RequestStatus status, bool) {
+				websocketpp::lib::asio::post(s.get_io_service(), [&s, &service, hdl, connection, contentType, response, status] {
+					// The request's connection ends with its only request
+					service.closeConnection(connection);
+
+					websocketpp::lib::error_code ec;
+					server::connection_ptr con = s.get_con_from_hdl(hdl, ec);
+					if (ec)
+						return;
+
+					// Failures are plain text whatever the format asked for
+					switch (status) {
+					case RequestStatus::Ok: {
+						con->set_status(websocketpp::http::status_code::ok);
+						con->append_header("Content-Type", contentType);
+						break;
+					}
+					case RequestStatus::Rejected: {
+						con->set_status(websocketpp::http::status_code::service_unavailable);
+						con->append_header("Content-Type", "text/plain; charset=utf-8");
+						break;
+					}
+					default: {
+						con->set_status(websocketpp::http::status_code::bad_request);
+						con->append_header("Content-Type", "text/plain; charset=utf-8");
+						break;
+					}
+					}
+
+					con->set_body(response);
+					con->send_http_response(ec);
+				});
+			});
+		} else {
+			con->set_status(websocketpp::http::status_code::not_found);
+			con->set_body("Not found\n");
 		}
 	});
 
+#ifdef SO_REUSEPORT
+	// Every listener binds the same port
+	if (options.reusePort) {
+		s.set_tcp_pre_bind_handler([](const std::shared_ptr<websocketpp::lib::asio::ip::tcp::acceptor>& acceptor) {
+			return setReusePort(acceptor->native_handle());
+		});
+	}
+#endif
+
 	// Listen on port defined in config.h
-	s.listen(port);
+	s.listen(options.port);
 
 	// Queues a connection accept operation
 	s.start_accept();
+}
+
+#ifndef _WIN32
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+	stopRequested = 1;
+}
+
+// In a forked listener: signals go back to their defaults, and on Linux the listener goes away with the supervisor, even
+// when it is killed
+static void startListenerProcess(pid_t supervisor) {
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+#ifdef __linux__
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	if (getppid() != supervisor)
+		_exit(0);
+#else
+	(void)supervisor;
+#endif
+}
+
+// Forks a process per listener and stays behind as their supervisor, only returning in a child, with its listener index
+// A listener that dies is forked again, unless it died within a second of starting, which would only repeat (its port is
+// taken, say). Then, or once the supervisor gets SIGTERM or SIGINT, every listener is stopped and the supervisor exits
+static size_t superviseListeners(size_t count) {
+	const std::chrono::seconds MIN_UPTIME(1);
+
+	// Without SA_RESTART, so a signal wakes waitpid up
+	struct sigaction action = {};
+	action.sa_handler = requestStop;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGINT, &action, nullptr);
+
+	// Output still buffered would be written again by every child
+	std::cout.flush();
+
+	pid_t supervisor = getpid();
+	std::vector<pid_t> pids(count, 0);
+	std::vector<Clock::time_point> started(count);
+	int exitCode = 0;
+
+	for (size_t i = 0; i < count && !stopRequested; i++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			std::cerr << "Can't fork listener " << i << ": " << std::strerror(errno) << '\n';
+			exitCode = 1;
+			break;
+		}
+
+		if (pid == 0) {
+			startListenerProcess(supervisor);
+			return i;
+		}
+
+		pids[i] = pid;
+		started[i] = Clock::now();
+	}
+
+	while (!stopRequested && exitCode == 0) {
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		auto it = std::find(pids.begin(), pids.end(), pid);
+		if (it == pids.end())
+			continue;
+
+		size_t i = size_t(it - pids.begin());
+		*it = 0;
+
+		if (WIFSIGNALED(status))
+			std::cerr << "Listener " << i << " (pid " << pid << ") was killed by signal " << WTERMSIG(status);
+		else
+			std::cerr << "Listener " << i << " (pid " << pid << ") exited with status " << WEXITSTATUS(status);
+
+		if (Clock::now() - started[i] < MIN_UPTIME) {
+			std::cerr << " right after starting, stopping the server\n";
+			exitCode = 1;
+			break;
+		}
+		std::cerr << ", restarting it\n";
+
+		pid_t restarted = fork();
+		if (restarted < 0) {
+			std::cerr << "Can't fork listener " << i << ": " << std::strerror(errno) << '\n';
+			exitCode = 1;
+			break;
+		}
+
+		if (restarted == 0) {
+			startListenerProcess(supervisor);
+			return i;
+		}
+
+		*it = restarted;
+		started[i] = Clock::now();
+	}
+
+	for (pid_t pid : pids) {
+		if (pid)
+			kill(pid, SIGTERM);
+	}
+
+	for (pid_t pid : pids) {
+		while (pid && waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+	}
+
+	exit(exitCode);
+}
+#endif
+
+int main(int argc, char* argv[]) {
+	uint16_t port = DISASSEMBLER_DEFAULT_SERVER_PORT;
+	size_t protoCacheSize = DISASSEMBLER_DEFAULT_PROTO_CACHE_SIZE;
+	size_t scriptCacheSize = DISASSEMBLER_DEFAULT_SCRIPT_CACHE_SIZE;
+	size_t similarityMaxProtos = DISASSEMBLER_DEFAULT_SIMILARITY_MAX_PROTOS;
+	std::string signaturesPath;
+	size_t maxMessageSize = DISASSEMBLER_DEFAULT_MAX_MESSAGE_SIZE;
+	ServiceLimits limits;
+	std::string capturePath;
+	uint16_t tcpPort = 0;
+	std::string unixSocketPath;
+	LogLevel logLevel = LogLevel::Info;
+	size_t listenerCount = 1;
+	bool forkListeners = false;
+
+	for (int i = 1; i < argc; i++) { // Check for arguments
+		std::string flag = std::string(argv[i]);
+
+		// Switches don't take a value
+		if (flag == "--fork") {
+			forkListeners = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+			break;
+		std::string value = std::string(argv[++i]);
+
+		if (flag == "-p" || flag == "--port") {
+			port = std::stoi(value, nullptr, 10);
+			if (!port) return 1;
+		} else if (flag == "--cache-mb") {
+			protoCacheSize = std::stoull(value, nullptr, 10) << 20;
+		} else if (flag == "--script-cache-mb") {
+			scriptCacheSize = std::stoull(value, nullptr, 10) << 20;
+		} else if (flag == "--similarity-max-protos") {
+			similarityMaxProtos = std::stoull(value, nullptr, 10);
+		} else if (flag == "--signatures") {
+			signaturesPath = value;
+		} else if (flag == "--capture") {
+			capturePath = value;
+		} else if (flag == "--log-level") {
+			if (!parse_log_level(value, logLevel)) {
+				std::cerr << "Unknown log level " << value << ", expected error, warn, info or debug\n";
+				return 1;
+			}
+		} else if (flag == "--max-message-mb") {
+			maxMessageSize = std::stoull(value, nullptr, 10) << 20;
+		} else if (flag == "--workers") {
+			limits.workerCount = std::stoul(value, nullptr, 10);
+		} else if (flag == "--queue-size") {
+			limits.queueCapacity = std::stoul(value, nullptr, 10);
+		} else if (flag == "--max-connection-requests") {
+			limits.maxConnectionRequests = std::stoul(value, nullptr, 10);
+		} else if (flag == "--max-connection-mb") {
+			limits.maxConnectionMemory = std::stoull(value, nullptr, 10) << 20;
+		} else if (flag == "--max-memory-mb") {
+			limits.maxTotalMemory = std::stoull(value, nullptr, 10) << 20;
+		} else if (flag == "--max-priority-delay-ms") {
+			limits.maxPriorityDelayMilliseconds = std::stoul(value, nullptr, 10);
+		} else if (flag == "--slice-instructions") {
+			limits.sliceInstructions = std::stoull(value, nullptr, 10);
+		} else if (flag == "--upload-idle-timeout-ms") {
+			limits.uploadIdleTimeoutMilliseconds = std::stoul(value, nullptr, 10);
+		} else if (flag == "--tcp-port") {
+			tcpPort = std::stoi(value, nullptr, 10);
+			if (!tcpPort) return 1;
+		} else if (flag == "--unix-socket") {
+			unixSocketPath = value;
+		} else if (flag == "--listeners") {
+			listenerCount = std::stoul(value, nullptr, 10);
+			if (!listenerCount) return 1;
+		}
+	}
+
+#ifndef SO_REUSEPORT
+	if (listenerCount > 1) {
+		std::cerr << "--listeners needs SO_REUSEPORT, which this platform doesn't have\n";
+		return 1;
+	}
+#endif
+
+	ListenerOptions listenerOptions;
+	listenerOptions.port = port;
+	listenerOptions.maxMessageSize = maxMessageSize;
+	listenerOptions.logLevel = logLevel;
+	listenerOptions.reusePort = listenerCount > 1;
+
+	std::cout << "Starting server on port " << port << " with " << listenerCount << (listenerCount == 1 ? " listener" : " listeners") << (forkListeners && listenerCount > 1 ? " in separate processes" : "") << '\n';
+
+	// Compiled once before any listener is forked, so the processes share the automaton's pages
+	std::unique_ptr<LuauDisassembler::SignatureSet> signatures;
+	if (!signaturesPath.empty()) {
+		std::ifstream file(signaturesPath, std::ios::binary);
+		if (!file) {
+			std::cerr << "Can't open signature file " << signaturesPath << '\n';
+			return 1;
+		}
+
+		std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		try {
+			signatures = std::make_unique<LuauDisassembler::SignatureSet>(text);
+		} catch (const std::exception& e) {
+			std::cerr << signaturesPath << ": " << e.what() << '\n';
+			return 1;
+		}
+		std::cout << "Loaded " << signatures->getSize() << " signatures from " << signaturesPath << '\n';
+	}
+
+#ifndef _WIN32
+	// Forked listeners are whole servers of their own that only share the port: nothing is contended between them, at the cost
+	// of a cache, stats and worker pool per process
+	if (forkListeners && listenerCount > 1) {
+		size_t processIndex = superviseListeners(listenerCount);
+
+		// The hardware threads are split between the processes
+		if (!limits.workerCount)
+			limits.workerCount = std::max<size_t>(1, std::thread::hardware_concurrency() / listenerCount);
+
+		// A capture file and a Unix socket path can't be shared, they stay with the first process
+		if (processIndex) {
+			capturePath.clear();
+			unixSocketPath.clear();
+		}
+
+		listenerCount = 1;
+	}
+#else
+	if (forkListeners) {
+		std::cerr << "--fork isn't supported on this platform\n";
+		return 1;
+	}
+#endif
+
+	// Rendered protos are shared between requests, scripts often embed the same library code
+	LuauDisassembler::ProtoCache protoCache(protoCacheSize);
+
+	// Paged requests keep their deserialized script here, so the following pages start rendering right away
+	LuauDisassembler::ScriptCache scriptCache(scriptCacheSize);
+
+	// Fingerprints of the protos of every similar request, to find the same functions in later scripts
+	LuauDisassembler::SimilarityIndex similarityIndex(similarityMaxProtos);
+
+	LuauDisassembler::RequestContext requestContext;
+	if (protoCacheSize > 0)
+		requestContext.protoCache = &protoCache;
+	if (scriptCacheSize > 0)
+		requestContext.scriptCache = &scriptCache;
+	if (similarityMaxProtos > 0)
+		requestContext.similarityIndex = &similarityIndex;
+	requestContext.signatures = signatures.get();
+
+	// Incoming frames are appended to the capture file when one is given, for replaying later with capture_replay
+	CaptureWriter capture;
+	if (!capturePath.empty()) {
+		if (!capture.open(capturePath)) {
+			std::cerr << "Can't open capture file " << capturePath << '\n';
+			return 1;
+		}
+		std::cout << "Capturing frames to " << capturePath << '\n';
+	}
+
+	// Per-stage timings and counters, answered by stats requests and GET /stats
+	ServerStats serverStats;
+
+	// Requests and connections are logged through the asynchronous logger, one line each
+	Logger logger(stdout, logLevel);
+
+	// Requests run on a pool of workers behind admission control; websocketpp's send is thread safe, so workers reply directly
+	RequestService service(limits, requestContext, serverStats, logger);
+
+	std::vector<std::unique_ptr<Listener>> listeners;
+	for (size_t i = 0; i < listenerCount; i++) {
+		listeners.push_back(std::make_unique<Listener>());
+		Listener& listener = *listeners.back();
+
+		// Initialize ASIO
+		listener.s.init_asio();
+		listener.s.set_reuse_addr(true);
+
+		// Length prefixed requests for local tools, on the same io thread and workers as the websocket server
+		listener.rawTransport = std::make_unique<RawTransport>(listener.s.get_io_service(), service, logger, capture, listenerOptions.maxMessageSize);
+		std::string listenError;
+		if (tcpPort && !listener.rawTransport->listenTcp(tcpPort, listenError, listenerOptions.reusePort)) {
+			std::cerr << "Can't listen on TCP port " << tcpPort << ": " << listenError << '\n';
+			return 1;
+		}
+
+		// A Unix socket path can only be bound once
+		if (i == 0 && !unixSocketPath.empty() && !listener.rawTransport->listenUnix(unixSocketPath, listenError)) {
+			std::cerr << "Can't listen on " << unixSocketPath << ": " << listenError << '\n';
+			return 1;
+		}
+
+		startListener(listener, listenerOptions, service, serverStats, logger, capture);
+	}
+
+	if (tcpPort)
+		std::cout << "Listening for raw requests on TCP port " << tcpPort << '\n';
+	if (!unixSocketPath.empty())
+		std::cout << "Listening for raw requests on " << unixSocketPath << '\n';
+
+	// Start the Asio io_service run loops, the first listener runs on the main thread
+	std::vector<std::thread> listenerThreads;
+	for (size_t i = 1; i < listeners.size(); i++)
+		listenerThreads.emplace_back([&listener = *listeners[i]] { listener.s.run(); });
+
+	listeners[0]->s.run();
 
-	// Start the Asio io_service run loop
-	s.run();
+	for (std::thread& thread : listenerThreads)
+		thread.join();
 
 	std::cin.get();
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+#include "disassembler/options.hpp"
+#include "query_options.hpp"
+
+static int getHexDigit(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Undoes percent encoding, and '+' for spaces as forms send them
+static std::string decodeQueryComponent(const std::string& component) {
+	std::string result;
+	result.reserve(component.size());
+
+	for (size_t i = 0; i < component.size(); i++) {
+		char c = component[i];
+		if (c == '+') {
+			result += ' ';
+		} else if (c == '%' && i + 2 < component.size() && getHexDigit(component[i + 1]) >= 0 && getHexDigit(component[i + 2]) >= 0) {
+			result += char(getHexDigit(component[i + 1]) * 16 + getHexDigit(component[i + 2]));
+			i += 2;
+		} else {
+			result += c;
+		}
+	}
+
+	return result;
+}
+
+static void appendLEB128(std::string& output, uint64_t value) {
+	do {
+		uint8_t byte = value & 127;
+		value >>= 7;
+		if (value)
+			byte |= 128;
+		output += char(byte);
+	} while (value);
+}
+
+static void appendField(std::string& envelope, LuauDisassembler::OptionTag tag, const std::string& payload) {
+	envelope += char(tag);
+	appendLEB128(envelope, payload.size());
+	envelope += payload;
+}
+
+static uint64_t parseNumber(const std::string& name, const std::string& value) {
+	if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.size() > 19)
+		throw std::runtime_error("Invalid value for " + name + ": " + value);
+	return std::stoull(value);
+}
+
+static bool parseFlag(const std::string& name, const std::string& value) {
+	if (value.empty() || value == "1" || value == "true")
+		return true;
+	if (value == "0" || value == "false")
+		return false;
+	throw std::runtime_error("Invalid value for " + name + ": " + value);
+}
+
+static std::string encodeNumber(uint64_t value) {
+	std::string payload;
+	appendLEB128(payload, value);
+	return payload;
+}
+
+std::string encode_query_options(const std::string& query) {
+	std::string envelope(LuauDisassembler::OPTIONS_MAGIC, sizeof(LuauDisassembler::OPTIONS_MAGIC));
+
+	size_t start = 0;
+	while (start < query.size()) {
+		size_t end = query.find('&', start);
+		if (end == std::string::npos)
+			end = query.size();
+
+		std::string parameter = query.substr(start, end - start);
+		start = end + 1;
+		if (parameter.empty())
+			continue;
+
+		size_t equals = parameter.find('=');
+		std::string name = decodeQueryComponent(parameter.substr(0, equals));
+		std::string value = equals == std::string::npos ? std::string() : decodeQueryComponent(parameter.substr(equals + 1));
+
+		if (name == "lineInfo") {
+			appendField(envelope, LuauDisassembler::OPTION_LINE_INFO, std::string(1, char(parseFlag(name, value))));
+		} else if (name == "format") {
+			if (value != "text" && value != "json")
+				throw std::runtime_error("Unknown output format " + value);
+			LuauDisassembler::OutputFormat format = value == "json" ? LuauDisassembler::OutputFormat::Json : LuauDisassembler::OutputFormat::Text;
+			appendField(envelope, LuauDisassembler::OPTION_OUTPUT_FORMAT, std::string(1, char(format)));
+		} else if (name == "protos") {
+			std::string ids;
+			size_t idStart = 0;
+			while (idStart <= value.size()) {
+				size_t idEnd = value.find(',', idStart);
+				if (idEnd == std::string::npos)
+					idEnd = value.size();
+				appendLEB128(ids, parseNumber(name, value.substr(idStart, idEnd - idStart)));
+				idStart = idEnd + 1;
+			}
+			appendField(envelope, LuauDisassembler::OPTION_PROTO_IDS, ids);
+		} else if (name == "name") {
+			appendField(envelope, LuauDisassembler::OPTION_PROTO_NAME, value);
+		} else if (name == "maxOutputBytes") {
+			appendField(envelope, LuauDisassembler::OPTION_MAX_OUTPUT_BYTES, encodeNumber(parseNumber(name, value)));
+		} else if (name == "blocks") {
+			appendField(envelope, LuauDisassembler::OPTION_BLOCKS, std::string(1, char(parseFlag(name, value))));
+		} else if (name == "calls") {
+			appendField(envelope, LuauDisassembler::OPTION_CALL_NOTES, std::string(1, char(parseFlag(name, value))));
+		} else if (name == "signatures") {
+			appendField(envelope, LuauDisassembler::OPTION_SIGNATURE_MATCHES, std::string(1, char(parseFlag(name, value))));
+		} else if (name == "mode") {
+			LuauDisassembler::RequestMode mode;
+			if (value == "disassemble")
+				mode = LuauDisassembler::RequestMode::Disassemble;
+			else if (value == "references")
+				mode = LuauDisassembler::RequestMode::References;
+			else if (value == "diff")
+				mode = LuauDisassembler::RequestMode::Diff;
+			else if (value == "stats")
+				mode = LuauDisassembler::RequestMode::Stats;
+			else if (value == "similar")
+				mode = LuauDisassembler::RequestMode::Similar;
+			else if (value == "opcodes")
+				mode = LuauDisassembler::RequestMode::Opcodes;
+			else if (value == "constants")
+				mode = LuauDisassembler::RequestMode::Constants;
+			else if (value == "signatures")
+				mode = LuauDisassembler::RequestMode::Signatures;
+			else
+				throw std::runtime_error("Unknown mode " + value);
+			appendField(envelope, LuauDisassembler::OPTION_MODE, std::string(1, char(mode)));
+		} else if (name == "references") {
+			appendField(envelope, LuauDisassembler::OPTION_REFERENCE_QUERY, value);
+		} else if (name == "oldSize") {
+			appendField(envelope, LuauDisassembler::OPTION_DIFF_BASE_SIZE, encodeNumber(parseNumber(name, value)));
+		} else if (name == "deadline") {
+			appendField(envelope, LuauDisassembler::OPTION_DEADLINE_MS, encodeNumber(parseNumber(name, value)));
+		} else if (name == "pageBytes") {
+			appendField(envelope, LuauDisassembler::OPTION_PAGE_BYTES, encodeNumber(parseNumber(name, value)));
+		} else if (name == "range") {
+			// first,count with count optional
+			size_t comma = value.find(',');
+			std::string range = encodeNumber(parseNumber(name, value.substr(0, comma)));
+			appendLEB128(range, comma == std::string::npos ? 0 : parseNumber(name, value.substr(comma + 1)));
+			appendField(envelope, LuauDisassembler::OPTION_PROTO_RANGE, range);
+		} else if (name == "constantProtos") {
+			appendField(envelope, LuauDisassembler::OPTION_CONSTANT_PROTOS, std::string(1, char(parseFlag(name, value))));
+		} else if (name == "script") {
+			appendField(envelope, LuauDisassembler::OPTION_SCRIPT_NAME, value);
+		} else if (name == "cursor") {
+			appendField(envelope, LuauDisassembler::OPTION_CURSOR, value);
+		} else {
+			throw std::runtime_error("Unknown parameter " + name);
+		}
+	}
+
+	envelope += char(LuauDisassembler::OPTION_END);
+	return envelope;
+}
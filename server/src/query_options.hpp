@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+// Turns the query string of an HTTP request (lineInfo=1&format=json&protos=0,4) into the options envelope a websocket client
+// puts in front of the bytecode, so HTTP requests take the same path as frames. Parameters are named like client.lua's
+// options; oldSize gives the size of the old bytecode of a diff, which comes first in the body. Throws std::runtime_error
+// on an unknown parameter or value
+std::string encode_query_options(const std::string& query);
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include <deque>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "raw_transport.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Requests are captured as binary websocket frames, so capture_replay replays them like any other
+constexpr uint8_t FRAME_BINARY = 2;
+
+// Payloads are read this much at a time, so a declared length only costs memory as its bytes arrive
+constexpr size_t PAYLOAD_CHUNK_SIZE = 64 * 1024;
+
+struct RawTransport::Session {
+	Session(boost::asio::io_context& io, bool tcp) : socket(io), tcp(tcp) {}
+
+	Protocol::socket socket;
+	bool tcp;
+	bool closed = false;
+	bool closing = false; // closed once the queued writes are done
+	std::shared_ptr<ServiceConnection> connection;
+	std::string remote;
+
+	uint8_t header[4] = {};
+	uint32_t payloadLength = 0; // from the header, payload grows to it
+	std::string payload;
+
+	// Responses waiting to be written, front is being written; only touched on the io thread
+	std::deque<std::string> writes;
+};
+
+static uint32_t readLength(const uint8_t* bytes) {
+	return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+RawTransport::RawTransport(boost::asio::io_context& io, RequestService& service, Logger& logger, CaptureWriter& capture, size_t maxMessageSize) :
+	io(io),
+	service(service),
+	logger(logger),
+	capture(capture),
+	maxMessageSize(maxMessageSize)
+{}
+
+RawTransport::~RawTransport() {
+	for (const std::string& path : socketPaths)
+		remove(path.c_str());
+}
+
+bool RawTransport::listenTcp(uint16_t port, std::string& error, bool reusePort) {
+	boost::system::error_code ec;
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+
+	std::unique_ptr<Listener> listener(new Listener{ Acceptor(io), true });
+	listener->acceptor.open(Protocol(endpoint.protocol()), ec);
+	if (!ec)
+		listener->acceptor.set_option(Acceptor::reuse_address(true), ec);
+#ifdef SO_REUSEPORT
+	if (!ec && reusePort)
+		listener->acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+#endif
+	if (!ec)
+		listener->acceptor.bind(Protocol::endpoint(endpoint), ec);
+	if (!ec)
+		listener->acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+
+	if (ec) {
+		error = ec.message();
+		return false;
+	}
+
+	accept(*listener);
+	listeners.push_back(std::move(listener));
+	return true;
+}
+
+bool RawTransport::listenUnix(const std::string& path, std::string& error) {
+	boost::system::error_code ec;
+	boost::asio::local::stream_protocol::endpoint endpoint(path);
+
+	// A socket file left behind by a server that didn't shut down cleanly would make bind fail; anything else at the path is
+	// the operator's and is left alone
+#ifndef _WIN32
+	struct stat status;
+	if (lstat(path.c_str(), &status) == 0) {
+		if (!S_ISSOCK(status.st_mode)) {
+			error = "path exists and is not a socket";
+			return false;
+		}
+		unlink(path.c_str());
+	}
+#endif
+
+	std::unique_ptr<Listener> listener(new Listener{ Acceptor(io), false });
+	listener->acceptor.open(Protocol(endpoint.protocol()), ec);
+	if (!ec)
+		listener->acceptor.bind(Protocol::endpoint(endpoint), ec);
+	if (!ec)
+		listener->acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+
+	if (ec) {
+		error = ec.message();
+		return false;
+	}
+
+	socketPaths.push_back(path);
+	accept(*listener);
+	listeners.push_back(std::move(listener));
+	return true;
+}
+
+void RawTransport::accept(Listener& listener) {
+	std::shared_ptr<Session> session = std::make_shared<Session>(io, listener.tcp);
+
+	listener.acceptor.async_accept(session->socket, [this, &listener, session](const boost::system::error_code& ec) {
+		if (ec == boost::asio::error::operation_aborted)
+			return;
+
+		if (!ec)
+			start(session);
+
+		accept(listener);
+	});
+}
+
+void RawTransport::start(const std::shared_ptr<Session>& session) {
+	boost::system::error_code ec;
+
+	if (session->tcp) {
+		// Requests and responses are single writes, waiting to coalesce them only adds latency
+		session->socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+
+		Protocol::endpoint remote = session->socket.remote_endpoint(ec);
+		boost::asio::ip::tcp::endpoint endpoint;
+		if (!ec && remote.size() <= endpoint.capacity()) {
+			memcpy(endpoint.data(), remote.data(), remote.size());
+			endpoint.resize(remote.size());
+			session->remote = endpoint.address().to_string() + ':' + std::to_string(endpoint.port());
+		}
+	} else {
+		session->remote = "unix";
+	}
+
+	session->connection = service.openConnection();
+
+	if (logger.isEnabled(LogLevel::Info))
+		logger.log(LogLevel::Info, "event=open conn=%u transport=%s remote=%s", session->connection->id, session->tcp ? "tcp" : "unix", session->remote.c_str());
+
+	readHeader(session);
+}
+
+void RawTransport::readHeader(const std::shared_ptr<Session>& session) {
+	boost::asio::async_read(session->socket, boost::asio::buffer(session->header), [this, session](const boost::system::error_code& ec, size_t) {
+		if (ec) {
+			close(session);
+			return;
+		}
+
+		// Same limit as websocket frames, an oversized request closes the connection before anything is read for it
+		uint32_t length = readLength(session->header);
+		if (length > maxMessageSize) {
+			logger.log(LogLevel::Warn, "event=refused conn=%u bytes_in=%u error=\"message too big\"", session->connection->id, length);
+			close(session);
+			return;
+		}
+
+		session->payloadLength = length;
+		readPayload(session);
+	});
+}
+
+void RawTransport::readPayload(const std::shared_ptr<Session>& session) {
+	size_t offset = session->payload.size();
+	if (offset == session->payloadLength) {
+		submit(session);
+		return;
+	}
+
+	// Grown a chunk at a time rather than to the declared length up front, so an idle connection can't hold memory admission
+	// control never sees
+	size_t chunk = std::min(PAYLOAD_CHUNK_SIZE, session->payloadLength - offset);
+	session->payload.resize(offset + chunk);
+
+	boost::asio::async_read(session->socket, boost::asio::buffer(&session->payload[offset], chunk), [this, session](const boost::system::error_code& ec, size_t) {
+		if (ec) {
+			close(session);
+			return;
+		}
+
+		readPayload(session);
+	});
+}
+
+void RawTransport::submit(const std::shared_ptr<Session>& session) {
+	if (capture.isOpen())
+		capture.record(FRAME_BINARY, session->connection->id, session->payload);
+
+	Clock::time_point received = Clock::now();
+
+	RequestSample sample;
+	sample.bytesIn = session->payload.size();
+
+	// Responses come back on worker threads, the socket is only written on the io thread
+	std::weak_ptr<Session> weakSession = session;
+	boost::asio::io_context& io = this->io;
+	service.submit(session->connection, std::move(session->payload), received, sample, [this, &io, weakSession](const std::string& response, LuauDisassembler::ResponseEncoding, RequestStatus, bool endConnection) {
+		std::string frame;
+		frame.reserve(4 + response.size());
+		uint32_t length = uint32_t(response.size());
+		frame += char(length);
+		frame += char(length >> 8);
+		frame += char(length >> 16);
+		frame += char(length >> 24);
+		frame += response;
+
+		boost::asio::post(io, [this, weakSession, endConnection, frame = std::move(frame)]() mutable {
+			std::shared_ptr<Session> session = weakSession.lock();
+			if (!session || session->closed)
+				return;
+
+			session->closing |= endConnection;
+			session->writes.push_back(std::move(frame));
+			if (session->writes.size() == 1)
+				write(session);
+		});
+	});
+
+	session->payload = std::string();
+	readHeader(session);
+}
+
+void RawTransport::write(const std::shared_ptr<Session>& session) {
+	boost::asio::async_write(session->socket, boost::asio::buffer(session->writes.front()), [this, session](const boost::system::error_code& ec, size_t) {
+		// A read error can close the session while this completion is already queued, the writes are gone by then
+		if (session->closed)
+			return;
+
+		if (ec) {
+			close(session);
+			return;
+		}
+
+		session->writes.pop_front();
+		if (!session->writes.empty())
+			write(session);
+		else if (session->closing)
+			close(session);
+	});
+}
+
+void RawTransport::close(const std::shared_ptr<Session>& session) {
+	if (session->closed)
+		return;
+
+	session->closed = true;
+	session->writes.clear();
+
+	boost::system::error_code ec;
+	session->socket.close(ec);
+
+	// Whatever the connection still has in flight is cancelled, workers stop on it at the next proto
+	service.closeConnection(session->connection);
+
+	logger.log(LogLevel::Info, "event=close conn=%u in_flight=%u", session->connection->id, session->connection->inFlightRequests.load());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "capture.hpp"
+#include "logger.hpp"
+#include "service.hpp"
+
+// Requests over plain TCP or a Unix domain socket, for local tools that don't need the websocket handshake, masking or Base64
+// Messages both ways are a u32 little endian length followed by that many bytes. A request is what a binary websocket
+// frame carries (an optional options envelope, then bytecode), a response is the response bytes, whatever encoding the
+// options ask for. Runs on the websocket server's io_context and submits to the same RequestService
+class RawTransport {
+public:
+	RawTransport(boost::asio::io_context& io, RequestService& service, Logger& logger, CaptureWriter& capture, size_t maxMessageSize);
+	~RawTransport();
+
+	RawTransport(const RawTransport&) = delete;
+	RawTransport& operator=(const RawTransport&) = delete;
+
+	// Both can be called, and more than once; on failure error says why. With reusePort, other sockets (other listeners or
+	// processes) can bind the same TCP port, and the kernel balances connections between them
+	bool listenTcp(uint16_t port, std::string& error, bool reusePort = false);
+	bool listenUnix(const std::string& path, std::string& error);
+
+private:
+	// TCP and Unix sockets are handled as generic stream sockets, one code path for both
+	using Protocol = boost::asio::generic::stream_protocol;
+	using Acceptor = boost::asio::basic_socket_acceptor<Protocol>;
+
+	struct Session;
+
+	struct Listener {
+		Acceptor acceptor;
+		bool tcp;
+	};
+
+	boost::asio::io_context& io;
+	RequestService& service;
+	Logger& logger;
+	CaptureWriter& capture;
+	size_t maxMessageSize;
+
+	std::vector<std::unique_ptr<Listener>> listeners;
+	std::vector<std::string> socketPaths; // removed on shutdown
+
+	void accept(Listener& listener);
+	void start(const std::shared_ptr<Session>& session);
+	void readHeader(const std::shared_ptr<Session>& session);
+	void readPayload(const std::shared_ptr<Session>& session);
+	void submit(const std::shared_ptr<Session>& session);
+	void write(const std::shared_ptr<Session>& session);
+	void close(const std::shared_ptr<Session>& session);
+};
\ No newline at end of file
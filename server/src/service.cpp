@@ -0,0 +1,574 @@
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "disassembler/scan.hpp"
+#include "service.hpp"
+
+struct RequestService::Job {
+	std::shared_ptr<ServiceConnection> connection;
+	std::string request;
+	LuauDisassembler::DisassemblyOptions options;
+	size_t bytecodeOffset = 0;
+	size_t memoryEstimate = 0;
+	uint64_t workEstimate = 0; // in code words
+	uint64_t remainingWork = 0;
+	Clock::time_point received;
+	Clock::time_point enqueued;
+	RequestSample sample;
+	Reply reply;
+	LuauDisassembler::CancellationToken cancellation;
+	bool endConnection = false; // answered while the rest of its upload is still on the way
+
+	// Between slices of a long request
+	std::unique_ptr<LuauDisassembler::RequestRunner> runner;
+	LuauDisassembler::RequestMetrics metrics;
+	uint32_t slices = 0;
+};
+
+// Bytecode uploaded over several frames: the transport queues the pieces and one worker task at a time drains them,
+// deserializing and rendering whatever they complete, so the response is mostly done when the last piece arrives
+struct PendingUpload {
+	std::shared_ptr<RequestService::Job> job;
+	std::unique_ptr<LuauDisassembler::StreamingRunner> runner;
+	size_t size = 0;
+	size_t received = 0; // only touched by the transport
+	size_t queued = 0; // bytes handed to the drain task before the response went out
+
+	std::mutex mutex;
+	std::vector<std::string> pieces;
+	uint64_t bytesIn = 0;
+	uint64_t decodeNanoseconds = 0;
+	bool drainScheduled = false;
+	bool answered = false; // the response went out before the last piece (an error, or output cut off), the rest is dropped
+	bool stalled = false; // no piece arrived within the idle timeout
+	RequestService::Clock::time_point lastPiece;
+};
+
+struct RequestEstimate {
+	size_t memory = 0;
+	uint64_t work = 0;
+};
+
+// A refused upload still has the rest of its pieces on the way, they are read off the connection and dropped until the
+// transport closes it; returns whether any are left
+static bool skipUpload(ServiceConnection& connection, size_t size, size_t received) {
+	if (received >= size)
+		return false;
+
+	std::shared_ptr<PendingUpload> upload = std::make_shared<PendingUpload>();
+	upload->size = size;
+	upload->received = received;
+	upload->answered = true;
+	connection.upload = upload;
+	return true;
+}
+
+const char* get_request_status_name(RequestStatus status) {
+	switch (status) {
+	case RequestStatus::Ok: return "ok";
+	case RequestStatus::Error: return "error";
+	case RequestStatus::Rejected: return "rejected";
+	case RequestStatus::Cancelled: return "cancelled";
+	}
+	return "unknown";
+}
+
+static uint64_t getNanoseconds(RequestService::Clock::time_point from, RequestService::Clock::time_point to) {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+// Scans the bytecode (both versions of a diff) and estimates its memory and work, so oversized or malformed requests are
+// refused before anything is allocated for them and the rest can be scheduled by size
+static RequestEstimate estimateRequest(const char* bytecode, size_t size, const LuauDisassembler::DisassemblyOptions& options) {
+	RequestEstimate estimate;
+
+	// A cursor without bytecode resumes from the script cache, only the page itself is left
+	if (size == 0 && options.hasCursor) {
+		estimate.memory = options.pageBytes * 2;
+		estimate.work = options.pageBytes / 16;
+		return estimate;
+	}
+
+	auto add = [&](const char* data, size_t dataSize) {
+		LuauDisassembler::BytecodeSummary summary = LuauDisassembler::scan_bytecode(data, dataSize);
+		estimate.memory += LuauDisassembler::estimate_request_memory(summary, options);
+		estimate.work += LuauDisassembler::estimate_request_work(summary, options);
+	};
+
+	if (options.mode == LuauDisassembler::RequestMode::Diff && options.diffBaseSize > 0 && options.diffBaseSize < size) {
+		add(bytecode, options.diffBaseSize);
+		add(bytecode + options.diffBaseSize, size - options.diffBaseSize);
+	} else {
+		add(bytecode, size);
+	}
+
+	return estimate;
+}
+
+RequestService::RequestService(const ServiceLimits& limits, const LuauDisassembler::RequestContext& context, ServerStats& stats, Logger& logger) :
+	limits(limits),
+	context(context),
+	stats(stats),
+	logger(logger),
+	dispatcher(limits.workerCount ? limits.workerCount : std::max(1u, std::thread::hardware_concurrency()), limits.queueCapacity)
+{
+	uploadTimer = std::thread([this] { timeUploads(); });
+}
+
+RequestService::~RequestService() {
+	{
+		std::lock_guard<std::mutex> lock(uploadsMutex);
+		stopping = true;
+	}
+	uploadsChanged.notify_one();
+	uploadTimer.join();
+}
+
+std::shared_ptr<ServiceConnection> RequestService::openConnection() {
+	std::shared_ptr<ServiceConnection> connection = std::make_shared<ServiceConnection>();
+	connection->id = nextConnectionId.fetch_add(1, std::memory_order_relaxed);
+	return connection;
+}
+
+void RequestService::closeConnection(const std::shared_ptr<ServiceConnection>& connection) {
+	connection->closed.store(true, std::memory_order_relaxed);
+
+	// An upload waiting for frames that won't come is woken up to find its connection closed
+	if (std::shared_ptr<PendingUpload> upload = std::move(connection->upload))
+		continueUpload(upload, std::string(), RequestSample());
+}
+
+void RequestService::submit(const std::shared_ptr<ServiceConnection>& connection, std::string request, Clock::time_point received, RequestSample sample, Reply reply) {
+	// Frames continuing a chunked upload are raw bytecode, without an options envelope
+	if (connection->upload) {
+		std::shared_ptr<PendingUpload> upload = connection->upload;
+		upload->received += request.size();
+		if (upload->received >= upload->size)
+			connection->upload.reset();
+
+		continueUpload(upload, std::move(request), sample);
+		return;
+	}
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->connection = connection;
+	job->request = std::move(request);
+	job->received = received;
+	job->sample = sample;
+	job->reply = std::move(reply);
+
+	try {
+		job->bytecodeOffset = LuauDisassembler::parse_options(job->request.c_str(), job->request.size(), job->options);
+
+		// Requests stop once their connection closes, the deadline counts from when the transport received the request
+		job->cancellation.cancelled = &connection->closed;
+		if (job->options.deadlineMilliseconds)
+			job->cancellation.deadline = received + std::chrono::milliseconds(job->options.deadlineMilliseconds);
+
+		// Stats are cheap and most useful when the server is overloaded, so they skip the queue
+		if (job->options.mode == LuauDisassembler::RequestMode::Stats) {
+			finish(*job, stats.format(job->options.format == LuauDisassembler::OutputFormat::Json), RequestStatus::Ok, "");
+			return;
+		}
+
+		// Pages are cut from a whole deserialized script, which an upload only has at its end
+		if (job->options.isPaged() && (job->options.mode != LuauDisassembler::RequestMode::Disassemble || job->options.uploadSize))
+			throw std::runtime_error("Only disassembly with the whole bytecode in one frame can be paged");
+
+		if (job->options.uploadSize) {
+			// Only disassembly can start before the whole bytecode is there
+			if (job->options.mode != LuauDisassembler::RequestMode::Disassemble)
+				throw std::runtime_error("Only disassembly requests can be uploaded in pieces");
+
+			// There is nothing to scan yet, at most one code word for every four bytes
+			job->memoryEstimate = LuauDisassembler::estimate_upload_memory(job->options.uploadSize, job->options);
+			job->workEstimate = job->options.uploadSize / sizeof(uint32_t);
+		} else {
+			RequestEstimate estimate = estimateRequest(job->request.c_str() + job->bytecodeOffset, job->request.size() - job->bytecodeOffset, job->options);
+			job->memoryEstimate = estimate.memory;
+			job->workEstimate = estimate.work;
+		}
+		job->remainingWork = job->workEstimate;
+		if (job->memoryEstimate > std::min(limits.maxConnectionMemory, limits.maxTotalMemory))
+			throw std::runtime_error("Request needs an estimated " + std::to_string(job->memoryEstimate >> 20) + " MB, over the server's limit");
+	} catch (const std::exception& e) {
+		job->endConnection = skipUpload(*connection, job->options.uploadSize, job->request.size() - job->bytecodeOffset);
+		finish(*job, std::string("; error: ") + e.what() + '\n', RequestStatus::Error, e.what());
+		return;
+	}
+
+	if (!admit(*job)) {
+		job->endConnection = skipUpload(*connection, job->options.uploadSize, job->request.size() - job->bytecodeOffset);
+		finish(*job, "; error: server overloaded, try again later\n", RequestStatus::Rejected, "too many requests in flight");
+		return;
+	}
+
+	if (job->options.uploadSize) {
+		startUpload(connection, job);
+		return;
+	}
+
+	job->enqueued = Clock::now();
+	if (!dispatcher.submit([this, job] { run(job); }, getDeadline(job->enqueued, job->remainingWork))) {
+		release(*job);
+		finish(*job, "; error: server overloaded, try again later\n", RequestStatus::Rejected, "work queue full");
+		return;
+	}
+}
+
+// Reserves the request's place in its connection's and the server's budgets, or leaves them untouched and refuses it
+bool RequestService::admit(Job& job) {
+	ServiceConnection& connection = *job.connection;
+	size_t memory = job.memoryEstimate;
+
+	if (connection.inFlightRequests.fetch_add(1, std::memory_order_relaxed) >= limits.maxConnectionRequests) {
+		connection.inFlightRequests.fetch_sub(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (connection.inFlightMemory.fetch_add(memory, std::memory_order_relaxed) + memory > limits.maxConnectionMemory) {
+		connection.inFlightMemory.fetch_sub(memory, std::memory_order_relaxed);
+		connection.inFlightRequests.fetch_sub(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	if (totalMemory.fetch_add(memory, std::memory_order_relaxed) + memory > limits.maxTotalMemory) {
+		totalMemory.fetch_sub(memory, std::memory_order_relaxed);
+		connection.inFlightMemory.fetch_sub(memory, std::memory_order_relaxed);
+		connection.inFlightRequests.fetch_sub(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+void RequestService::release(Job& job) {
+	totalMemory.fetch_sub(job.memoryEstimate, std::memory_order_relaxed);
+	job.connection->inFlightMemory.fetch_sub(job.memoryEstimate, std::memory_order_relaxed);
+	job.connection->inFlightRequests.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Shortest estimated work first, with the head start capped so long requests still make progress under a stream of short ones
+RequestService::Clock::time_point RequestService::getDeadline(Clock::time_point enqueued, uint64_t work) const {
+	std::chrono::nanoseconds expected(work * DISASSEMBLER_NANOSECONDS_PER_INSTRUCTION);
+	return enqueued + std::min<std::chrono::nanoseconds>(expected, std::chrono::milliseconds(limits.maxPriorityDelayMilliseconds));
+}
+
+void RequestService::run(const std::shared_ptr<Job>& job) {
+	Clock::time_point started = Clock::now();
+	uint64_t allocationsBefore = get_thread_allocations();
+
+	RequestSample& sample = job->sample;
+	sample.stageNanoseconds[STAGE_QUEUE] += getNanoseconds(job->enqueued, started);
+	job->slices++;
+
+	std::string response;
+	RequestStatus status = RequestStatus::Ok;
+	std::string error;
+	bool done = true;
+
+	try {
+		// Nobody is waiting for the response any more, whatever is queued of the request is dropped unrun
+		if (job->cancellation.isCancelled())
+			throw LuauDisassembler::RequestCancelled(false);
+
+		if (!job->runner) {
+			LuauDisassembler::RequestContext requestContext = context;
+			requestContext.metrics = &job->metrics;
+			requestContext.cancellation = &job->cancellation;
+			job->runner = std::make_unique<LuauDisassembler::RequestRunner>(job->request.c_str() + job->bytecodeOffset, job->request.size() - job->bytecodeOffset, job->options, requestContext);
+		}
+
+		done = job->runner->step(limits.sliceInstructions ? limits.sliceInstructions : UINT64_MAX);
+		if (done)
+			response = job->runner->takeResponse();
+	} catch (const LuauDisassembler::RequestCancelled& e) {
+		// Only modes that can't return partial output get here on a deadline
+		response = std::string("; error: ") + e.what() + '\n';
+		status = e.expired ? RequestStatus::Error : RequestStatus::Cancelled;
+		error = e.what();
+	} catch (const std::exception& e) {
+		response = std::string("; error: ") + e.what() + '\n';
+		status = RequestStatus::Error;
+		error = e.what();
+	}
+
+	sample.allocations += get_thread_allocations() - allocationsBefore;
+
+	// Not finished: the rest goes back in the queue as a slice-sized task, behind any shorter request that came in meanwhile
+	if (!done) {
+		job->remainingWork -= std::min(job->remainingWork, limits.sliceInstructions);
+		job->enqueued = Clock::now();
+		dispatcher.requeue([this, job] { run(job); }, getDeadline(job->enqueued, std::min(job->remainingWork, limits.sliceInstructions)));
+		return;
+	}
+
+	// The deserialized protos go before the response is sent
+	job->runner.reset();
+
+	const LuauDisassembler::RequestMetrics& metrics = job->metrics;
+	sample.stageNanoseconds[STAGE_DESERIALIZE] = metrics.deserializeNanoseconds;
+	sample.stageNanoseconds[STAGE_FORMAT] = metrics.formatNanoseconds;
+	sample.protos = metrics.protos;
+	sample.instructions = metrics.instructions;
+	sample.cacheHits = metrics.cacheHits;
+	sample.cacheMisses = metrics.cacheMisses;
+
+	finish(*job, response, status, error);
+	release(*job);
+}
+
+void RequestService::startUpload(const std::shared_ptr<ServiceConnection>& connection, const std::shared_ptr<Job>& job) {
+	std::shared_ptr<PendingUpload> upload = std::make_shared<PendingUpload>();
+	upload->job = job;
+	upload->size = job->options.uploadSize;
+
+	LuauDisassembler::RequestContext requestContext = context;
+	requestContext.metrics = &job->metrics;
+	requestContext.cancellation = &job->cancellation;
+	upload->runner = std::make_unique<LuauDisassembler::StreamingRunner>(job->options.uploadSize, job->options, requestContext);
+
+	// The bytecode in the first frame is the first piece, the connection's next frames bring the rest
+	std::string piece = job->request.substr(job->bytecodeOffset);
+	job->request = std::string();
+
+	upload->received = piece.size();
+	upload->lastPiece = Clock::now();
+	if (upload->received < upload->size) {
+		connection->upload = upload;
+
+		{
+			std::lock_guard<std::mutex> lock(uploadsMutex);
+			uploads.push_back(upload);
+		}
+		uploadsChanged.notify_one();
+	}
+
+	continueUpload(upload, std::move(piece), RequestSample());
+}
+
+// Queues a piece for the upload's drain task, starting the task unless it is already queued or running
+void RequestService::continueUpload(const std::shared_ptr<PendingUpload>& upload, std::string piece, const RequestSample& sample) {
+	{
+		std::lock_guard<std::mutex> lock(upload->mutex);
+
+		// After an early response, the rest of the upload only needs to be read off the connection
+		if (upload->answered)
+			return;
+
+		upload->queued += piece.size();
+		upload->lastPiece = Clock::now();
+		upload->pieces.push_back(std::move(piece));
+		upload->bytesIn += sample.bytesIn;
+		upload->decodeNanoseconds += sample.stageNanoseconds[STAGE_DECODE];
+
+		if (upload->drainScheduled)
+			return;
+
+		upload->drainScheduled = true;
+		upload->job->enqueued = Clock::now();
+	}
+
+	// Already admitted, so it goes past the queue capacity; each drain runs about a slice of work
+	dispatcher.requeue([this, upload] { drainUpload(upload); }, getDeadline(Clock::now(), limits.sliceInstructions));
+}
+
+void RequestService::drainUpload(const std::shared_ptr<PendingUpload>& upload) {
+	Job& job = *upload->job;
+	Clock::time_point started = Clock::now();
+	uint64_t allocationsBefore = get_thread_allocations();
+
+	RequestSample& sample = job.sample;
+	sample.stageNanoseconds[STAGE_QUEUE] += getNanoseconds(job.enqueued, started);
+	job.slices++;
+
+	std::vector<std::string> pieces;
+	bool stalled = false;
+	{
+		std::lock_guard<std::mutex> lock(upload->mutex);
+		pieces.swap(upload->pieces);
+		stalled = upload->stalled;
+		sample.bytesIn += upload->bytesIn;
+		sample.stageNanoseconds[STAGE_DECODE] += upload->decodeNanoseconds;
+		upload->bytesIn = 0;
+		upload->decodeNanoseconds = 0;
+	}
+
+	std::string response;
+	RequestStatus status = RequestStatus::Ok;
+	std::string error;
+	bool done = true;
+
+	try {
+		if (job.cancellation.isCancelled())
+			throw LuauDisassembler::RequestCancelled(false);
+
+		if (stalled)
+			throw std::runtime_error("Upload stalled, no piece arrived for " + std::to_string(limits.uploadIdleTimeoutMilliseconds) + " ms");
+
+		for (const std::string& piece : pieces)
+			upload->runner->push(piece.data(), piece.size());
+
+		done = upload->runner->step(limits.sliceInstructions ? limits.sliceInstructions : UINT64_MAX);
+		if (done)
+			response = upload->runner->takeResponse();
+	} catch (const LuauDisassembler::RequestCancelled& e) {
+		response = std::string("; error: ") + e.what() + '\n';
+		status = RequestStatus::Cancelled;
+		error = e.what();
+	} catch (const std::exception& e) {
+		response = std::string("; error: ") + e.what() + '\n';
+		status = RequestStatus::Error;
+		error = e.what();
+	}
+
+	sample.allocations += get_thread_allocations() - allocationsBefore;
+
+	if (!done) {
+		{
+			std::lock_guard<std::mutex> lock(upload->mutex);
+
+			// Caught up with everything that has arrived, the next piece starts the task again
+			if (upload->runner->needsData() && upload->pieces.empty()) {
+				upload->drainScheduled = false;
+				return;
+			}
+
+			job.enqueued = Clock::now();
+		}
+
+		dispatcher.requeue([this, upload] { drainUpload(upload); }, getDeadline(job.enqueued, limits.sliceInstructions));
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(upload->mutex);
+		upload->answered = true;
+		upload->pieces.clear();
+
+		// Pieces arriving from now on are dropped, a client still sending them can't be told apart from its next request
+		job.endConnection = upload->queued < upload->size;
+	}
+
+	// The deserialized protos go before the response is sent
+	upload->runner.reset();
+
+	const LuauDisassembler::RequestMetrics& metrics = job.metrics;
+	sample.stageNanoseconds[STAGE_DESERIALIZE] = metrics.deserializeNanoseconds;
+	sample.stageNanoseconds[STAGE_FORMAT] = metrics.formatNanoseconds;
+	sample.protos = metrics.protos;
+	sample.instructions = metrics.instructions;
+	sample.cacheHits = metrics.cacheHits;
+	sample.cacheMisses = metrics.cacheMisses;
+
+	finish(job, response, status, error);
+	release(job);
+}
+
+// Wakes the drain task of uploads that stopped receiving pieces or passed their deadline, so they are answered (with an
+// error or the output so far) and their admission released even if the client never sends another frame
+void RequestService::timeUploads() {
+	std::unique_lock<std::mutex> lock(uploadsMutex);
+
+	while (!stopping) {
+		Clock::time_point now = Clock::now();
+		Clock::time_point next = Clock::time_point::max();
+		std::vector<std::shared_ptr<PendingUpload>> expired;
+
+		for (size_t i = 0; i < uploads.size();) {
+			std::shared_ptr<PendingUpload> upload = uploads[i].lock();
+
+			bool done = !upload;
+			if (upload) {
+				std::lock_guard<std::mutex> uploadLock(upload->mutex);
+
+				Clock::time_point deadline = upload->job->cancellation.deadline;
+				Clock::time_point idleTimeout = Clock::time_point::max();
+				if (limits.uploadIdleTimeoutMilliseconds)
+					idleTimeout = upload->lastPiece + std::chrono::milliseconds(limits.uploadIdleTimeoutMilliseconds);
+
+				// Once every piece is there the drain task finishes on its own
+				if (upload->answered || upload->queued >= upload->size) {
+					done = true;
+				} else if (deadline <= now || idleTimeout <= now) {
+					// Past its deadline the output is cut off as usual, a stalled upload gets an error
+					upload->stalled = deadline > now;
+					expired.push_back(upload);
+					done = true;
+				} else {
+					next = std::min({ next, deadline, idleTimeout });
+				}
+			}
+
+			if (done) {
+				uploads[i] = std::move(uploads.back());
+				uploads.pop_back();
+			} else {
+				i++;
+			}
+		}
+
+		if (!expired.empty()) {
+			lock.unlock();
+			for (const std::shared_ptr<PendingUpload>& upload : expired)
+				continueUpload(upload, std::string(), RequestSample());
+			lock.lock();
+			continue;
+		}
+
+		if (next == Clock::time_point::max())
+			uploadsChanged.wait(lock);
+		else
+			uploadsChanged.wait_until(lock, next);
+	}
+}
+
+void RequestService::finish(Job& job, const std::string& response, RequestStatus status, const std::string& error) {
+	// Cancelled requests are answered too, transports drop replies to connections that have closed
+	Clock::time_point sendStart = Clock::now();
+	job.reply(response, job.options.encoding, status, job.endConnection);
+	Clock::time_point sent = Clock::now();
+
+	RequestSample& sample = job.sample;
+	sample.stageNanoseconds[STAGE_SEND] = getNanoseconds(sendStart, sent);
+	sample.stageNanoseconds[STAGE_TOTAL] = getNanoseconds(job.received, sent);
+	sample.bytesOut = response.size();
+	sample.failed = status == RequestStatus::Error;
+	sample.rejected = status == RequestStatus::Rejected;
+	sample.cancelled = status == RequestStatus::Cancelled;
+	stats.local().record(sample);
+
+	LogLevel level = status == RequestStatus::Error || status == RequestStatus::Rejected ? LogLevel::Warn : LogLevel::Info;
+	if (!logger.isEnabled(level))
+		return;
+
+	logger.log(
+		level,
+		"event=request conn=%u mode=%s bytes_in=%llu bytes_out=%llu memory_estimate=%llu work_estimate=%llu slices=%u protos=%u instructions=%llu cache_hits=%u cache_misses=%u%s "
+		"decode_us=%.1f queue_us=%.1f deserialize_us=%.1f format_us=%.1f send_us=%.1f total_us=%.1f status=%s%s%s",
+		job.connection->id,
+		LuauDisassembler::getRequestModeName(job.options.mode),
+		(unsigned long long)sample.bytesIn,
+		(unsigned long long)sample.bytesOut,
+		(unsigned long long)job.memoryEstimate,
+		(unsigned long long)job.workEstimate,
+		job.slices,
+		sample.protos,
+		(unsigned long long)sample.instructions,
+		sample.cacheHits,
+		sample.cacheMisses,
+		!job.options.isPaged() ? "" : job.metrics.scriptCacheHit ? " script_cache=hit" : " script_cache=miss",
+		double(sample.stageNanoseconds[STAGE_DECODE]) / 1000,
+		double(sample.stageNanoseconds[STAGE_QUEUE]) / 1000,
+		double(sample.stageNanoseconds[STAGE_DESERIALIZE]) / 1000,
+		double(sample.stageNanoseconds[STAGE_FORMAT]) / 1000,
+		double(sample.stageNanoseconds[STAGE_SEND]) / 1000,
+		double(sample.stageNanoseconds[STAGE_TOTAL]) / 1000,
+		get_request_status_name(status),
+		error.empty() ? "" : " error=",
+		error.empty() ? "" : quote_log_value(error).c_str()
+	);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include "disassembler/options.hpp"
+#include "disassembler/request.hpp"
+#include "config.hpp"
+#include "stats.hpp"
+#include "logger.hpp"
+#include "dispatcher.hpp"
+
+struct ServiceLimits {
+	size_t workerCount = 0; // 0 uses one per hardware thread
+	size_t queueCapacity = DISASSEMBLER_DEFAULT_QUEUE_CAPACITY;
+	uint32_t maxConnectionRequests = DISASSEMBLER_DEFAULT_MAX_CONNECTION_REQUESTS;
+	size_t maxConnectionMemory = DISASSEMBLER_DEFAULT_MAX_CONNECTION_MEMORY;
+	size_t maxTotalMemory = DISASSEMBLER_DEFAULT_MAX_TOTAL_MEMORY;
+	uint32_t maxPriorityDelayMilliseconds = DISASSEMBLER_DEFAULT_MAX_PRIORITY_DELAY_MS;
+	uint64_t sliceInstructions = DISASSEMBLER_DEFAULT_SLICE_INSTRUCTIONS;
+	uint32_t uploadIdleTimeoutMilliseconds = DISASSEMBLER_DEFAULT_UPLOAD_IDLE_TIMEOUT_MS;
+};
+
+struct PendingUpload;
+
+// How a request ended, for transports that report it out of band like HTTP status codes, and for stats and the log
+enum class RequestStatus : uint8_t {
+	Ok,
+	Error, // malformed bytecode or options, or a request over the server's limits
+	Rejected, // the server is overloaded, the same request can succeed later
+	Cancelled,
+};
+
+const char* get_request_status_name(RequestStatus status);
+
+// Admission state of one client connection, shared by the transport and the connection's requests still in flight
+struct ServiceConnection {
+	uint32_t id = 0;
+	std::atomic<bool> closed{ false }; // set by the transport, the connection's requests are cancelled
+
+	std::atomic<uint32_t> inFlightRequests{ 0 };
+	std::atomic<size_t> inFlightMemory{ 0 };
+
+	// A chunked upload still waiting for frames, only touched by the thread submitting the connection's frames
+	std::shared_ptr<PendingUpload> upload;
+};
+
+// Runs requests from any transport: admission control, the worker pool, stats and the per-request log line
+// A transport decodes its framing, then hands the request over with a callback that sends the response back
+class RequestService {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Called exactly once per request, from a worker thread or from the thread that submitted it; a cancelled request gets
+	// a cancellation error, which the transport can drop if its connection is gone. With endConnection, the request was an
+	// upload answered before all of it arrived, so the transport closes the connection once the response is sent
+	using Reply = std::function<void(const std::string& response, LuauDisassembler::ResponseEncoding encoding, RequestStatus status, bool endConnection)>;
+
+	RequestService(const ServiceLimits& limits, const LuauDisassembler::RequestContext& context, ServerStats& stats, Logger& logger);
+	~RequestService();
+
+	RequestService(const RequestService&) = delete;
+	RequestService& operator=(const RequestService&) = delete;
+
+	std::shared_ptr<ServiceConnection> openConnection();
+
+	// Cancels whatever the connection still has in flight, workers stop on it at the next proto
+	void closeConnection(const std::shared_ptr<ServiceConnection>& connection);
+
+	// request is the frame after transport decoding: an optional options envelope followed by bytecode, or the next piece
+	// of a chunked upload. The sample carries what the transport already measured (bytes in, decode time)
+	void submit(const std::shared_ptr<ServiceConnection>& connection, std::string request, Clock::time_point received, RequestSample sample, Reply reply);
+
+	size_t getTotalMemoryInFlight() const { return totalMemory.load(std::memory_order_relaxed); }
+
+private:
+	struct Job;
+	friend struct PendingUpload;
+
+	ServiceLimits limits;
+	LuauDisassembler::RequestContext context;
+	ServerStats& stats;
+	Logger& logger;
+
+	std::atomic<uint32_t> nextConnectionId{ 0 };
+	std::atomic<size_t> totalMemory{ 0 };
+
+	// Uploads still waiting for pieces. A piece may never come, so the upload timer answers those that stall or pass their
+	// deadline instead of leaving them to hold their admission until the connection closes
+	std::mutex uploadsMutex;
+	std::condition_variable uploadsChanged;
+	std::vector<std::weak_ptr<PendingUpload>> uploads;
+	bool stopping = false;
+	std::thread uploadTimer;
+
+	// Declared last so the workers stop before anything they use is destroyed
+	Dispatcher dispatcher;
+
+	bool admit(Job& job);
+	void release(Job& job);
+	Clock::time_point getDeadline(Clock::time_point enqueued, uint64_t work) const;
+	void run(const std::shared_ptr<Job>& job);
+	void startUpload(const std::shared_ptr<ServiceConnection>& connection, const std::shared_ptr<Job>& job);
+	void continueUpload(const std::shared_ptr<PendingUpload>& upload, std::string piece, const RequestSample& sample);
+	void drainUpload(const std::shared_ptr<PendingUpload>& upload);
+	void timeUploads();
+	void finish(Job& job, const std::string& response, RequestStatus status, const std::string& error);
+};
\ No newline at end of file
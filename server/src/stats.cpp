@@ -0,0 +1,113 @@
+#include <cstdio>
+
+#include "stats.hpp"
+
+static thread_local WorkerStats* threadStats = nullptr;
+
+static const char* STAGE_NAMES[STAGE_COUNT] = { "decode", "queue", "deserialize", "format", "send", "total" };
+
+void WorkerStats::record(const RequestSample& sample) {
+	// A stage the request never went through (no decode for binary frames, no deserialize for stats) isn't a zero sample
+	for (int stage = 0; stage < STAGE_COUNT; stage++) {
+		if (sample.stageNanoseconds[stage])
+			stages[stage].record(sample.stageNanoseconds[stage]);
+	}
+
+	StageHistogram::increment(requests, 1);
+	StageHistogram::increment(errors, sample.failed);
+	StageHistogram::increment(rejected, sample.rejected);
+	StageHistogram::increment(cancelled, sample.cancelled);
+	StageHistogram::increment(bytesIn, sample.bytesIn);
+	StageHistogram::increment(bytesOut, sample.bytesOut);
+	StageHistogram::increment(protos, sample.protos);
+	StageHistogram::increment(instructions, sample.instructions);
+	StageHistogram::increment(allocations, sample.allocations);
+	StageHistogram::increment(cacheHits, sample.cacheHits);
+	StageHistogram::increment(cacheMisses, sample.cacheMisses);
+}
+
+ServerStats::ServerStats() : startTime(std::chrono::steady_clock::now()) {}
+
+WorkerStats& ServerStats::local() {
+	if (!threadStats) {
+		std::lock_guard<std::mutex> lock(workersMutex);
+		workers.push_back(std::make_unique<WorkerStats>());
+		threadStats = workers.back().get();
+	}
+	return *threadStats;
+}
+
+std::string ServerStats::format(bool json) {
+	LatencyHistogram stages[STAGE_COUNT];
+	uint64_t stageSums[STAGE_COUNT] = {};
+	uint64_t requests = 0, errors = 0, rejected = 0, cancelled = 0, bytesIn = 0, bytesOut = 0, protos = 0, instructions = 0, allocations = 0, cacheHits = 0, cacheMisses = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(workersMutex);
+		for (const std::unique_ptr<WorkerStats>& worker : workers) {
+			for (int stage = 0; stage < STAGE_COUNT; stage++)
+				worker->stages[stage].mergeInto(stages[stage], stageSums[stage]);
+
+			requests += worker->requests.load(std::memory_order_relaxed);
+			errors += worker->errors.load(std::memory_order_relaxed);
+			rejected += worker->rejected.load(std::memory_order_relaxed);
+			cancelled += worker->cancelled.load(std::memory_order_relaxed);
+			bytesIn += worker->bytesIn.load(std::memory_order_relaxed);
+			bytesOut += worker->bytesOut.load(std::memory_order_relaxed);
+			protos += worker->protos.load(std::memory_order_relaxed);
+			instructions += worker->instructions.load(std::memory_order_relaxed);
+			allocations += worker->allocations.load(std::memory_order_relaxed);
+			cacheHits += worker->cacheHits.load(std::memory_order_relaxed);
+			cacheMisses += worker->cacheMisses.load(std::memory_order_relaxed);
+		}
+	}
+
+	double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::string output;
+	char buf[512];
+
+	if (json) {
+		snprintf(
+			buf, sizeof(buf),
+			"{\"uptime\":%.3f,\"requests\":%llu,\"errors\":%llu,\"rejected\":%llu,\"cancelled\":%llu,\"bytesIn\":%llu,\"bytesOut\":%llu,\"protos\":%llu,\"instructions\":%llu,\"allocations\":%llu,\"cacheHits\":%llu,\"cacheMisses\":%llu,\"stages\":{",
+			uptime, (unsigned long long)requests, (unsigned long long)errors, (unsigned long long)rejected, (unsigned long long)cancelled, (unsigned long long)bytesIn, (unsigned long long)bytesOut,
+			(unsigned long long)protos, (unsigned long long)instructions, (unsigned long long)allocations, (unsigned long long)cacheHits, (unsigned long long)cacheMisses
+		);
+		output += buf;
+	} else {
+		snprintf(
+			buf, sizeof(buf),
+			"; uptime %.3f s, %llu requests, %llu errors, %llu rejected, %llu cancelled, %llu bytes in, %llu bytes out, %llu protos, %llu instructions, %llu allocations, %llu/%llu proto cache hits\n",
+			uptime, (unsigned long long)requests, (unsigned long long)errors, (unsigned long long)rejected, (unsigned long long)cancelled, (unsigned long long)bytesIn, (unsigned long long)bytesOut,
+			(unsigned long long)protos, (unsigned long long)instructions, (unsigned long long)allocations,
+			(unsigned long long)cacheHits, (unsigned long long)(cacheHits + cacheMisses)
+		);
+		output += buf;
+		output += "; stage            count     mean us      p50 us      p90 us      p99 us      max us\n";
+	}
+
+	// Stage times are recorded in nanoseconds and reported in microseconds
+	for (int stage = 0; stage < STAGE_COUNT; stage++) {
+		const LatencyHistogram& histogram = stages[stage];
+		double mean = histogram.getCount() ? double(stageSums[stage]) / double(histogram.getCount()) / 1000 : 0;
+
+		snprintf(
+			buf, sizeof(buf),
+			json ? "%s\"%s\":{\"count\":%llu,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}" : "%s%-12s %10llu %11.3f %11.3f %11.3f %11.3f %11.3f\n",
+			json ? (stage ? "," : "") : "; ",
+			STAGE_NAMES[stage],
+			(unsigned long long)histogram.getCount(),
+			mean,
+			double(histogram.getPercentile(50)) / 1000,
+			double(histogram.getPercentile(90)) / 1000,
+			double(histogram.getPercentile(99)) / 1000,
+			double(histogram.getMax()) / 1000
+		);
+		output += buf;
+	}
+
+	if (json)
+		output += "}}";
+
+	return output;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "histogram.hpp"
+
+enum RequestStage : uint8_t {
+	STAGE_DECODE, // Base64 decoding of text frames
+	STAGE_QUEUE, // waiting for a worker
+	STAGE_DESERIALIZE,
+	STAGE_FORMAT,
+	STAGE_SEND,
+	STAGE_TOTAL,
+	STAGE_COUNT,
+};
+
+// What one request cost, handed to WorkerStats::record once it has been sent
+struct RequestSample {
+	uint64_t stageNanoseconds[STAGE_COUNT] = {};
+	uint64_t bytesIn = 0;
+	uint64_t bytesOut = 0;
+	uint32_t protos = 0;
+	uint64_t instructions = 0;
+	uint64_t allocations = 0;
+	uint32_t cacheHits = 0;
+	uint32_t cacheMisses = 0;
+	bool failed = false;
+	bool rejected = false; // refused by admission control
+	bool cancelled = false; // dropped because the client disconnected
+};
+
+// Histogram with one writing thread that others can read at any time
+// The writer doesn't need atomic read-modify-writes since nobody else writes, relaxed loads and stores keep readers race free
+class StageHistogram {
+public:
+	void record(uint64_t value) {
+		increment(counts[LatencyHistogram::getBucketIndex(value)], 1);
+		increment(sum, value);
+	}
+
+	void mergeInto(LatencyHistogram& histogram, uint64_t& total) const {
+		for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+			if (uint64_t count = counts[i].load(std::memory_order_relaxed))
+				histogram.record(LatencyHistogram::getBucketValue(i), count);
+		}
+		total += sum.load(std::memory_order_relaxed);
+	}
+
+	static void increment(std::atomic<uint64_t>& counter, uint64_t amount) {
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> counts[LatencyHistogram::BUCKET_COUNT] = {};
+	std::atomic<uint64_t> sum{ 0 };
+};
+
+// Statistics of one thread, only ever written by that thread
+struct WorkerStats {
+	StageHistogram stages[STAGE_COUNT];
+
+	std::atomic<uint64_t> requests{ 0 };
+	std::atomic<uint64_t> errors{ 0 };
+	std::atomic<uint64_t> rejected{ 0 };
+	std::atomic<uint64_t> cancelled{ 0 };
+	std::atomic<uint64_t> bytesIn{ 0 };
+	std::atomic<uint64_t> bytesOut{ 0 };
+	std::atomic<uint64_t> protos{ 0 };
+	std::atomic<uint64_t> instructions{ 0 };
+	std::atomic<uint64_t> allocations{ 0 };
+	std::atomic<uint64_t> cacheHits{ 0 };
+	std::atomic<uint64_t> cacheMisses{ 0 };
+
+	void record(const RequestSample& sample);
+};
+
+// Request statistics of the whole server, each thread records into its own WorkerStats so recording never takes a lock
+// Only one ServerStats may exist per process, since the current thread's WorkerStats is found through a thread_local
+class ServerStats {
+public:
+	ServerStats();
+
+	// The calling thread's stats, registered on first use
+	WorkerStats& local();
+
+	// Merges every thread's stats into a report, as JSON or as text
+	std::string format(bool json);
+
+private:
+	std::chrono::steady_clock::time_point startTime;
+
+	std::mutex workersMutex; // only guards registration and reports
+	std::vector<std::unique_ptr<WorkerStats>> workers;
+};
+
+// Number of allocations made by the calling thread so far, the server counts them by replacing operator new
+uint64_t get_thread_allocations();
\ No newline at end of file
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+#include "disassembler/bytecode.hpp"
+
+// Writes version 2 bytecode for the tests, remembering where each section ends so they can split it exactly there
+struct BytecodeWriter {
+	std::string data;
+	std::vector<size_t> sectionEnds; // header, every string, proto count, every proto, main id
+	std::vector<size_t> protoEnds;
+
+	void u8(uint8_t value) {
+		data += char(value);
+	}
+
+	void u32(uint32_t value) {
+		data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void f64(double value) {
+		data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void leb128(uint32_t value) {
+		do {
+			uint8_t byte = value & 127;
+			value >>= 7;
+			if (value)
+				byte |= 128;
+			data += char(byte);
+		} while (value);
+	}
+
+	void endSection() {
+		sectionEnds.push_back(data.size());
+	}
+
+	void endProto() {
+		protoEnds.push_back(data.size());
+		endSection();
+	}
+};
+
+inline uint32_t encode_abc(uint8_t op, uint8_t a, uint8_t b, uint8_t c) {
+	return op | (uint32_t(a) << 8) | (uint32_t(b) << 16) | (uint32_t(c) << 24);
+}
+
+inline uint32_t encode_ad(uint8_t op, uint8_t a, int16_t d) {
+	return op | (uint32_t(a) << 8) | (uint32_t(uint16_t(d)) << 16);
+}
+
+// An import path of up to 3 constants
+inline uint32_t encode_import(uint32_t count, uint32_t id0, uint32_t id1 = 0, uint32_t id2 = 0) {
+	return (count << 30) | (id0 << 20) | (id1 << 10) | id2;
+}
+
+struct TestConstant {
+	uint8_t type = 0; // as written: 0 nil, 2 number, 3 string, 4 import
+	uint32_t value = 0; // string id or import id
+	double number = 0;
+};
+
+inline TestConstant string_constant(uint32_t stringId) {
+	return { 3, stringId, 0 };
+}
+
+inline TestConstant import_constant(uint32_t importId) {
+	return { 4, importId, 0 };
+}
+
+inline TestConstant number_constant(double number) {
+	return { 2, 0, number };
+}
+
+struct TestProto {
+	uint8_t maxstacksize = 2;
+	uint8_t numparams = 0;
+	uint8_t isVararg = 0;
+	std::vector<uint32_t> code;
+	std::vector<TestConstant> constants;
+	std::vector<uint32_t> children; // global ids
+	uint32_t linedefined = 0;
+	uint32_t debugname = 0; // string id, 0 for none
+	bool lineInfo = false; // instruction i on line linedefined + i / 2
+};
+
+// Strings are numbered from 1 as constants refer to them, protos are written in order so children have to come first
+inline BytecodeWriter write_script(const std::vector<std::string>& strings, const std::vector<TestProto>& protos, uint32_t mainProto) {
+	BytecodeWriter w;
+
+	w.u8(2);
+	w.leb128(uint32_t(strings.size()));
+	w.endSection();
+
+	for (const std::string& s : strings) {
+		w.leb128(uint32_t(s.size()));
+		w.data += s;
+		w.endSection();
+	}
+
+	w.leb128(uint32_t(protos.size()));
+	w.endSection();
+
+	for (const TestProto& p : protos) {
+		w.u8(p.maxstacksize);
+		w.u8(p.numparams);
+		w.u8(0); // nups
+		w.u8(p.isVararg);
+
+		w.leb128(uint32_t(p.code.size()));
+		for (uint32_t insn : p.code)
+			w.u32(insn);
+
+		w.leb128(uint32_t(p.constants.size()));
+		for (const TestConstant& k : p.constants) {
+			w.u8(k.type);
+			if (k.type == 2)
+				w.f64(k.number);
+			else if (k.type == 3)
+				w.leb128(k.value);
+			else if (k.type == 4)
+				w.u32(k.value);
+		}
+
+		w.leb128(uint32_t(p.children.size()));
+		for (uint32_t child : p.children)
+			w.leb128(child);
+
+		w.leb128(p.linedefined);
+		w.leb128(p.debugname);
+
+		w.u8(p.lineInfo);
+		if (p.lineInfo) {
+			// Intervals of 2 instructions, each starting a line after the last
+			w.u8(1);
+			for (size_t i = 0; i < p.code.size(); i++)
+				w.u8(i % 2);
+			for (size_t i = 0; i < ((p.code.size() - 1) >> 1) + 1; i++)
+				w.u32(i == 0 ? p.linedefined : 0);
+		}
+
+		w.u8(0); // debug info
+		w.endProto();
+	}
+
+	w.leb128(mainProto);
+	w.endSection();
+
+	return w;
+}
+
+// A child calling print(text) from string textString, strings 1 and 2 being "print" and "child"
+inline TestProto make_print_proto(uint32_t textString, uint32_t linedefined) {
+	TestProto p;
+	p.code = {
+		encode_ad(LOP_GETIMPORT, 0, 1),
+		encode_import(1, 0),
+		encode_ad(LOP_LOADK, 1, 2),
+		encode_abc(LOP_CALL, 0, 2, 1),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	};
+	p.constants = { string_constant(1), import_constant(encode_import(1, 0)), string_constant(textString) };
+	p.linedefined = linedefined;
+	p.debugname = 2;
+	p.lineInfo = true;
+	return p;
+}
+
+// A vararg main proto creating and calling each of its children in turn, string 3 being "main"
+inline TestProto make_main_proto(uint32_t childCount, uint32_t firstChild = 0) {
+	TestProto p;
+	p.isVararg = 1;
+	p.code.push_back(encode_abc(LOP_PREPVARARGS, 0, 0, 0));
+	for (uint32_t i = 0; i < childCount; i++) {
+		p.code.push_back(encode_ad(LOP_NEWCLOSURE, 0, int16_t(i)));
+		p.code.push_back(encode_abc(LOP_CALL, 0, 1, 1));
+		p.children.push_back(firstChild + i);
+	}
+	p.code.push_back(encode_abc(LOP_RETURN, 0, 1, 0));
+	p.debugname = 3;
+	return p;
+}
+
+// A small script covering every section: a child proto calling print("hello") with line info, and a vararg main proto
+// creating it, reading game.Workspace and calling the child
+//   local function child() print("hello") end
+//   local _ = game.Workspace
+//   child()
+inline BytecodeWriter make_test_script() {
+	TestProto main;
+	main.isVararg = 1;
+	main.code = {
+		encode_abc(LOP_PREPVARARGS, 0, 0, 0),
+		encode_ad(LOP_NEWCLOSURE, 0, 0),
+		encode_ad(LOP_GETIMPORT, 1, 2),
+		encode_import(2, 0, 1),
+		encode_abc(LOP_CALL, 0, 1, 1),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	};
+	main.constants = { string_constant(4), string_constant(5), import_constant(encode_import(2, 0, 1)) };
+	main.children = { 0 };
+	main.debugname = 3;
+
+	return write_script({ "print", "child", "main", "game", "Workspace", "hello" }, { make_print_proto(6, 1), main }, 1);
+}
+
+// One field of an options envelope: the tag, the payload's length and the payload
+inline std::string option_field(uint8_t tag, const std::string& payload) {
+	BytecodeWriter w;
+	w.u8(tag);
+	w.leb128(uint32_t(payload.size()));
+	w.data += payload;
+	return w.data;
+}
+
+inline std::string leb128_payload(std::initializer_list<uint32_t> values) {
+	BytecodeWriter w;
+	for (uint32_t value : values)
+		w.leb128(value);
+	return w.data;
+}
+
+// A request frame: the options envelope with the fields, then the bytecode
+inline std::string make_request(const std::string& fields, const std::string& bytecode) {
+	return std::string("LDOP") + fields + '\0' + bytecode;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <vector>
+
+#include "disassembler/cfg.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for build_cfg: where blocks start and end, and the edges between them
+
+struct ExpectedBlock {
+	uint32_t startpc;
+	uint32_t endpc;
+	uint32_t terminatorpc;
+	std::vector<uint32_t> successors;
+	std::vector<uint32_t> predecessors;
+};
+
+static void check_cfg(const std::vector<uint32_t>& code, const std::vector<ExpectedBlock>& expected) {
+	Proto proto;
+	proto.code = code;
+
+	ControlFlowGraph cfg = build_cfg(&proto);
+	CHECK(cfg.blocks.size() == expected.size());
+	if (cfg.blocks.size() != expected.size())
+		return;
+
+	for (size_t b = 0; b < expected.size(); b++) {
+		const BasicBlock& block = cfg.blocks[b];
+		CHECK(block.startpc == expected[b].startpc);
+		CHECK(block.endpc == expected[b].endpc);
+		CHECK(block.terminatorpc == expected[b].terminatorpc);
+
+		std::vector<uint32_t> successors(cfg.successors.begin() + block.successorOffset, cfg.successors.begin() + block.successorOffset + block.successorCount);
+		std::vector<uint32_t> predecessors(cfg.predecessors.begin() + block.predecessorOffset, cfg.predecessors.begin() + block.predecessorOffset + block.predecessorCount);
+		CHECK(successors == expected[b].successors);
+		CHECK(predecessors == expected[b].predecessors);
+
+		for (uint32_t pc = block.startpc; pc < block.endpc; pc++)
+			CHECK(cfg.blockForPc(pc) == b);
+	}
+}
+
+static void test_if_else() {
+	//   local a = 1
+	//   if a then b = 1 else b = 2 end
+	//   return b
+	check_cfg({
+		encode_ad(LOP_LOADN, 0, 1),
+		encode_ad(LOP_JUMPIFNOT, 0, 2), // to 4
+		encode_ad(LOP_LOADN, 1, 1),
+		encode_ad(LOP_JUMP, 0, 1), // to 5
+		encode_ad(LOP_LOADN, 1, 2),
+		encode_abc(LOP_RETURN, 1, 2, 0),
+	}, {
+		{ 0, 2, 1, { 2, 1 }, {} },
+		{ 2, 4, 3, { 3 }, { 0 } },
+		{ 4, 5, 4, { 3 }, { 0 } },
+		{ 5, 6, 5, {}, { 1, 2 } },
+	});
+}
+
+static void test_numeric_loop() {
+	// for i = 1, 10 do local _ = game end, the loop body holding an instruction with an AUX word
+	check_cfg({
+		encode_ad(LOP_LOADN, 0, 1),
+		encode_ad(LOP_LOADN, 1, 10),
+		encode_ad(LOP_LOADN, 2, 1),
+		encode_ad(LOP_FORNPREP, 0, 3), // to 7, skipping an empty loop
+		encode_ad(LOP_GETIMPORT, 3, 0),
+		encode_import(1, 0),
+		encode_ad(LOP_FORNLOOP, 0, -3), // back to 4
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	}, {
+		{ 0, 4, 3, { 2, 1 }, {} },
+		{ 4, 7, 6, { 1, 2 }, { 0, 1 } },
+		{ 7, 8, 7, {}, { 0, 1 } },
+	});
+}
+
+static void test_loadb_skip() {
+	// A LOADB with a skip count jumps over the next instruction, like the other branches it ends its block
+	check_cfg({
+		encode_ad(LOP_JUMPIF, 0, 2), // to 3
+		encode_abc(LOP_LOADB, 1, 0, 1), // to 3
+		encode_abc(LOP_LOADB, 1, 1, 0),
+		encode_abc(LOP_RETURN, 1, 2, 0),
+	}, {
+		{ 0, 1, 0, { 3, 1 }, {} },
+		{ 1, 2, 1, { 3 }, { 0 } },
+		{ 2, 3, 2, { 3 }, {} },
+		{ 3, 4, 3, {}, { 0, 1, 2 } },
+	});
+}
+
+static void test_edge_cases() {
+	// No code, no blocks
+	check_cfg({}, {});
+
+	// A branch to the next instruction has a single edge
+	check_cfg({
+		encode_ad(LOP_JUMPIFNOT, 0, 0),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	}, {
+		{ 0, 1, 0, { 1 }, {} },
+		{ 1, 2, 1, {}, { 0 } },
+	});
+
+	// A jump past the end of the code has no edge, and code after a return starts a block
+	check_cfg({
+		encode_ad(LOP_JUMP, 0, 100),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	}, {
+		{ 0, 1, 0, {}, {} },
+		{ 1, 2, 1, {}, {} },
+		{ 2, 3, 2, {}, {} },
+	});
+
+	// JUMPBACK closing a while loop
+	check_cfg({
+		encode_ad(LOP_JUMPIFNOT, 0, 2), // to 3
+		encode_ad(LOP_LOADN, 1, 1),
+		encode_ad(LOP_JUMPBACK, 0, -3), // to 0
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	}, {
+		{ 0, 1, 0, { 2, 1 }, { 1 } },
+		{ 1, 3, 2, { 0 }, { 0 } },
+		{ 3, 4, 3, {}, { 0 } },
+	});
+}
+
+int main() {
+	test_if_else();
+	test_numeric_loop();
+	test_loadb_skip();
+	test_edge_cases();
+
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+#include <stdexcept>
+
+// The tests are plain executables run by ctest: a failed check is printed and counted, and main returns the count
+
+inline int checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+// True if f throws std::runtime_error, the library's error for malformed input
+template<typename F>
+bool throws_runtime_error(F f) {
+	try {
+		f();
+	}
+	catch (const std::runtime_error&) {
+		return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "disassembler/diff.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for diff mode: edit scripts of diff_sequences, and how diff_bytecode matches protos between versions
+
+// Checks that the edits turn a into b, returns how many aren't Equal (or -1 if they don't)
+static int check_edit_script(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, const std::vector<Edit>& edits) {
+	uint32_t i = 0;
+	uint32_t j = 0;
+	int changes = 0;
+
+	for (const Edit& edit : edits) {
+		switch (edit.op) {
+		case EditOp::Equal: {
+			if (edit.oldIndex != i || edit.newIndex != j || i >= a.size() || j >= b.size() || a[i] != b[j])
+				return -1;
+			i++;
+			j++;
+			break;
+		}
+		case EditOp::Delete: {
+			if (edit.oldIndex != i || i >= a.size())
+				return -1;
+			i++;
+			changes++;
+			break;
+		}
+		case EditOp::Insert: {
+			if (edit.newIndex != j || j >= b.size())
+				return -1;
+			j++;
+			changes++;
+			break;
+		}
+		}
+	}
+
+	return i == a.size() && j == b.size() ? changes : -1;
+}
+
+static void test_sequences() {
+	std::vector<uint64_t> a = { 1, 2, 3, 4, 5 };
+
+	// Identical
+	std::vector<Edit> edits = diff_sequences(a, a);
+	CHECK(edits.size() == a.size());
+	CHECK(check_edit_script(a, a, edits) == 0);
+
+	// Insert only, in the middle and at both ends
+	std::vector<uint64_t> inserted = { 0, 1, 2, 9, 3, 4, 5, 6 };
+	edits = diff_sequences(a, inserted);
+	CHECK(check_edit_script(a, inserted, edits) == 3);
+
+	// Delete only
+	std::vector<uint64_t> deleted = { 2, 4 };
+	edits = diff_sequences(a, deleted);
+	CHECK(check_edit_script(a, deleted, edits) == 3);
+
+	// Empty sides
+	edits = diff_sequences({}, a);
+	CHECK(check_edit_script({}, a, edits) == 5);
+	edits = diff_sequences(a, {});
+	CHECK(check_edit_script(a, {}, edits) == 5);
+	CHECK(diff_sequences({}, {}).empty());
+
+	// Myers' example, ABCABBA to CBABAC, takes 5 edits
+	std::vector<uint64_t> abcabba = { 'A', 'B', 'C', 'A', 'B', 'B', 'A' };
+	std::vector<uint64_t> cbabac = { 'C', 'B', 'A', 'B', 'A', 'C' };
+	edits = diff_sequences(abcabba, cbabac);
+	CHECK(check_edit_script(abcabba, cbabac, edits) == 5);
+
+	// Over maxEdits the differing middle is replaced wholesale, the common head and tail still match
+	std::vector<uint64_t> x = { 7, 1, 2, 3, 4, 8 };
+	std::vector<uint64_t> y = { 7, 4, 3, 2, 1, 8 };
+	edits = diff_sequences(x, y, 2);
+	CHECK(check_edit_script(x, y, edits) == 8);
+	CHECK(edits.size() == 10);
+	CHECK(edits.front().op == EditOp::Equal && edits.back().op == EditOp::Equal);
+	for (size_t i = 1; i < 5; i++)
+		CHECK(edits[i].op == EditOp::Delete);
+	for (size_t i = 5; i < 9; i++)
+		CHECK(edits[i].op == EditOp::Insert);
+
+	// Within maxEdits the same sequences are aligned
+	edits = diff_sequences(x, y);
+	CHECK(check_edit_script(x, y, edits) == 6);
+}
+
+static const std::vector<std::string> strings = { "print", "child", "main", "hello", "bye", "renamed", "HELLO" };
+
+static std::string diff_scripts(const BytecodeWriter& oldScript, const BytecodeWriter& newScript) {
+	return diff_bytecode(oldScript.data.data(), oldScript.data.size(), newScript.data.data(), newScript.data.size(), DisassemblyOptions());
+}
+
+static bool starts_with(const std::string& text, const std::string& prefix) {
+	return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+static void test_protos() {
+	// Two children, print("hello") and print("bye"), and main calling both
+	BytecodeWriter base = write_script(strings, { make_print_proto(4, 1), make_print_proto(5, 2), make_main_proto(2) }, 2);
+
+	CHECK(starts_with(diff_scripts(base, base), "; diff: 3 unchanged, 0 changed, 0 added, 0 removed\n"));
+
+	// Children written in the other order, main still creates them in the same order: nothing changed
+	TestProto swappedMain = make_main_proto(2);
+	swappedMain.children = { 1, 0 };
+	BytecodeWriter moved = write_script(strings, { make_print_proto(5, 2), make_print_proto(4, 1), swappedMain }, 2);
+	CHECK(starts_with(diff_scripts(base, moved), "; diff: 3 unchanged, 0 changed, 0 added, 0 removed\n"));
+
+	// A renamed child with the same code is still matched to its old version
+	TestProto renamed = make_print_proto(5, 2);
+	renamed.debugname = 6;
+	BytecodeWriter renamedScript = write_script(strings, { make_print_proto(4, 1), renamed, make_main_proto(2) }, 2);
+	CHECK(starts_with(diff_scripts(base, renamedScript), "; diff: 3 unchanged, 0 changed, 0 added, 0 removed\n"));
+
+	// A changed closure is listed on its own, the main proto creating it isn't marked changed
+	BytecodeWriter changed = write_script(strings, { make_print_proto(7, 1), make_print_proto(5, 2), make_main_proto(2) }, 2);
+	std::string output = diff_scripts(base, changed);
+	CHECK(starts_with(output, "; diff: 2 unchanged, 1 changed, 0 added, 0 removed\n"));
+	CHECK(output.find("; changed proto 0 -> 0: child") != std::string::npos);
+	CHECK(output.find("HELLO") != std::string::npos);
+
+	// A child added, and one removed
+	BytecodeWriter added = write_script(strings, { make_print_proto(4, 1), make_print_proto(5, 2), make_print_proto(7, 3), make_main_proto(3) }, 3);
+	// The main proto now creates three closures, so it changed too
+	output = diff_scripts(base, added);
+	CHECK(starts_with(output, "; diff: 2 unchanged, 1 changed, 1 added, 0 removed\n"));
+	CHECK(output.find("; changed proto 2 -> 3: main") != std::string::npos);
+	CHECK(output.find("; added proto 2: child") != std::string::npos);
+
+	output = diff_scripts(added, base);
+	CHECK(starts_with(output, "; diff: 2 unchanged, 1 changed, 0 added, 1 removed\n"));
+	CHECK(output.find("; removed proto 2: child") != std::string::npos);
+}
+
+int main() {
+	test_sequences();
+	test_protos();
+
+	return checkFailures ? 1 : 0;
+}
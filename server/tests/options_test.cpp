@@ -0,0 +1,170 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "disassembler/options.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for the options envelope and page cursors, as parse_options reads them off request frames
+
+static size_t parse(const std::string& frame, DisassemblyOptions& options) {
+	return parse_options(frame.data(), frame.size(), options);
+}
+
+static void test_plain_bytecode() {
+	std::string bytecode = make_test_script().data;
+
+	DisassemblyOptions options;
+	CHECK(parse(bytecode, options) == 0);
+	CHECK(options.mode == RequestMode::Disassemble);
+	CHECK(!options.displayLineInfo);
+	CHECK(options.format == OutputFormat::Text);
+	CHECK(!options.hasProtoFilter());
+	CHECK(!options.isPaged());
+}
+
+static void test_fields() {
+	std::string fields =
+		option_field(OPTION_LINE_INFO, "\x01") +
+		option_field(OPTION_OUTPUT_FORMAT, "\x01") +
+		option_field(OPTION_PROTO_IDS, leb128_payload({ 5, 1, 3, 300, 5 })) +
+		option_field(OPTION_PROTO_NAME, "on*") +
+		option_field(OPTION_MAX_OUTPUT_BYTES, leb128_payload({ 1000 })) +
+		option_field(OPTION_ENCODING, "\x02") +
+		option_field(OPTION_BLOCKS, "\x01") +
+		option_field(OPTION_MODE, "\x01") +
+		option_field(OPTION_REFERENCE_QUERY, "game.*") +
+		option_field(OPTION_REFERENCE_QUERY, ":Kick") +
+		option_field(OPTION_DIFF_BASE_SIZE, leb128_payload({ 12345 })) +
+		option_field(OPTION_DEADLINE_MS, leb128_payload({ 250 })) +
+		option_field(OPTION_UPLOAD_SIZE, leb128_payload({ 1 << 20 })) +
+		option_field(OPTION_PROTO_RANGE, leb128_payload({ 2, 3 })) +
+		option_field(OPTION_CALL_NOTES, "\x01") +
+		option_field(OPTION_SCRIPT_NAME, "script") +
+		option_field(OPTION_CONSTANT_PROTOS, "\x01") +
+		option_field(OPTION_SIGNATURE_MATCHES, "\x01") +
+		option_field(0x7F, "skipped by older servers");
+
+	std::string bytecode = make_test_script().data;
+	std::string frame = make_request(fields, bytecode);
+
+	DisassemblyOptions options;
+	CHECK(parse(frame, options) == frame.size() - bytecode.size());
+	CHECK(options.displayLineInfo);
+	CHECK(options.format == OutputFormat::Json);
+	CHECK((options.protoIds == std::vector<uint32_t>{ 1, 3, 5, 300 }));
+	CHECK(options.protoNameGlob == "on*");
+	CHECK(options.maxOutputBytes == 1000);
+	CHECK(options.encoding == ResponseEncoding::Base64);
+	CHECK(options.showBlocks);
+	CHECK(options.mode == RequestMode::References);
+	CHECK((options.referenceQueries == std::vector<std::string>{ "game.*", ":Kick" }));
+	CHECK(options.diffBaseSize == 12345);
+	CHECK(options.deadlineMilliseconds == 250);
+	CHECK(options.uploadSize == size_t(1) << 20);
+	CHECK(options.firstProto == 2);
+	CHECK(options.lastProto == 5);
+	CHECK(options.annotateCalls);
+	CHECK(options.scriptName == "script");
+	CHECK(options.listConstantProtos);
+	CHECK(options.matchSignatures);
+
+	// Every filter has to agree
+	CHECK(options.wantsProto(3, "one"));
+	CHECK(!options.wantsProto(3, "two"));
+	CHECK(!options.wantsProto(1, "one"));
+	CHECK(!options.wantsProto(5, "one"));
+	CHECK(!options.wantsProto(300, "one"));
+
+	// A range without a count goes to the end
+	DisassemblyOptions open;
+	parse(make_request(option_field(OPTION_PROTO_RANGE, leb128_payload({ 4, 0 })), bytecode), open);
+	CHECK(open.firstProto == 4);
+	CHECK(open.lastProto == UINT32_MAX);
+}
+
+static void test_malformed() {
+	std::string bytecode = make_test_script().data;
+	const std::vector<std::string> frames = {
+		std::string("LDOP"), // no end
+		std::string("LDOP") + option_field(OPTION_LINE_INFO, "\x01"), // no end
+		std::string("LDOP\x03\x05\x01", 7), // payload past the end
+		std::string("LDOP\x05\xff\xff", 7), // length never ends
+		make_request(option_field(OPTION_MAX_OUTPUT_BYTES, "\x80"), bytecode), // LEB128 payload never ends
+		make_request(option_field(OPTION_OUTPUT_FORMAT, "\x02"), bytecode),
+		make_request(option_field(OPTION_OUTPUT_FORMAT, ""), bytecode),
+		make_request(option_field(OPTION_ENCODING, "\x03"), bytecode),
+		make_request(option_field(OPTION_MODE, "\x08"), bytecode),
+	};
+
+	for (const std::string& frame : frames) {
+		DisassemblyOptions options;
+		CHECK(throws_runtime_error([&] { parse(frame, options); }));
+	}
+}
+
+static void test_cursors() {
+	std::string bytecode = make_test_script().data;
+
+	DisassemblyOptions page;
+	page.lastProto = 40;
+	page.pageBytes = 4096;
+	std::string cursor = encode_cursor(0x0123456789abcdefull, 17, page);
+
+	// The cursor's range and page size win over the fields, wherever it is in the envelope
+	std::string fields = option_field(OPTION_CURSOR, cursor) + option_field(OPTION_PROTO_RANGE, leb128_payload({ 0, 5 })) + option_field(OPTION_PAGE_BYTES, leb128_payload({ 100 }));
+
+	DisassemblyOptions options;
+	parse(make_request(fields, bytecode), options);
+	CHECK(options.hasCursor);
+	CHECK(options.isPaged());
+	CHECK(options.cursorScript == 0x0123456789abcdefull);
+	CHECK(options.firstProto == 17);
+	CHECK(options.lastProto == 40);
+	CHECK(options.pageBytes == 4096);
+
+	// The cursor alone, without bytecode
+	DisassemblyOptions alone;
+	std::string frame = make_request(option_field(OPTION_CURSOR, cursor), "");
+	CHECK(parse(frame, alone) == frame.size());
+	CHECK(alone.hasCursor);
+
+	const std::vector<std::string> invalid = {
+		"",
+		"zz",
+		cursor + "!",
+		cursor.substr(0, cursor.size() - 1) + "x",
+		"0123456789abcdef.40.40.4096", // nothing left to page
+		"0123456789abcdef.17.40", // no page size
+	};
+
+	for (const std::string& text : invalid) {
+		DisassemblyOptions invalidOptions;
+		CHECK(throws_runtime_error([&] { parse(make_request(option_field(OPTION_CURSOR, text), bytecode), invalidOptions); }));
+	}
+}
+
+static void test_globs() {
+	CHECK(glob_match("*", ""));
+	CHECK(glob_match("on*", "onClick"));
+	CHECK(!glob_match("on*", "Click"));
+	CHECK(glob_match("?et*Service", "GetService"));
+	CHECK(glob_match("*a*b*c", "xxaxxbxxc"));
+	CHECK(!glob_match("*a*b*c", "xxaxxcxxb"));
+	CHECK(glob_match("a*", "a"));
+	CHECK(!glob_match("a?", "a"));
+}
+
+int main() {
+	test_plain_bytecode();
+	test_fields();
+	test_malformed();
+	test_cursors();
+	test_globs();
+
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "disassembler/options.hpp"
+#include "disassembler/request.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for paged disassembly: the pages joined back together are the whole output, and pages after the
+// first can send only their cursor, being served from the script cache
+
+static const std::vector<std::string> STRINGS = { "print", "child", "main", "hello", "world" };
+
+// Eight children printing hello or world, and the main proto calling them
+static std::string make_paged_script() {
+	std::vector<TestProto> protos;
+	for (uint32_t i = 0; i < 8; i++)
+		protos.push_back(make_print_proto(4 + i % 2, i + 1));
+	protos.push_back(make_main_proto(8));
+
+	return write_script(STRINGS, protos, 8).data;
+}
+
+// Runs a request a few instructions at a time, so pages span several steps
+static std::string run(const std::string& frame, const RequestContext& context) {
+	DisassemblyOptions options;
+	size_t offset = parse_options(frame.data(), frame.size(), options);
+
+	RequestRunner runner(frame.data() + offset, frame.size() - offset, options, context);
+	while (!runner.step(4)) {}
+	return runner.takeResponse();
+}
+
+static std::string format_field(bool json) {
+	return json ? option_field(OPTION_OUTPUT_FORMAT, "\x01") : "";
+}
+
+// Splits the cursor off a page, leaving what it adds to the whole output
+static std::string take_cursor(std::string& page, bool json) {
+	std::string cursor;
+
+	if (json) {
+		size_t pos = page.rfind(",\"cursor\":\"");
+		if (pos != std::string::npos)
+			cursor = page.substr(pos + 11, page.size() - pos - 13);
+
+		// Only the protos between the brackets
+		size_t end = page.rfind("],\"truncated\":false");
+		page = end == std::string::npos || end < 11 ? "" : page.substr(11, end - 11);
+	}
+	else {
+		size_t pos = page.rfind("\n; next page: ");
+		if (pos != std::string::npos) {
+			cursor = page.substr(pos + 14, page.size() - pos - 15);
+			page.resize(pos);
+		}
+	}
+
+	return cursor;
+}
+
+struct PagedRun {
+	std::string output;
+	uint32_t pages = 0;
+	uint32_t scriptCacheHits = 0;
+	uint32_t protoCacheHits = 0;
+};
+
+// Fetches every page, the first with the bytecode and the rest with only the cursor, and joins them
+static PagedRun run_pages(const std::string& bytecode, bool json, ScriptCache& scriptCache, ProtoCache* protoCache) {
+	PagedRun result;
+
+	std::string frame = make_request(format_field(json) + option_field(OPTION_PAGE_BYTES, leb128_payload({ 1 })), bytecode);
+	std::vector<std::string> bodies;
+
+	for (;;) {
+		RequestMetrics metrics;
+		RequestContext context;
+		context.scriptCache = &scriptCache;
+		context.protoCache = protoCache;
+		context.metrics = &metrics;
+
+		std::string page = run(frame, context);
+		std::string cursor = take_cursor(page, json);
+
+		bodies.push_back(page);
+		result.pages++;
+		result.scriptCacheHits += metrics.scriptCacheHit;
+		result.protoCacheHits += metrics.cacheHits;
+
+		if (cursor.empty())
+			break;
+
+		frame = make_request(format_field(json) + option_field(OPTION_CURSOR, cursor), "");
+	}
+
+	for (size_t i = 0; i < bodies.size(); i++) {
+		if (json && i != 0 && !bodies[i].empty())
+			result.output += ',';
+		result.output += bodies[i];
+	}
+
+	if (json)
+		result.output = "{\"protos\":[" + result.output + "],\"truncated\":false}";
+
+	return result;
+}
+
+static void test_joined_pages(bool json) {
+	std::string bytecode = make_paged_script();
+	std::string full = run(make_request(format_field(json), bytecode), {});
+
+	// One proto per page; the first page deserializes the script, the others find it in the cache
+	ScriptCache scriptCache(size_t(1) << 20);
+	PagedRun paged = run_pages(bytecode, json, scriptCache, nullptr);
+	CHECK(paged.pages == 9);
+	CHECK(paged.scriptCacheHits == 8);
+	CHECK(paged.output == full);
+
+	// Pages rendered again with a proto cache come from it the second time, unchanged
+	ProtoCache protoCache(size_t(1) << 20);
+	PagedRun cold = run_pages(bytecode, json, scriptCache, &protoCache);
+	PagedRun warm = run_pages(bytecode, json, scriptCache, &protoCache);
+	CHECK(cold.output == full);
+	CHECK(warm.output == full);
+	CHECK(warm.scriptCacheHits == 9);
+	if (!json)
+		CHECK(warm.protoCacheHits > 0);
+}
+
+static void test_cursor_errors() {
+	std::string bytecode = make_paged_script();
+
+	ScriptCache scriptCache(size_t(1) << 20);
+	RequestContext context;
+	context.scriptCache = &scriptCache;
+
+	std::string page = run(make_request(option_field(OPTION_PAGE_BYTES, leb128_payload({ 1 })), bytecode), context);
+	std::string cursor = take_cursor(page, false);
+	CHECK(!cursor.empty());
+
+	// The bytecode can be sent again with the cursor, it is still served from the cache
+	RequestMetrics metrics;
+	context.metrics = &metrics;
+	CHECK(!run(make_request(option_field(OPTION_CURSOR, cursor), bytecode), context).empty());
+	CHECK(metrics.scriptCacheHit);
+	context.metrics = nullptr;
+
+	// A cursor sent with some other script
+	std::string other = make_test_script().data;
+	CHECK(throws_runtime_error([&] { run(make_request(option_field(OPTION_CURSOR, cursor), other), context); }));
+
+	// Cursor only, with the script gone from the cache or no cache at all
+	ScriptCache emptyCache(size_t(1) << 20);
+	RequestContext emptyContext;
+	emptyContext.scriptCache = &emptyCache;
+	CHECK(throws_runtime_error([&] { run(make_request(option_field(OPTION_CURSOR, cursor), ""), emptyContext); }));
+	CHECK(throws_runtime_error([&] { run(make_request(option_field(OPTION_CURSOR, cursor), ""), {}); }));
+}
+
+int main() {
+	test_joined_pages(false);
+	test_joined_pages(true);
+	test_cursor_errors();
+
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "disassembler/disassembler.hpp"
+#include "disassembler/request.hpp"
+#include "disassembler/signature.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for signature matching: the scan over raw bytecode and matching deserialized protos agree, including on
+// an import whose path names a constant that isn't a string
+
+// Matches of the protos, deserialized, in the same form as scan_signatures
+static std::vector<SignatureScan::ProtoMatches> match_protos(const std::string& bytecode, const SignatureSet& set) {
+	std::vector<Proto*> protoTable = deserialize_bytecode(bytecode.data(), bytecode.size());
+	ProtoTableOwner owner{ protoTable };
+
+	std::vector<SignatureScan::ProtoMatches> matched;
+	for (uint32_t id = 0; id < protoTable.size(); id++) {
+		SignatureScan::ProtoMatches protoMatches;
+		protoMatches.protoId = id;
+		set.match(protoTable[id], protoMatches.matches);
+		if (!protoMatches.matches.empty())
+			matched.push_back(std::move(protoMatches));
+	}
+	return matched;
+}
+
+static bool same_matches(const std::vector<SignatureScan::ProtoMatches>& a, const std::vector<SignatureScan::ProtoMatches>& b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].protoId != b[i].protoId || a[i].matches.size() != b[i].matches.size())
+			return false;
+		for (size_t j = 0; j < a[i].matches.size(); j++)
+			if (a[i].matches[j].signature != b[i].matches[j].signature || a[i].matches[j].pc != b[i].matches[j].pc)
+				return false;
+	}
+	return true;
+}
+
+static void test_pinned_import() {
+	BytecodeWriter script = make_test_script();
+	SignatureSet set(
+		"workspace: GETIMPORT \"game.Workspace\" CALL\n"
+		"print_hello: GETIMPORT \"print\" LOADK \"hello\" CALL\n"
+		"other: GETIMPORT \"game.Players\"\n"
+	);
+
+	SignatureScan scan = scan_signatures(script.data.data(), script.data.size(), set, DisassemblyOptions());
+	CHECK(scan.protos == 2);
+	CHECK(scan.matched.size() == 2);
+	if (scan.matched.size() == 2) {
+		CHECK(scan.matched[0].protoId == 0);
+		CHECK(scan.matched[0].matches.size() == 1);
+		CHECK(scan.matched[0].matches[0].signature == 1);
+		CHECK(scan.matched[0].matches[0].pc == 0);
+
+		CHECK(scan.matched[1].protoId == 1);
+		CHECK(scan.matched[1].matches.size() == 1);
+		CHECK(scan.matched[1].matches[0].signature == 0);
+		CHECK(scan.matched[1].matches[0].pc == 2);
+	}
+
+	CHECK(same_matches(scan.matched, match_protos(script.data, set)));
+}
+
+// One proto whose import's path is constant 0, a number: valid bytecode, but the path has no text to pin
+static std::string make_number_import() {
+	TestProto p;
+	p.maxstacksize = 1;
+	p.code = {
+		encode_ad(LOP_GETIMPORT, 0, 1),
+		encode_import(1, 0),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	};
+	p.constants = { number_constant(1), import_constant(encode_import(1, 0)) };
+
+	return write_script({ "game" }, { p }, 0).data;
+}
+
+static void test_number_import() {
+	std::string bytecode = make_number_import();
+	SignatureSet set("pinned: GETIMPORT \"game\"\nany: GETIMPORT\n");
+
+	SignatureScan scan = scan_signatures(bytecode.data(), bytecode.size(), set, DisassemblyOptions());
+	CHECK(scan.matched.size() == 1);
+	if (scan.matched.size() == 1) {
+		CHECK(scan.matched[0].matches.size() == 1);
+		CHECK(scan.matched[0].matches[0].signature == 1);
+		CHECK(scan.matched[0].matches[0].pc == 0);
+	}
+
+	CHECK(same_matches(scan.matched, match_protos(bytecode, set)));
+
+	// Disassembly showing the matches renders the import too
+	RequestContext context;
+	context.signatures = &set;
+
+	DisassemblyOptions options;
+	options.matchSignatures = true;
+	std::string output = run_request(bytecode.data(), bytecode.size(), options, context);
+	CHECK(output.find("GETIMPORT") != std::string::npos);
+	CHECK(output.find("any at pc 0") != std::string::npos);
+
+	options.mode = RequestMode::Signatures;
+	output = run_request(bytecode.data(), bytecode.size(), options, context);
+	CHECK(output.find("pinned") == std::string::npos);
+}
+
+// A proto without code has nothing to match, and its empty code must not be copied
+static void test_empty_proto() {
+	TestProto p;
+	p.maxstacksize = 0;
+	BytecodeWriter w = write_script({}, { p }, 0);
+
+	SignatureSet set("any: RETURN\n");
+	SignatureScan scan = scan_signatures(w.data.data(), w.data.size(), set, DisassemblyOptions());
+	CHECK(scan.protos == 1);
+	CHECK(scan.matched.empty());
+	CHECK(same_matches(scan.matched, match_protos(w.data, set)));
+}
+
+int main() {
+	test_pinned_import();
+	test_number_import();
+	test_empty_proto();
+
+	return checkFailures ? 1 : 0;
+}
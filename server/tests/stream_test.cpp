@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "disassembler/disassembler.hpp"
+#include "disassembler/request.hpp"
+#include "disassembler/scan.hpp"
+#include "disassembler/stream.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for chunked uploads: bytecode split at any point, and especially at a section boundary, deserializes and
+// renders exactly as it does whole, and bytecode ending early is refused by every reader instead of being read past its end
+
+// Feeds the pieces to a StreamingRunner the way the service does, a small slice between pieces
+static std::string run_streaming(const std::string& bytecode, const std::vector<size_t>& splits, const DisassemblyOptions& options) {
+	StreamingRunner runner(bytecode.size(), options);
+
+	size_t offset = 0;
+	bool done = false;
+	for (size_t i = 0; i <= splits.size() && !done; i++) {
+		size_t end = i < splits.size() ? splits[i] : bytecode.size();
+		runner.push(bytecode.data() + offset, end - offset);
+		offset = end;
+
+		while (!done && !runner.needsData())
+			done = runner.step(1);
+	}
+
+	return done ? runner.takeResponse() : std::string();
+}
+
+static void test_section_boundaries() {
+	BytecodeWriter script = make_test_script();
+	const std::string& bytecode = script.data;
+
+	for (size_t boundary : script.sectionEnds) {
+		if (boundary == bytecode.size())
+			continue;
+
+		size_t protosBefore = 0;
+		for (size_t end : script.protoEnds)
+			if (end <= boundary)
+				protosBefore++;
+
+		StreamingDeserializer stream(bytecode.size());
+		stream.push(bytecode.data(), boundary);
+		CHECK(!stream.isComplete());
+		CHECK(stream.getBytesReceived() == boundary);
+		CHECK(stream.getProtos().size() == protosBefore);
+
+		stream.push(bytecode.data() + boundary, bytecode.size() - boundary);
+		CHECK(stream.isComplete());
+		CHECK(stream.getProtos().size() == script.protoEnds.size());
+	}
+
+	// Every section in a piece of its own
+	std::vector<size_t> splits(script.sectionEnds.begin(), script.sectionEnds.end() - 1);
+
+	StreamingDeserializer stream(bytecode.size());
+	size_t offset = 0;
+	for (size_t end : script.sectionEnds) {
+		stream.push(bytecode.data() + offset, end - offset);
+		offset = end;
+	}
+	CHECK(stream.isComplete());
+	CHECK(stream.getProtos().size() == script.protoEnds.size());
+
+	DisassemblyOptions options;
+	options.displayLineInfo = true;
+	std::string whole = run_request(bytecode.data(), bytecode.size(), options);
+	CHECK(!whole.empty());
+	CHECK(run_streaming(bytecode, splits, options) == whole);
+}
+
+static void test_every_split() {
+	BytecodeWriter script = make_test_script();
+	const std::string& bytecode = script.data;
+
+	DisassemblyOptions text;
+	text.displayLineInfo = true;
+
+	DisassemblyOptions json;
+	json.format = OutputFormat::Json;
+	json.showBlocks = true;
+
+	for (const DisassemblyOptions* options : { &text, &json }) {
+		std::string whole = run_request(bytecode.data(), bytecode.size(), *options);
+
+		// One split anywhere, including empty first and last pieces
+		for (size_t split = 0; split <= bytecode.size(); split++)
+			CHECK(run_streaming(bytecode, { split }, *options) == whole);
+
+		// A byte at a time
+		std::vector<size_t> splits;
+		for (size_t split = 1; split < bytecode.size(); split++)
+			splits.push_back(split);
+		CHECK(run_streaming(bytecode, splits, *options) == whole);
+	}
+}
+
+static void test_truncated() {
+	BytecodeWriter script = make_test_script();
+	const std::string& bytecode = script.data;
+
+	for (size_t size = 0; size < bytecode.size(); size++) {
+		const char* data = bytecode.data();
+
+		CHECK(throws_runtime_error([&] { scan_bytecode(data, size); }));
+		CHECK(throws_runtime_error([&] { deserialize_bytecode(data, size); }));
+		CHECK(throws_runtime_error([&] { run_request(data, size, DisassemblyOptions()); }));
+
+		// Declared as complete, the stream has to notice the missing sections
+		CHECK(throws_runtime_error([&] {
+			StreamingDeserializer stream(size);
+			stream.push(data, size);
+		}));
+
+		// Declared at its full size, the stream just waits for more
+		StreamingDeserializer stream(bytecode.size());
+		stream.push(data, size);
+		CHECK(!stream.isComplete());
+	}
+
+	// Pushing past the declared size
+	CHECK(throws_runtime_error([&] {
+		StreamingDeserializer stream(bytecode.size());
+		stream.push(bytecode.data(), bytecode.size());
+		stream.push(bytecode.data(), 1);
+	}));
+}
+
+int main() {
+	test_section_boundaries();
+	test_every_split();
+	test_truncated();
+
+	return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "disassembler/disassembler.hpp"
+#include "disassembler/xref.hpp"
+
+#include "bytecode_writer.hpp"
+#include "check.hpp"
+
+using namespace LuauDisassembler;
+
+// Regression tests for the reference index: which instructions make references, how symbols are keyed and the order of
+// their sites
+
+// Strings used by the script, numbered from 1
+static const std::vector<std::string> STRINGS = { "print", "child", "main", "game", "Workspace", "hello", "x", "Destroy", "Name" };
+
+// local function child() print("hello"); x = x.Name:Destroy() end
+static TestProto make_child_proto() {
+	TestProto p;
+	p.code = {
+		encode_ad(LOP_GETIMPORT, 0, 1),
+		encode_import(1, 0),
+		encode_abc(LOP_GETGLOBAL, 1, 0, 0),
+		3,
+		encode_abc(LOP_GETTABLEKS, 1, 1, 0),
+		4,
+		encode_abc(LOP_NAMECALL, 1, 1, 0),
+		5,
+		encode_abc(LOP_CALL, 1, 2, 2),
+		encode_abc(LOP_SETGLOBAL, 1, 0, 0),
+		3,
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	};
+	p.constants = {
+		string_constant(1),
+		import_constant(encode_import(1, 0)),
+		string_constant(6),
+		string_constant(7),
+		string_constant(9),
+		string_constant(8),
+	};
+	p.debugname = 2;
+	return p;
+}
+
+// The main proto reads game.Workspace.Name, x, a global named by a number constant (not a reference) and print as a
+// global rather than an import
+static TestProto make_main_proto_with_references() {
+	TestProto p;
+	p.isVararg = 1;
+	p.code = {
+		encode_abc(LOP_PREPVARARGS, 0, 0, 0),
+		encode_ad(LOP_NEWCLOSURE, 0, 0),
+		encode_ad(LOP_GETIMPORT, 1, 2),
+		encode_import(2, 0, 1),
+		encode_abc(LOP_GETTABLEKS, 1, 1, 0),
+		3,
+		encode_abc(LOP_GETGLOBAL, 1, 0, 0),
+		4,
+		encode_abc(LOP_GETGLOBAL, 1, 0, 0),
+		5,
+		encode_abc(LOP_GETGLOBAL, 1, 0, 0),
+		6,
+		encode_abc(LOP_CALL, 0, 1, 1),
+		encode_abc(LOP_RETURN, 0, 1, 0),
+	};
+	p.constants = {
+		string_constant(4),
+		string_constant(5),
+		import_constant(encode_import(2, 0, 1)),
+		string_constant(9),
+		string_constant(7),
+		number_constant(1),
+		string_constant(1),
+	};
+	p.children = { 0 };
+	p.debugname = 3;
+	return p;
+}
+
+static std::vector<ReferenceSite> get_sites(const ReferenceIndex& index, uint32_t symbol) {
+	return std::vector<ReferenceSite>(index.sites.begin() + index.siteOffsets[symbol], index.sites.begin() + index.siteOffsets[symbol + 1]);
+}
+
+static bool same_sites(const std::vector<ReferenceSite>& sites, const std::vector<ReferenceSite>& expected) {
+	if (sites.size() != expected.size())
+		return false;
+
+	for (size_t i = 0; i < sites.size(); i++) {
+		if (sites[i].protoId != expected[i].protoId || sites[i].pc != expected[i].pc)
+			return false;
+	}
+
+	return true;
+}
+
+static void test_index(const std::vector<Proto*>& protos) {
+	ReferenceIndex index = build_reference_index(protos);
+
+	// Symbols are numbered in the order they are first seen, an import and a global named print stay separate
+	CHECK(index.symbols == std::vector<std::string>({ "print", "x", ".Name", ":Destroy", "game.Workspace", "print" }));
+	CHECK(index.kinds == std::vector<ReferenceKind>({
+		ReferenceKind::Import,
+		ReferenceKind::Global,
+		ReferenceKind::Key,
+		ReferenceKind::Method,
+		ReferenceKind::Import,
+		ReferenceKind::Global,
+	}));
+	CHECK(index.siteOffsets.size() == index.symbols.size() + 1);
+	CHECK(index.sites.size() == 9);
+
+	// Sites of each symbol are in proto/pc order, reads and writes of a global alike
+	CHECK(same_sites(get_sites(index, 0), { { 0, 0 } }));
+	CHECK(same_sites(get_sites(index, 1), { { 0, 2 }, { 0, 9 }, { 1, 6 } }));
+	CHECK(same_sites(get_sites(index, 2), { { 0, 4 }, { 1, 4 } }));
+	CHECK(same_sites(get_sites(index, 3), { { 0, 6 } }));
+	CHECK(same_sites(get_sites(index, 4), { { 1, 2 } }));
+	CHECK(same_sites(get_sites(index, 5), { { 1, 10 } }));
+
+	// Globs match the display name, prefix included
+	CHECK(index.find("print") == std::vector<uint32_t>({ 0, 5 }));
+	CHECK(index.find(".*") == std::vector<uint32_t>({ 2 }));
+	CHECK(index.find(":D*y") == std::vector<uint32_t>({ 3 }));
+	CHECK(index.find("game.*") == std::vector<uint32_t>({ 4 }));
+	CHECK(index.find("Name").empty());
+	CHECK(index.find("*").size() == index.symbols.size());
+
+	// Overlapping queries list each symbol once, in the order the queries first match them
+	DisassemblyOptions options;
+	options.referenceQueries = { "x", "?", ":*" };
+	CHECK(format_references(index, protos, options) ==
+		"x ; global, 3 sites\n"
+		"\tproto 0 [002] child\n"
+		"\tproto 0 [009] child\n"
+		"\tproto 1 [006] main\n"
+		":Destroy ; method, 1 sites\n"
+		"\tproto 0 [006] child\n");
+
+	options.format = OutputFormat::Json;
+	options.referenceQueries = { "game.*" };
+	CHECK(format_references(index, protos, options) == "{\"references\":[{\"symbol\":\"game.Workspace\",\"kind\":\"import\",\"sites\":[{\"proto\":1,\"pc\":2}]}]}");
+}
+
+static void test_empty() {
+	ReferenceIndex index = build_reference_index({});
+	CHECK(index.symbols.empty());
+	CHECK(index.siteOffsets.size() == 1);
+	CHECK(index.sites.empty());
+	CHECK(index.find("*").empty());
+}
+
+int main() {
+	BytecodeWriter script = write_script(STRINGS, { make_child_proto(), make_main_proto_with_references() }, 1);
+	std::vector<Proto*> protos = deserialize_bytecode(script.data.data(), script.data.size());
+	ProtoTableOwner owner{ protos };
+
+	CHECK(protos.size() == 2);
+	if (protos.size() == 2)
+		test_index(protos);
+
+	test_empty();
+
+	return checkFailures ? 1 : 0;
+}